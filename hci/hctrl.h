@@ -17,6 +17,13 @@
 #ifndef _HCTRL_H_
 #define _HCTRL_H_
 #define MAX_FRAME_SIZE 4096
+#define SSV6XXX_RX_RING_SIZE 32
+#define SSV6XXX_RX_RING_LOW (SSV6XXX_RX_RING_SIZE / 2)
+#define SSV6XXX_RX_MAX_PER_ISR 32
+#define SSV6XXX_RX_COPYBREAK 256
+#define SSV6XXX_REG_SHADOW_MAX 32
+#define SSV6XXX_BENCH_SAMPLES 8192
+#define SSV6XXX_ISR_HIST_BUCKETS 32
 #define SSV6XXX_INT_RX 0x00000001
 #define SSV6XXX_INT_TX 0x00000002
 #define SSV6XXX_INT_SOC 0x00000004
@@ -25,10 +32,12 @@
 #define SSV6XXX_INT_LOW_EDCA_2 0x00000020
 #define SSV6XXX_INT_LOW_EDCA_3 0x00000040
 #define SSV6XXX_INT_RESOURCE_LOW 0x00000080
+#define SSV6XXX_TX_IRQ_ARMED 0
 #define IFDEV(_ct) ((_ct)->shi->dev)
 #define IFOPS(_ct) ((_ct)->shi->if_ops)
 #define HCI_REG_READ(_ct,_adr,_val) IFOPS(_ct)->readreg(IFDEV(_ct), _adr, _val)
 #define HCI_REG_WRITE(_ct,_adr,_val) IFOPS(_ct)->writereg(IFDEV(_ct), _adr, _val)
+#define HCI_REG_WRITE_BATCH(_ct,_regs,_cnt) IFOPS(_ct)->writereg_batch(IFDEV(_ct), _regs, _cnt)
 #define HCI_REG_SET_BITS(_ct,_reg,_set,_clr) \
 { \
     u32 _regval; \
@@ -38,48 +47,79 @@
     if(HCI_REG_WRITE(_ct, _reg, _regval)); \
 }
 #define IF_SEND(_ct,_bf,_len,_qid) IFOPS(_ct)->write(IFDEV(_ct), _bf, _len, _qid)
+#define IF_SEND_SCATTER(_ct,_req,_qid) IFOPS(_ct)->write_scatter(IFDEV(_ct), _req, _qid)
+#define IF_SEND_GATHER(_ct,_req,_qid) IFOPS(_ct)->write_gather(IFDEV(_ct), _req, _qid)
 #define IF_RECV(ct,bf,len) IFOPS(ct)->read(IFDEV(ct), bf, len)
+#define IF_RECV_SCATTER(ct,req,sts) IFOPS(ct)->read_scatter(IFDEV(ct), req, sts)
 #define HCI_LOAD_FW(ct,_bf,open) IFOPS(ct)->load_fw(IFDEV(ct), _bf, open)
 #define HCI_IFC_RESET(ct) IFOPS(ct)->interface_reset(IFDEV(ct))
+enum ssv6xxx_isr_hist_id {
+	SSV6XXX_HIST_ISR,
+	SSV6XXX_HIST_IRQ_GAP,
+	SSV6XXX_HIST_RX_IO,
+	SSV6XXX_HIST_RX_PROC,
+	SSV6XXX_HIST_TX_IO,
+	SSV6XXX_HIST_NUM,
+};
+/* Per-CPU log2 histogram, bucket n counts samples in [2^n, 2^(n+1)) ns. */
+struct ssv6xxx_isr_hist {
+	u32 bucket[SSV6XXX_HIST_NUM][SSV6XXX_ISR_HIST_BUCKETS];
+	u64 sum_ns[SSV6XXX_HIST_NUM];
+};
+struct ssv6xxx_hci_lat {
+	u32 *ns;
+	u32 cnt;
+};
 struct ssv6xxx_hci_ctrl {
 	struct ssv6xxx_hci_info *shi;
 	spinlock_t int_lock;
 	u32 int_status;
 	u32 int_mask;
+	unsigned long tx_irq_state;
+	u32 tx_irq_arm_cnt;
 	struct mutex txq_mask_lock;
 	u32 txq_mask;
 	struct ssv_hw_txq hw_txq[SSV_HW_TXQ_NUM];
 	struct mutex hci_mutex;
 	bool hci_start;
-	struct sk_buff *rx_buf;
+	struct sdio_scatter_req tx_scat_req;
+	struct sk_buff *tx_batch[MAX_SCATTER_ENTRIES_PER_REQ];
+	u32 tx_scatter_cnt;
+	struct sdio_gather_req tx_gather_req;
+	u32 tx_gather_cnt;
+	struct sk_buff_head rx_ring;
+	struct sdio_scatter_req rx_scat_req;
+	struct sk_buff *rx_batch[MAX_SCATTER_ENTRIES_PER_REQ];
 	u32 rx_pkt;
+	u32 rx_scatter_cnt;
+	u32 rx_ring_empty_cnt;
+	u32 rx_copybreak;
+	u32 rx_copybreak_cnt;
+	struct mutex reg_shadow_lock;
+	u32 reg_shadow[SSV6XXX_REG_SHADOW_MAX];
+	u32 reg_shadow_valid;
+	u32 reg_shadow_hit;
+	u32 reg_shadow_miss;
+	spinlock_t bench_lock;
+	bool bench_on;
+	struct ssv6xxx_hci_lat bench_lat[SSV6XXX_BENCH_DIR_NUM];
+	u32 bench_frames[SSV6XXX_BENCH_DIR_NUM];
+	u64 bench_bytes[SSV6XXX_BENCH_DIR_NUM];
 	struct workqueue_struct *hci_work_queue;
 	struct work_struct hci_rx_work;
 	struct work_struct hci_tx_work;
+	struct work_struct rx_refill_work;
 	u32 read_rs0_info_fail;
 	u32 read_rs1_info_fail;
 	u32 rx_work_running;
 	u32 isr_running;
 	u32 xmit_running;
-	u32 isr_summary_eable;
-	u32 isr_routine_time;
-	u32 isr_tx_time;
-	u32 isr_rx_time;
-	u32 isr_idle_time;
-	u32 isr_rx_idle_time;
+	u32 isr_hist_enable;
 	u32 isr_miss_cnt;
-	unsigned long prev_isr_jiffes;
-	unsigned long prev_rx_isr_jiffes;
+	s64 prev_isr_ns;
+	struct ssv6xxx_isr_hist __percpu *isr_hist;
 #ifdef CONFIG_SSV6XXX_DEBUGFS
 	struct dentry *debugfs_dir;
-	u32 isr_mib_enable;
-	u32 isr_mib_reset;
-	long long isr_total_time;
-	long long isr_tx_io_time;
-	long long isr_rx_io_time;
-	u32 isr_rx_io_count;
-	u32 isr_tx_io_count;
-	long long isr_rx_proc_time;
 #ifdef CONFIG_IRQ_DEBUG_COUNT
 	bool irq_enable;
 	u32 irq_count;
@@ -110,6 +150,7 @@ struct ssv6xxx_hw_resource {
 	u32 free_tx_page;
 	u32 free_tx_id;
 	int max_tx_frame[SSV_HW_TXQ_NUM];
+	bool quota_limited;
 };
 static inline void ssv6xxx_hwif_irq_request(struct ssv6xxx_hci_ctrl *hctrl,
 					    irq_handler_t irq_handler)
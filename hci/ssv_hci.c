@@ -19,10 +19,21 @@
 #include <linux/module.h>
 #include <linux/delay.h>
 #include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/percpu.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
 #include <ssv6200.h>
+#include <ssv_trace.h>
 #include "hctrl.h"
 
+#define SSV6XXX_HCI_DRR_MAX_ROUNDS 32
+
 static struct ssv6xxx_hci_ctrl *ctrl_hci = NULL;
+static const u32 ssv6xxx_hci_txq_weight[SSV_HW_TXQ_NUM] = {
+	SSV_HW_TXQ_WEIGHT_BK, SSV_HW_TXQ_WEIGHT_BE, SSV_HW_TXQ_WEIGHT_VI,
+	SSV_HW_TXQ_WEIGHT_VO, SSV_HW_TXQ_WEIGHT_MGMT,
+};
 
 struct sk_buff *ssv_skb_alloc(s32 len)
 {
@@ -62,6 +73,8 @@ static void ssv6xxx_hci_irq_register(u32 irq_mask)
 	ctrl_hci->int_mask |= irq_mask;
 	regval = ~ctrl_hci->int_mask;
 	spin_unlock_irqrestore(&ctrl_hci->int_lock, flags);
+	if (irq_mask & SSV6XXX_INT_RESOURCE_LOW)
+		set_bit(SSV6XXX_TX_IRQ_ARMED, &ctrl_hci->tx_irq_state);
 	smp_mb();
 	HCI_IRQ_SET_MASK(ctrl_hci, regval);
 	mutex_unlock(&ctrl_hci->hci_mutex);
@@ -90,20 +103,122 @@ static int ssv6xxx_hci_stop(void)
 	return 0;
 }
 
+/*
+ * Registers only the host driver ever writes. Their last written value is
+ * kept in ctrl_hci so a read-modify-write costs a single bus write.
+ * Anything the MCU or hardware may change behind our back must not be
+ * listed here.
+ */
+static const u32 ssv6xxx_reg_shadow_list[] = {
+	ADR_MTX_MISC_EN,
+	ADR_SYN_DIV_SDM_XOSC,
+	ADR_SYN_REGISTER_1,
+	ADR_SYN_REGISTER_2,
+	ADR_SX_LCK_BIN_REGISTERS_II,
+	ADR_MANUAL_ENABLE_REGISTER,
+	ADR_RX_ADC_REGISTER,
+};
+
+static int ssv6xxx_hci_reg_shadow_idx(u32 addr)
+{
+	int i;
+	BUILD_BUG_ON(ARRAY_SIZE(ssv6xxx_reg_shadow_list) >
+		     SSV6XXX_REG_SHADOW_MAX);
+	for (i = 0; i < ARRAY_SIZE(ssv6xxx_reg_shadow_list); i++) {
+		if (ssv6xxx_reg_shadow_list[i] == addr)
+			return i;
+	}
+	return -1;
+}
+
+static void ssv6xxx_hci_reg_shadow_store(int idx, u32 regval, int ret)
+{
+	if (ret == 0) {
+		ctrl_hci->reg_shadow[idx] = regval;
+		ctrl_hci->reg_shadow_valid |= (1 << idx);
+	} else {
+		ctrl_hci->reg_shadow_valid &= ~(1 << idx);
+	}
+}
+
+static void ssv6xxx_hci_reg_shadow_invalidate(void)
+{
+	mutex_lock(&ctrl_hci->reg_shadow_lock);
+	ctrl_hci->reg_shadow_valid = 0;
+	mutex_unlock(&ctrl_hci->reg_shadow_lock);
+}
+
 static int ssv6xxx_hci_read_word(u32 addr, u32 * regval)
 {
-	int ret = HCI_REG_READ(ctrl_hci, addr, regval);
+	int ret, idx = ssv6xxx_hci_reg_shadow_idx(addr);
+	if (idx < 0)
+		return HCI_REG_READ(ctrl_hci, addr, regval);
+	mutex_lock(&ctrl_hci->reg_shadow_lock);
+	if (ctrl_hci->reg_shadow_valid & (1 << idx)) {
+		*regval = ctrl_hci->reg_shadow[idx];
+		ctrl_hci->reg_shadow_hit++;
+		ret = 0;
+	} else {
+		ret = HCI_REG_READ(ctrl_hci, addr, regval);
+		ssv6xxx_hci_reg_shadow_store(idx, *regval, ret);
+		ctrl_hci->reg_shadow_miss++;
+	}
+	mutex_unlock(&ctrl_hci->reg_shadow_lock);
 	return ret;
 }
 
 static int ssv6xxx_hci_write_word(u32 addr, u32 regval)
 {
-	return HCI_REG_WRITE(ctrl_hci, addr, regval);
+	int ret, idx = ssv6xxx_hci_reg_shadow_idx(addr);
+	if (idx < 0)
+		return HCI_REG_WRITE(ctrl_hci, addr, regval);
+	mutex_lock(&ctrl_hci->reg_shadow_lock);
+	ret = HCI_REG_WRITE(ctrl_hci, addr, regval);
+	ssv6xxx_hci_reg_shadow_store(idx, regval, ret);
+	mutex_unlock(&ctrl_hci->reg_shadow_lock);
+	return ret;
+}
+
+static int ssv6xxx_hci_write_word_batch(const struct ssv6xxx_reg_batch *regs,
+					u32 count)
+{
+	int ret = 0, idx;
+	u32 i;
+	mutex_lock(&ctrl_hci->reg_shadow_lock);
+	if (IFOPS(ctrl_hci)->writereg_batch != NULL) {
+		ret = HCI_REG_WRITE_BATCH(ctrl_hci, regs, count);
+	} else {
+		for (i = 0; i < count; i++) {
+			ret = HCI_REG_WRITE(ctrl_hci, regs[i].addr,
+					    regs[i].value);
+			if (ret)
+				break;
+		}
+	}
+	for (i = 0; i < count; i++) {
+		idx = ssv6xxx_hci_reg_shadow_idx(regs[i].addr);
+		if (idx >= 0)
+			ssv6xxx_hci_reg_shadow_store(idx, regs[i].value, ret);
+	}
+	mutex_unlock(&ctrl_hci->reg_shadow_lock);
+	return ret;
+}
+
+static void ssv6xxx_hci_set_bits(u32 addr, u32 set, u32 clr)
+{
+	u32 regval;
+	if (ssv6xxx_hci_read_word(addr, &regval))
+		return;
+	regval &= ~(clr);
+	regval |= (set);
+	ssv6xxx_hci_write_word(addr, regval);
 }
 
 static int ssv6xxx_hci_load_fw(u8 * firmware_name, u8 openfile)
 {
-	return HCI_LOAD_FW(ctrl_hci, firmware_name, openfile);
+	int ret = HCI_LOAD_FW(ctrl_hci, firmware_name, openfile);
+	ssv6xxx_hci_reg_shadow_invalidate();
+	return ret;
 }
 
 static int ssv6xxx_hci_write_sram(u32 addr, u8 * data, u32 size)
@@ -120,6 +235,7 @@ static int ssv6xxx_hci_pmu_wakeup(void)
 static int ssv6xxx_hci_interface_reset(void)
 {
 	HCI_IFC_RESET(ctrl_hci);
+	ssv6xxx_hci_reg_shadow_invalidate();
 	return 0;
 }
 
@@ -134,24 +250,222 @@ static int ssv6xxx_hci_send_cmd(struct sk_buff *skb)
 	return ret;
 }
 
+/*
+ * Benchmark latency: TX frames are stamped at enqueue and measured once
+ * IF_SEND has taken them, RX frames are stamped at IF_RECV and measured
+ * when smac hands them on. The last SSV6XXX_BENCH_SAMPLES per direction
+ * are kept so percentiles are exact rather than bucketed.
+ */
+static void ssv6xxx_hci_bench_record(int dir, struct sk_buff *skb)
+{
+	struct ssv6xxx_hci_lat *lat = &ctrl_hci->bench_lat[dir];
+	unsigned long flags;
+	s64 delta;
+	if (ktime_to_ns(skb->tstamp) == 0)
+		return;
+	delta = ktime_to_ns(ktime_sub(ktime_get(), skb->tstamp));
+	skb->tstamp = ktime_set(0, 0);
+	if (delta < 0)
+		return;
+	spin_lock_irqsave(&ctrl_hci->bench_lock, flags);
+	if (ctrl_hci->bench_on) {
+		lat->ns[lat->cnt++ % SSV6XXX_BENCH_SAMPLES] =
+		    (delta > U32_MAX) ? U32_MAX : (u32) delta;
+		ctrl_hci->bench_frames[dir]++;
+		ctrl_hci->bench_bytes[dir] += skb->len;
+	}
+	spin_unlock_irqrestore(&ctrl_hci->bench_lock, flags);
+}
+
+static void ssv6xxx_hci_bench_rx_done(struct sk_buff *skb)
+{
+	ssv6xxx_hci_bench_record(SSV6XXX_BENCH_RX, skb);
+}
+
+static int ssv6xxx_hci_bench_start(void)
+{
+	unsigned long flags;
+	int dir;
+	for (dir = 0; dir < SSV6XXX_BENCH_DIR_NUM; dir++) {
+		if (ctrl_hci->bench_lat[dir].ns != NULL)
+			continue;
+		ctrl_hci->bench_lat[dir].ns =
+		    vmalloc(SSV6XXX_BENCH_SAMPLES * sizeof(u32));
+		if (ctrl_hci->bench_lat[dir].ns == NULL)
+			return -ENOMEM;
+	}
+	spin_lock_irqsave(&ctrl_hci->bench_lock, flags);
+	for (dir = 0; dir < SSV6XXX_BENCH_DIR_NUM; dir++) {
+		ctrl_hci->bench_lat[dir].cnt = 0;
+		ctrl_hci->bench_frames[dir] = 0;
+		ctrl_hci->bench_bytes[dir] = 0;
+	}
+	ctrl_hci->bench_on = true;
+	spin_unlock_irqrestore(&ctrl_hci->bench_lock, flags);
+	return 0;
+}
+
+static void ssv6xxx_hci_bench_stop(void)
+{
+	unsigned long flags;
+	spin_lock_irqsave(&ctrl_hci->bench_lock, flags);
+	ctrl_hci->bench_on = false;
+	spin_unlock_irqrestore(&ctrl_hci->bench_lock, flags);
+}
+
+static int ssv6xxx_hci_bench_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+	return (x > y) - (x < y);
+}
+
+static inline u32 ssv6xxx_hci_bench_pct(u32 *sorted, u32 n, u32 permille)
+{
+	u32 idx = (u32) (((u64) n * permille) / 1000);
+	return sorted[(idx >= n) ? (n - 1) : idx];
+}
+
+static int ssv6xxx_hci_bench_stat(struct ssv6xxx_hci_bench_stat *stat)
+{
+	struct ssv6xxx_hci_lat *lat;
+	unsigned long flags;
+	u32 *buf, n;
+	int dir;
+	memset(stat, 0, sizeof(*stat));
+	buf = vmalloc(SSV6XXX_BENCH_SAMPLES * sizeof(u32));
+	if (buf == NULL)
+		return -ENOMEM;
+	for (dir = 0; dir < SSV6XXX_BENCH_DIR_NUM; dir++) {
+		lat = &ctrl_hci->bench_lat[dir];
+		spin_lock_irqsave(&ctrl_hci->bench_lock, flags);
+		n = min_t(u32, lat->cnt, SSV6XXX_BENCH_SAMPLES);
+		if (n)
+			memcpy(buf, lat->ns, n * sizeof(u32));
+		stat->frames[dir] = ctrl_hci->bench_frames[dir];
+		stat->bytes[dir] = ctrl_hci->bench_bytes[dir];
+		spin_unlock_irqrestore(&ctrl_hci->bench_lock, flags);
+		stat->samples[dir] = n;
+		if (n == 0)
+			continue;
+		sort(buf, n, sizeof(u32), ssv6xxx_hci_bench_cmp, NULL);
+		stat->p50_ns[dir] = ssv6xxx_hci_bench_pct(buf, n, 500);
+		stat->p99_ns[dir] = ssv6xxx_hci_bench_pct(buf, n, 990);
+		stat->p999_ns[dir] = ssv6xxx_hci_bench_pct(buf, n, 999);
+	}
+	vfree(buf);
+	return 0;
+}
+
+/*
+ * Byte-based queue limits. Each HW TX queue measures how fast the device
+ * takes its bytes while it is backlogged, and flow control keeps no more
+ * than SSV_HW_TXQ_TARGET_DELAY_MS of that queued in the host. The frame
+ * count cap stays as a backstop.
+ */
+static struct sk_buff *ssv6xxx_hci_txq_dequeue(struct ssv_hw_txq *hw_txq)
+{
+	struct sk_buff *skb = skb_dequeue(&hw_txq->qhead);
+	if (skb)
+		atomic_sub(skb->len, &hw_txq->qbytes);
+	return skb;
+}
+
+static void ssv6xxx_hci_txq_requeue(struct ssv_hw_txq *hw_txq,
+				    struct sk_buff *skb)
+{
+	atomic_add(skb->len, &hw_txq->qbytes);
+	skb_queue_head(&hw_txq->qhead, skb);
+}
+
+static inline int ssv6xxx_hci_page_count(struct sk_buff *skb)
+{
+	int page_count = (skb->len + SSV6200_ALLOC_RSVD);
+	if (page_count & HW_MMU_PAGE_MASK)
+		return (page_count >> HW_MMU_PAGE_SHIFT) + 1;
+	return page_count >> HW_MMU_PAGE_SHIFT;
+}
+
+static int ssv6xxx_hci_txq_head_pages(struct ssv_hw_txq *hw_txq)
+{
+	struct sk_buff *skb;
+	unsigned long flags;
+	int page_count = 0;
+	spin_lock_irqsave(&hw_txq->qhead.lock, flags);
+	skb = skb_peek(&hw_txq->qhead);
+	if (skb)
+		page_count = ssv6xxx_hci_page_count(skb);
+	spin_unlock_irqrestore(&hw_txq->qhead.lock, flags);
+	return page_count;
+}
+
+static bool ssv6xxx_hci_txq_over_limit(struct ssv_hw_txq *hw_txq)
+{
+	return (skb_queue_len(&hw_txq->qhead) >= hw_txq->max_qsize)
+	    || (atomic_read(&hw_txq->qbytes) > READ_ONCE(hw_txq->limit_bytes));
+}
+
+/*
+ * A paused queue resumes only once it has drained to 3/4 of both limits,
+ * so mac80211 is not stopped and woken on every frame near the limit.
+ */
+static bool ssv6xxx_hci_txq_below_resume(struct ssv_hw_txq *hw_txq)
+{
+	return (skb_queue_len(&hw_txq->qhead) < (hw_txq->max_qsize * 3 / 4))
+	    && (atomic_read(&hw_txq->qbytes) <=
+		(READ_ONCE(hw_txq->limit_bytes) / 4 * 3));
+}
+
+static void ssv6xxx_hci_txq_completed(struct ssv_hw_txq *hw_txq, u32 bytes)
+{
+	ktime_t now = ktime_get();
+	s64 elapsed_us;
+	u32 rate, limit;
+	if (hw_txq->done_start == 0) {
+		hw_txq->done_start = now;
+		hw_txq->done_bytes = 0;
+	}
+	hw_txq->done_bytes += bytes;
+	elapsed_us = ktime_us_delta(now, hw_txq->done_start);
+	if ((elapsed_us < SSV_HW_TXQ_RATE_INTERVAL_US)
+	    && (atomic_read(&hw_txq->qbytes) != 0))
+		return;
+	if (elapsed_us > 0) {
+		rate = (u32) div_u64((u64) hw_txq->done_bytes * 1000,
+				     elapsed_us);
+		hw_txq->drain_rate = hw_txq->drain_rate
+		    ? (hw_txq->drain_rate * 3 + rate) / 4 : rate;
+		limit = hw_txq->drain_rate * SSV_HW_TXQ_TARGET_DELAY_MS;
+		limit = clamp_t(u32, limit, SSV_HW_TXQ_MIN_LIMIT,
+				SSV_HW_TXQ_MAX_LIMIT);
+		WRITE_ONCE(hw_txq->limit_bytes, limit);
+	}
+	hw_txq->done_start = (atomic_read(&hw_txq->qbytes) != 0) ? now : 0;
+	hw_txq->done_bytes = 0;
+}
+
 static int ssv6xxx_hci_enqueue(struct sk_buff *skb, int txqid, u32 tx_flags)
 {
 	struct ssv_hw_txq *hw_txq;
 	unsigned long flags;
-	u32 status;
 	int qlen = 0;
 	BUG_ON(txqid >= SSV_HW_TXQ_NUM || txqid < 0);
 	if (txqid >= SSV_HW_TXQ_NUM || txqid < 0)
 		return -1;
 	hw_txq = &ctrl_hci->hw_txq[txqid];
 	hw_txq->tx_flags = tx_flags;
-	if (tx_flags & HCI_FLAGS_ENQUEUE_HEAD)
+	trace_ssv6xxx_hci_enqueue(skb, txqid);
+	if (unlikely(ctrl_hci->bench_on))
+		skb->tstamp = ktime_get();
+	atomic_add(skb->len, &hw_txq->qbytes);
+	if (tx_flags & HCI_FLAGS_ENQUEUE_HEAD) {
+		WRITE_ONCE(hw_txq->updated_head, 0);
 		skb_queue_head(&hw_txq->qhead, skb);
+	}
 	else
 		skb_queue_tail(&hw_txq->qhead, skb);
 	qlen = (int)skb_queue_len(&hw_txq->qhead);
 	if (!(tx_flags & HCI_FLAGS_NO_FLOWCTRL)) {
-		if (skb_queue_len(&hw_txq->qhead) >= hw_txq->max_qsize) {
+		if (ssv6xxx_hci_txq_over_limit(hw_txq)) {
 			ctrl_hci->shi->hci_tx_flow_ctrl_cb(ctrl_hci->
 							   shi->tx_fctrl_cb_args,
 							   hw_txq->txq_no, true,
@@ -159,31 +473,35 @@ static int ssv6xxx_hci_enqueue(struct sk_buff *skb, int txqid, u32 tx_flags)
 		}
 	}
 
+	/*
+	 * Pairs with the clear/re-check in _do_tx(): either we see the TX
+	 * interrupt still armed, or _do_tx() sees this frame on its queue
+	 * and keeps it armed. Only the disarmed case needs hci_mutex.
+	 */
+	smp_mb();
+	if (test_bit(SSV6XXX_TX_IRQ_ARMED, &ctrl_hci->tx_irq_state))
+		return qlen;
 	mutex_lock(&ctrl_hci->hci_mutex);
+	if (test_and_set_bit(SSV6XXX_TX_IRQ_ARMED, &ctrl_hci->tx_irq_state)) {
+		mutex_unlock(&ctrl_hci->hci_mutex);
+		return qlen;
+	}
+	ctrl_hci->tx_irq_arm_cnt++;
 	spin_lock_irqsave(&ctrl_hci->int_lock, flags);
-	status = ctrl_hci->int_mask;
-
-	if ((ctrl_hci->int_mask & SSV6XXX_INT_RESOURCE_LOW) == 0) {
-		if (ctrl_hci->shi->if_ops->trigger_tx_rx == NULL) {
-			u32 regval;
-			ctrl_hci->int_mask |= SSV6XXX_INT_RESOURCE_LOW;
-			regval = ~ctrl_hci->int_mask;
-			spin_unlock_irqrestore(&ctrl_hci->int_lock, flags);
-			HCI_IRQ_SET_MASK(ctrl_hci, regval);
-			mutex_unlock(&ctrl_hci->hci_mutex);
-		} else {
-			ctrl_hci->int_status |= SSV6XXX_INT_RESOURCE_LOW;
-			smp_mb();
-			spin_unlock_irqrestore(&ctrl_hci->int_lock, flags);
-			mutex_unlock(&ctrl_hci->hci_mutex);
-			ctrl_hci->shi->if_ops->trigger_tx_rx(ctrl_hci->
-							     shi->dev);
-		}
+	if (ctrl_hci->shi->if_ops->trigger_tx_rx == NULL) {
+		u32 regval;
+		ctrl_hci->int_mask |= SSV6XXX_INT_RESOURCE_LOW;
+		regval = ~ctrl_hci->int_mask;
+		spin_unlock_irqrestore(&ctrl_hci->int_lock, flags);
+		HCI_IRQ_SET_MASK(ctrl_hci, regval);
+		mutex_unlock(&ctrl_hci->hci_mutex);
 	} else {
+		ctrl_hci->int_status |= SSV6XXX_INT_RESOURCE_LOW;
+		smp_mb();
 		spin_unlock_irqrestore(&ctrl_hci->int_lock, flags);
 		mutex_unlock(&ctrl_hci->hci_mutex);
+		ctrl_hci->shi->if_ops->trigger_tx_rx(ctrl_hci->shi->dev);
 	}
-
 	return qlen;
 }
 
@@ -208,11 +526,12 @@ static int ssv6xxx_hci_txq_flush(u32 txq_mask)
 		if ((txq_mask & (1 << txqid)) != 0)
 			continue;
 		hw_txq = &ctrl_hci->hw_txq[txqid];
-		while ((skb = skb_dequeue(&hw_txq->qhead))) {
+		while ((skb = ssv6xxx_hci_txq_dequeue(hw_txq))) {
 			ctrl_hci->shi->hci_tx_buf_free_cb(skb,
 							  ctrl_hci->
 							  shi->tx_buf_free_args);
 		}
+		hw_txq->updated_head = 0;
 	}
 	return 0;
 }
@@ -234,8 +553,8 @@ static int ssv6xxx_hci_txq_pause(u32 txq_mask)
 		hw_txq = &ctrl_hci->hw_txq[txqid];
 		hw_txq->paused = true;
 	}
-	HCI_REG_SET_BITS(ctrl_hci, ADR_MTX_MISC_EN,
-			 (ctrl_hci->txq_mask << 16), (0x1F << 16));
+	ssv6xxx_hci_set_bits(ADR_MTX_MISC_EN,
+			     (ctrl_hci->txq_mask << 16), (0x1F << 16));
 	mutex_unlock(&ctrl_hci->txq_mask_lock);
 	return 0;
 }
@@ -252,36 +571,177 @@ static int ssv6xxx_hci_txq_resume(u32 txq_mask)
 		hw_txq = &ctrl_hci->hw_txq[txqid];
 		hw_txq->paused = false;
 	}
-	HCI_REG_SET_BITS(ctrl_hci, ADR_MTX_MISC_EN,
-			 (ctrl_hci->txq_mask << 16), (0x1F << 16));
+	ssv6xxx_hci_set_bits(ADR_MTX_MISC_EN,
+			     (ctrl_hci->txq_mask << 16), (0x1F << 16));
 	mutex_unlock(&ctrl_hci->txq_mask_lock);
 	return 0;
 }
 
+/*
+ * A frame with a frag_list (an A-MPDU built from its delimited MPDUs) is
+ * written as one CMD53 gathered from the head and each fragment. Without
+ * write_gather support it is copied into a bounce skb; the container is
+ * never reallocated, since its head holds the A-MPDU bookkeeping.
+ */
+static int ssv6xxx_hci_send_gather(struct ssv_hw_txq *hw_txq,
+				   struct sk_buff *skb)
+{
+	struct sdio_gather_req *gather_req = &ctrl_hci->tx_gather_req;
+	struct sk_buff *frag, *bounce;
+	int i = 0, ret;
+	if (IFOPS(ctrl_hci)->write_gather == NULL)
+		goto bounce;
+	gather_req->list[i].buf = skb->data;
+	gather_req->list[i++].len = skb_headlen(skb);
+	skb_walk_frags(skb, frag) {
+		if (i >= MAX_GATHER_ENTRIES_PER_REQ - 1)
+			goto bounce;
+		gather_req->list[i].buf = frag->data;
+		gather_req->list[i++].len = frag->len;
+	}
+	gather_req->entries = i;
+	gather_req->len = skb->len;
+	ctrl_hci->tx_gather_cnt++;
+	return IF_SEND_GATHER(ctrl_hci, gather_req, hw_txq->txq_no);
+ bounce:
+	bounce = ssv_skb_alloc(skb->len);
+	if (bounce == NULL)
+		return -ENOMEM;
+	if (skb_copy_bits(skb, 0, skb_put(bounce, skb->len), skb->len)) {
+		ssv_skb_free(bounce);
+		return -EFAULT;
+	}
+	ret = IF_SEND(ctrl_hci, (void *)bounce->data, bounce->len,
+		      hw_txq->txq_no);
+	ssv_skb_free(bounce);
+	return ret;
+}
+
+static int ssv6xxx_hci_xmit_batch(struct ssv_hw_txq *hw_txq, int batch_count,
+				  struct sk_buff_head *tx_cb_list)
+{
+	struct sdio_scatter_req *scat_req = &ctrl_hci->tx_scat_req;
+	struct sk_buff **tx_batch = ctrl_hci->tx_batch;
+	struct ssv6200_tx_desc *tx_desc;
+	int i, sent, ret = 0;
+	u32 sent_bytes = 0;
+	if (skb_has_frag_list(tx_batch[0])) {
+		ret = ssv6xxx_hci_send_gather(hw_txq, tx_batch[0]);
+		sent = (ret < 0) ? 0 : 1;
+	} else if ((batch_count > 1)
+		   && (IFOPS(ctrl_hci)->write_scatter != NULL)) {
+		scat_req->req = SDIO_WRITE;
+		scat_req->len = 0;
+		scat_req->scat_entries = batch_count;
+		for (i = 0; i < batch_count; i++) {
+			scat_req->scat_list[i].buf = tx_batch[i]->data;
+			scat_req->scat_list[i].len = tx_batch[i]->len;
+			scat_req->len += tx_batch[i]->len;
+		}
+		ret = IF_SEND_SCATTER(ctrl_hci, scat_req, hw_txq->txq_no);
+		sent = (ret < 0) ? scat_req->scat_entries : batch_count;
+		ctrl_hci->tx_scatter_cnt++;
+	} else {
+		for (sent = 0; sent < batch_count; sent++) {
+			ret = IF_SEND(ctrl_hci, (void *)tx_batch[sent]->data,
+				      tx_batch[sent]->len, hw_txq->txq_no);
+			if (ret < 0)
+				break;
+		}
+	}
+	if (ret < 0) {
+		pr_err("ssv6xxx_hci_xmit failure\n");
+		for (i = batch_count - 1; i >= sent; i--)
+			ssv6xxx_hci_txq_requeue(hw_txq, tx_batch[i]);
+	}
+	for (i = 0; i < sent; i++) {
+		sent_bytes += tx_batch[i]->len;
+		trace_ssv6xxx_hci_send(tx_batch[i], hw_txq->txq_no);
+		if (unlikely(ctrl_hci->bench_on))
+			ssv6xxx_hci_bench_record(SSV6XXX_BENCH_TX,
+						 tx_batch[i]);
+		tx_desc = (struct ssv6200_tx_desc *)tx_batch[i]->data;
+		if (tx_desc->reason != ID_TRAP_SW_TXTPUT)
+			skb_queue_tail(tx_cb_list, tx_batch[i]);
+		else
+			ssv_skb_free(tx_batch[i]);
+		hw_txq->tx_pkt++;
+	}
+	if (sent)
+		ssv6xxx_hci_txq_completed(hw_txq, sent_bytes);
+	if (sent && !(hw_txq->tx_flags & HCI_FLAGS_NO_FLOWCTRL)) {
+		if (ssv6xxx_hci_txq_below_resume(hw_txq)) {
+			ctrl_hci->shi->
+			    hci_tx_flow_ctrl_cb
+			    (ctrl_hci->shi->tx_fctrl_cb_args,
+			     hw_txq->txq_no, false, 2000);
+		}
+	}
+	return sent;
+}
+
+static inline int ssv6xxx_hci_deficit_cap(struct ssv_hw_txq *hw_txq)
+{
+	return max_t(u32, READ_ONCE(hw_txq->weight), 1)
+	    + (SSV6200_PAGE_TX_THRESHOLD / 2);
+}
+
+/*
+ * Send the batch and give back what the unsent tail was charged: pages,
+ * IDs, queue slots and DRR credit. The tail is requeued at the head of
+ * the queue already passed through hci_skb_update_cb, which
+ * updated_head records so the retry does not run it a second time.
+ */
+static int ssv6xxx_hci_xmit_flush(struct ssv_hw_txq *hw_txq, int batch_count,
+				  struct sk_buff_head *tx_cb_list,
+				  struct ssv6xxx_hw_resource *phw_resource)
+{
+	int i, page_count, sent;
+	sent = ssv6xxx_hci_xmit_batch(hw_txq, batch_count, tx_cb_list);
+	for (i = sent; i < batch_count; i++) {
+		page_count = ssv6xxx_hci_page_count(ctrl_hci->tx_batch[i]);
+		phw_resource->free_tx_page += page_count;
+		phw_resource->free_tx_id++;
+		phw_resource->max_tx_frame[hw_txq->txq_no]++;
+		hw_txq->deficit = min_t(int, hw_txq->deficit + page_count,
+					ssv6xxx_hci_deficit_cap(hw_txq));
+		hw_txq->updated_head++;
+	}
+	return sent;
+}
+
 static int ssv6xxx_hci_xmit(struct ssv_hw_txq *hw_txq, int max_count,
 			    struct ssv6xxx_hw_resource *phw_resource)
 {
 	struct sk_buff_head tx_cb_list;
 	struct sk_buff *skb = NULL;
-	int tx_count, ret, page_count;
-	struct ssv6200_tx_desc *tx_desc = NULL;
+	int tx_count = 0, batch_count = 0, ret, page_count;
+	struct ssv6200_tx_desc *tx_desc;
 	ctrl_hci->xmit_running = 1;
 	skb_queue_head_init(&tx_cb_list);
-	for (tx_count = 0; tx_count < max_count; tx_count++) {
+	while ((tx_count + batch_count) < max_count) {
 		if (ctrl_hci->hci_start == false) {
 			pr_debug("ssv6xxx_hci_xmit - hci_start = false\n");
-			goto xmit_out;
+			break;
 		}
-		skb = skb_dequeue(&hw_txq->qhead);
+		skb = ssv6xxx_hci_txq_dequeue(hw_txq);
 		if (!skb) {
 			pr_debug("ssv6xxx_hci_xmit - queue empty\n");
-			goto xmit_out;
+			break;
 		}
-		page_count = (skb->len + SSV6200_ALLOC_RSVD);
-		if (page_count & HW_MMU_PAGE_MASK)
-			page_count = (page_count >> HW_MMU_PAGE_SHIFT) + 1;
-		else
-			page_count = page_count >> HW_MMU_PAGE_SHIFT;
+		if (skb_has_frag_list(skb) && (batch_count > 0)) {
+			ssv6xxx_hci_txq_requeue(hw_txq, skb);
+			ret = ssv6xxx_hci_xmit_flush(hw_txq, batch_count,
+						     &tx_cb_list, phw_resource);
+			tx_count += ret;
+			if (ret < batch_count) {
+				batch_count = 0;
+				goto xmit_out;
+			}
+			batch_count = 0;
+			continue;
+		}
+		page_count = ssv6xxx_hci_page_count(skb);
 		if (page_count > (SSV6200_PAGE_TX_THRESHOLD / 2))
 			pr_err("Asking page %d(%d) exceeds resource limit %d.\n",
 			       page_count, skb->len,
@@ -289,47 +749,48 @@ static int ssv6xxx_hci_xmit(struct ssv_hw_txq *hw_txq, int max_count,
 		if ((phw_resource->free_tx_page < page_count)
 		    || (phw_resource->free_tx_id <= 0)
 		    || (phw_resource->max_tx_frame[hw_txq->txq_no] <= 0)) {
-			skb_queue_head(&hw_txq->qhead, skb);
+			ssv6xxx_hci_txq_requeue(hw_txq, skb);
+			break;
+		}
+		if ((hw_txq->deficit < page_count)
+		    && (hw_txq->deficit < ssv6xxx_hci_deficit_cap(hw_txq))) {
+			ssv6xxx_hci_txq_requeue(hw_txq, skb);
+			phw_resource->quota_limited = true;
 			break;
 		}
+		hw_txq->deficit = max_t(int, hw_txq->deficit - page_count, 0);
 		phw_resource->free_tx_page -= page_count;
 		phw_resource->free_tx_id--;
 		phw_resource->max_tx_frame[hw_txq->txq_no]--;
 		tx_desc = (struct ssv6200_tx_desc *)skb->data;
 
-		if (ctrl_hci->shi->hci_skb_update_cb != NULL
-		    && tx_desc->reason != ID_TRAP_SW_TXTPUT) {
+		if (hw_txq->updated_head > 0) {
+			hw_txq->updated_head--;
+		} else if (ctrl_hci->shi->hci_skb_update_cb != NULL
+			   && tx_desc->reason != ID_TRAP_SW_TXTPUT) {
 			ctrl_hci->shi->hci_skb_update_cb(skb,
 							 ctrl_hci->
 							 shi->skb_update_args);
 		}
 
-		ret =
-		    IF_SEND(ctrl_hci, (void *)skb->data, skb->len,
-			    hw_txq->txq_no);
-		if (ret < 0) {
-			pr_err("ssv6xxx_hci_xmit failure\n");
-			skb_queue_head(&hw_txq->qhead, skb);
-			break;
-		}
-		if (tx_desc->reason != ID_TRAP_SW_TXTPUT)
-			skb_queue_tail(&tx_cb_list, skb);
-		else
-			ssv_skb_free(skb);
-		hw_txq->tx_pkt++;
-
-		if (!(hw_txq->tx_flags & HCI_FLAGS_NO_FLOWCTRL)) {
-			if (skb_queue_len(&hw_txq->qhead) < hw_txq->resum_thres) {
-				ctrl_hci->shi->
-				    hci_tx_flow_ctrl_cb
-				    (ctrl_hci->shi->tx_fctrl_cb_args,
-				     hw_txq->txq_no, false, 2000);
-			}
+		ctrl_hci->tx_batch[batch_count++] = skb;
+		if ((batch_count < MAX_SCATTER_ENTRIES_PER_REQ)
+		    && !skb_has_frag_list(skb))
+			continue;
+		ret = ssv6xxx_hci_xmit_flush(hw_txq, batch_count, &tx_cb_list,
+					     phw_resource);
+		tx_count += ret;
+		if (ret < batch_count) {
+			batch_count = 0;
+			goto xmit_out;
 		}
+		batch_count = 0;
 	}
+	if (batch_count > 0)
+		tx_count += ssv6xxx_hci_xmit_flush(hw_txq, batch_count,
+						   &tx_cb_list, phw_resource);
  xmit_out:
-	if (ctrl_hci->shi->hci_tx_cb && tx_desc
-	    && tx_desc->reason != ID_TRAP_SW_TXTPUT) {
+	if (ctrl_hci->shi->hci_tx_cb && !skb_queue_empty(&tx_cb_list)) {
 		ctrl_hci->shi->hci_tx_cb(&tx_cb_list,
 					 ctrl_hci->shi->tx_cb_args);
 	}
@@ -337,75 +798,151 @@ static int ssv6xxx_hci_xmit(struct ssv_hw_txq *hw_txq, int max_count,
 	return tx_count;
 }
 
-static int ssv6xxx_hci_tx_handler(void *dev, int max_count)
+static inline s64 ssv6xxx_hci_hist_start(struct ssv6xxx_hci_ctrl *hctl)
+{
+	return hctl->isr_hist_enable ? ktime_to_ns(ktime_get()) : 0;
+}
+
+static void ssv6xxx_hci_hist_add(struct ssv6xxx_hci_ctrl *hctl, int id,
+				 s64 delta_ns)
+{
+	int b = 0;
+	if (delta_ns < 0)
+		delta_ns = 0;
+	if (delta_ns)
+		b = min_t(int, fls64(delta_ns) - 1,
+			  SSV6XXX_ISR_HIST_BUCKETS - 1);
+	this_cpu_inc(hctl->isr_hist->bucket[id][b]);
+	this_cpu_add(hctl->isr_hist->sum_ns[id], (u64) delta_ns);
+}
+
+static inline void ssv6xxx_hci_hist_end(struct ssv6xxx_hci_ctrl *hctl,
+					int id, s64 start_ns)
+{
+	if (start_ns && hctl->isr_hist_enable)
+		ssv6xxx_hci_hist_add(hctl, id,
+				     ktime_to_ns(ktime_get()) - start_ns);
+}
+
+/*
+ * Snapshot the free pages and IDs and the per-queue headroom once per
+ * scheduling round. The MGMT queue depth lives in a second register,
+ * which is only read while that queue has frames.
+ */
+static int ssv6xxx_hci_read_hw_resource(struct ssv6xxx_hw_resource *res,
+					bool need_mgmt)
 {
 	struct ssv6xxx_hci_txq_info txq_info;
 	struct ssv6xxx_hci_txq_info2 txq_info2;
+	int ret;
+	memset(res, 0, sizeof(*res));
+	ret = HCI_REG_READ(ctrl_hci, ADR_TX_ID_ALL_INFO, (u32 *) & txq_info);
+	if (ret < 0) {
+		ctrl_hci->read_rs0_info_fail++;
+		return ret;
+	}
+	if ((SSV6200_PAGE_TX_THRESHOLD < txq_info.tx_use_page)
+	    || (SSV6200_ID_TX_THRESHOLD < txq_info.tx_use_id))
+		return -EBUSY;
+	res->free_tx_page = SSV6200_PAGE_TX_THRESHOLD - txq_info.tx_use_page;
+	res->free_tx_id = SSV6200_ID_TX_THRESHOLD - txq_info.tx_use_id;
+	res->max_tx_frame[0] = SSV6200_ID_AC_BK_OUT_QUEUE - txq_info.txq0_size;
+	res->max_tx_frame[1] = SSV6200_ID_AC_BE_OUT_QUEUE - txq_info.txq1_size;
+	res->max_tx_frame[2] = SSV6200_ID_AC_VI_OUT_QUEUE - txq_info.txq2_size;
+	res->max_tx_frame[3] = SSV6200_ID_AC_VO_OUT_QUEUE - txq_info.txq3_size;
+	BUG_ON(res->max_tx_frame[3] < 0);
+	BUG_ON(res->max_tx_frame[2] < 0);
+	BUG_ON(res->max_tx_frame[1] < 0);
+	BUG_ON(res->max_tx_frame[0] < 0);
+	if (!need_mgmt)
+		return 0;
+	ret = HCI_REG_READ(ctrl_hci, ADR_TX_ID_ALL_INFO2, (u32 *) & txq_info2);
+	if (ret < 0) {
+		ctrl_hci->read_rs1_info_fail++;
+		return ret;
+	}
+	if ((SSV6200_PAGE_TX_THRESHOLD < txq_info2.tx_use_page)
+	    || (SSV6200_ID_TX_THRESHOLD < txq_info2.tx_use_id))
+		return -EBUSY;
+	res->free_tx_page = SSV6200_PAGE_TX_THRESHOLD - txq_info2.tx_use_page;
+	res->free_tx_id = SSV6200_ID_TX_THRESHOLD - txq_info2.tx_use_id;
+	res->max_tx_frame[4] = SSV6200_ID_MANAGER_QUEUE - txq_info2.txq4_size;
+	return 0;
+}
+
+/*
+ * Deficit round robin over the HW queues, MGMT and VO first in each
+ * round. A queue earns its weight in pages per round and may spend it
+ * on whole frames, so bulk BE/BK traffic cannot take every free page
+ * while VO frames wait. Credit is capped at one maximum-size frame above
+ * the weight so a queue stalled on device resources cannot bank a burst;
+ * a queue at the cap may send one frame larger than its credit. A queue
+ * backlogged on its own is credited up to its head frame at once rather
+ * than over several empty rounds. Rounds repeat until all queues are
+ * empty, the device runs out of pages, IDs or queue slots, or
+ * SSV6XXX_HCI_DRR_MAX_ROUNDS is reached. Credit left over carries to the
+ * next RESOURCE_LOW interrupt.
+ */
+static int ssv6xxx_hci_tx_schedule(struct ssv6xxx_hci_ctrl *hctl)
+{
 	struct ssv6xxx_hw_resource hw_resource;
-	struct ssv_hw_txq *hw_txq = dev;
-	int ret, tx_count = 0;
-	max_count = skb_queue_len(&hw_txq->qhead);
-	if (max_count == 0)
+	struct ssv_hw_txq *hw_txq;
+	u32 backlog = 0;
+	int q_num, sent, round_sent, rounds = 0, tx_count = 0;
+	int active, credit;
+	s64 start_ns;
+	for (q_num = 0; q_num < SSV_HW_TXQ_NUM; q_num++) {
+		if (skb_queue_len(&hctl->hw_txq[q_num].qhead) > 0)
+			backlog |= BIT(q_num);
+		else
+			hctl->hw_txq[q_num].deficit = 0;
+	}
+	if (backlog == 0)
+		return 0;
+	if (ssv6xxx_hci_read_hw_resource(&hw_resource,
+					 (backlog & BIT(4)) != 0) < 0)
 		return 0;
-	if (hw_txq->txq_no == 4) {
-		ret =
-		    HCI_REG_READ(ctrl_hci, ADR_TX_ID_ALL_INFO2,
-				 (u32 *) & txq_info2);
-		if (ret < 0) {
-			ctrl_hci->read_rs1_info_fail++;
-			return 0;
+	do {
+		round_sent = 0;
+		hw_resource.quota_limited = false;
+		for (q_num = 0, active = 0; q_num < SSV_HW_TXQ_NUM; q_num++) {
+			if (skb_queue_len(&hctl->hw_txq[q_num].qhead) > 0)
+				active++;
 		}
-		//BUG_ON(SSV6200_PAGE_TX_THRESHOLD < txq_info2.tx_use_page);
-		//BUG_ON(SSV6200_ID_TX_THRESHOLD < txq_info2.tx_use_id);
-		if (SSV6200_PAGE_TX_THRESHOLD < txq_info2.tx_use_page)
-			return 0;
-		if (SSV6200_ID_TX_THRESHOLD < txq_info2.tx_use_page)
-			return 0;
-		hw_resource.free_tx_page =
-		    SSV6200_PAGE_TX_THRESHOLD - txq_info2.tx_use_page;
-		hw_resource.free_tx_id =
-		    SSV6200_ID_TX_THRESHOLD - txq_info2.tx_use_id;
-		hw_resource.max_tx_frame[4] =
-		    SSV6200_ID_MANAGER_QUEUE - txq_info2.txq4_size;
-	} else {
-		ret =
-		    HCI_REG_READ(ctrl_hci, ADR_TX_ID_ALL_INFO,
-				 (u32 *) & txq_info);
-		if (ret < 0) {
-			ctrl_hci->read_rs0_info_fail++;
-			return 0;
+		for (q_num = (SSV_HW_TXQ_NUM - 1); q_num >= 0; q_num--) {
+			hw_txq = &hctl->hw_txq[q_num];
+			if (skb_queue_len(&hw_txq->qhead) == 0) {
+				hw_txq->deficit = 0;
+				continue;
+			}
+			credit = max_t(u32, READ_ONCE(hw_txq->weight), 1);
+			if (active == 1)
+				credit = max_t(int, credit,
+					       ssv6xxx_hci_txq_head_pages(hw_txq)
+					       - hw_txq->deficit);
+			hw_txq->deficit = min_t(int, hw_txq->deficit + credit,
+						ssv6xxx_hci_deficit_cap(hw_txq));
+			start_ns = ssv6xxx_hci_hist_start(hctl);
+			sent = ssv6xxx_hci_xmit(hw_txq,
+						skb_queue_len(&hw_txq->qhead),
+						&hw_resource);
+			if (sent > 0)
+				ssv6xxx_hci_hist_end(hctl, SSV6XXX_HIST_TX_IO,
+						     start_ns);
+			round_sent += sent;
 		}
-		//BUG_ON(SSV6200_PAGE_TX_THRESHOLD < txq_info.tx_use_page);
-		//BUG_ON(SSV6200_ID_TX_THRESHOLD < txq_info.tx_use_id);
-		if (SSV6200_PAGE_TX_THRESHOLD < txq_info.tx_use_page)
-			return 0;
-		if (SSV6200_ID_TX_THRESHOLD < txq_info.tx_use_page)
-			return 0;
-		hw_resource.free_tx_page =
-		    SSV6200_PAGE_TX_THRESHOLD - txq_info.tx_use_page;
-		hw_resource.free_tx_id =
-		    SSV6200_ID_TX_THRESHOLD - txq_info.tx_use_id;
-		hw_resource.max_tx_frame[0] =
-		    SSV6200_ID_AC_BK_OUT_QUEUE - txq_info.txq0_size;
-		hw_resource.max_tx_frame[1] =
-		    SSV6200_ID_AC_BE_OUT_QUEUE - txq_info.txq1_size;
-		hw_resource.max_tx_frame[2] =
-		    SSV6200_ID_AC_VI_OUT_QUEUE - txq_info.txq2_size;
-		hw_resource.max_tx_frame[3] =
-		    SSV6200_ID_AC_VO_OUT_QUEUE - txq_info.txq3_size;
-		BUG_ON(hw_resource.max_tx_frame[3] < 0);
-		BUG_ON(hw_resource.max_tx_frame[2] < 0);
-		BUG_ON(hw_resource.max_tx_frame[1] < 0);
-		BUG_ON(hw_resource.max_tx_frame[0] < 0);
-	}
-	{
-		tx_count = ssv6xxx_hci_xmit(hw_txq, max_count, &hw_resource);
-	}
-	if ((ctrl_hci->shi->hci_tx_q_empty_cb != NULL)
-	    && (skb_queue_len(&hw_txq->qhead) == 0)) {
-		ctrl_hci->shi->hci_tx_q_empty_cb(hw_txq->txq_no,
-						 ctrl_hci->
-						 shi->tx_q_empty_args);
+		tx_count += round_sent;
+	} while (((round_sent > 0) || hw_resource.quota_limited)
+		 && (++rounds < SSV6XXX_HCI_DRR_MAX_ROUNDS));
+	for (q_num = 0; q_num < SSV_HW_TXQ_NUM; q_num++) {
+		hw_txq = &hctl->hw_txq[q_num];
+		if (!(backlog & BIT(q_num))
+		    || (skb_queue_len(&hw_txq->qhead) != 0))
+			continue;
+		hw_txq->deficit = 0;
+		if (hctl->shi->hci_tx_q_empty_cb != NULL)
+			hctl->shi->hci_tx_q_empty_cb(hw_txq->txq_no,
+						     hctl->shi->tx_q_empty_args);
 	}
 	return tx_count;
 }
@@ -415,189 +952,237 @@ void ssv6xxx_hci_tx_work(struct work_struct *work)
 	ssv6xxx_hci_irq_register(SSV6XXX_INT_RESOURCE_LOW);
 }
 
-static int _do_rx(struct ssv6xxx_hci_ctrl *hctl, u32 isr_status)
+static int ssv6xxx_hci_rx_ring_fill(struct ssv6xxx_hci_ctrl *hctl)
 {
-#if !defined(USE_THREAD_RX) || defined(USE_BATCH_RX)
-	struct sk_buff_head rx_list;
-#endif
-	struct sk_buff *rx_mpdu;
-	int rx_cnt, ret = 0;
+	struct sk_buff *skb;
+	while (skb_queue_len(&hctl->rx_ring) < SSV6XXX_RX_RING_SIZE) {
+		skb = ssv_skb_alloc(MAX_FRAME_SIZE);
+		if (skb == NULL)
+			return -ENOMEM;
+		skb_queue_tail(&hctl->rx_ring, skb);
+	}
+	return 0;
+}
+
+static void ssv6xxx_hci_rx_refill_work(struct work_struct *work)
+{
+	struct ssv6xxx_hci_ctrl *hctl =
+	    container_of(work, struct ssv6xxx_hci_ctrl, rx_refill_work);
+	ssv6xxx_hci_rx_ring_fill(hctl);
+}
+
+static inline void ssv6xxx_hci_rx_ring_put(struct ssv6xxx_hci_ctrl *hctl,
+					   struct sk_buff *skb)
+{
+	skb_trim(skb, 0);
+	skb_queue_head(&hctl->rx_ring, skb);
+}
+
+static struct sk_buff *ssv6xxx_hci_rx_copybreak(struct ssv6xxx_hci_ctrl *hctl,
+						 struct sk_buff *rx_mpdu)
+{
+	struct sk_buff *skb;
+	if (rx_mpdu->len >= hctl->rx_copybreak)
+		return rx_mpdu;
+	skb = ssv_skb_alloc(rx_mpdu->len);
+	if (skb == NULL)
+		return rx_mpdu;
+	memcpy(skb_put(skb, rx_mpdu->len), rx_mpdu->data, rx_mpdu->len);
+	ssv6xxx_hci_rx_ring_put(hctl, rx_mpdu);
+	hctl->rx_copybreak_cnt++;
+	return skb;
+}
+
+static int ssv6xxx_hci_rx_batch(struct ssv6xxx_hci_ctrl *hctl, int max_count,
+				struct sk_buff_head *rx_list, u32 *status)
+{
+	struct sdio_scatter_req *scat_req = &hctl->rx_scat_req;
+	struct sk_buff **rx_batch = hctl->rx_batch;
+	struct sk_buff *skb;
+	int i, count, rx_cnt = 0, ret = 0;
+	int int_status = 0;
+	ktime_t rx_time;
 	size_t dlen;
-	u32 status = isr_status;
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-	struct timespec rx_io_start_time, rx_io_end_time, rx_io_diff_time;
-	struct timespec rx_proc_start_time, rx_proc_end_time, rx_proc_diff_time;
-#endif
-#if !defined(USE_THREAD_RX) || defined(USE_BATCH_RX)
-	skb_queue_head_init(&rx_list);
-#endif
-	for (rx_cnt = 0; (status & SSV6XXX_INT_RX) && (rx_cnt < 32); rx_cnt++) {
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		if (hctl->isr_mib_enable)
-			getnstimeofday(&rx_io_start_time);
-#endif
-		ret = IF_RECV(hctl, hctl->rx_buf->data, &dlen);
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		if (hctl->isr_mib_enable)
-			getnstimeofday(&rx_io_end_time);
-#endif
-		if (ret < 0 || dlen <= 0) {
-			pr_warn("%s(): IF_RECV() retruns %d (dlen=%d)\n",
-			       __FUNCTION__, ret, (int)dlen);
-			if (ret != -84 || dlen > MAX_FRAME_SIZE)
+	if (max_count > MAX_SCATTER_ENTRIES_PER_REQ)
+		max_count = MAX_SCATTER_ENTRIES_PER_REQ;
+	if (skb_queue_empty(&hctl->rx_ring)) {
+		hctl->rx_ring_empty_cnt++;
+		ssv6xxx_hci_rx_ring_fill(hctl);
+	}
+	for (count = 0; count < max_count; count++) {
+		rx_batch[count] = skb_dequeue(&hctl->rx_ring);
+		if (rx_batch[count] == NULL)
+			break;
+	}
+	if (count == 0) {
+		pr_err("RX buffer allocation failure!\n");
+		return -ENOMEM;
+	}
+	if (IFOPS(hctl)->read_scatter != NULL) {
+		scat_req->req = SDIO_READ;
+		scat_req->len = 0;
+		scat_req->scat_entries = count;
+		for (i = 0; i < count; i++) {
+			scat_req->scat_list[i].buf = rx_batch[i]->data;
+			scat_req->scat_list[i].len = MAX_FRAME_SIZE;
+		}
+		ret = IF_RECV_SCATTER(hctl, scat_req, &int_status);
+		if (ret < 0)
+			pr_warn("%s(): IF_RECV_SCATTER() retruns %d\n",
+				__FUNCTION__, ret);
+		for (rx_cnt = 0; rx_cnt < scat_req->scat_entries; rx_cnt++) {
+			skb_put(rx_batch[rx_cnt], scat_req->scat_list[rx_cnt].len);
+			scat_req->len += scat_req->scat_list[rx_cnt].len;
+		}
+		hctl->rx_scatter_cnt++;
+	} else {
+		/*
+		 * Drain the port until it comes back empty and poll the
+		 * interrupt status once for the whole batch. An empty or
+		 * failed read after the first frame just ends the batch.
+		 */
+		while (rx_cnt < count) {
+			dlen = 0;
+			ret = IF_RECV(hctl, rx_batch[rx_cnt]->data, &dlen);
+			if ((ret < 0 || dlen <= 0) && (rx_cnt > 0)
+			    && (ret != -84)) {
+				ret = 0;
 				break;
+			}
+			if (ret < 0 || dlen <= 0) {
+				pr_warn("%s(): IF_RECV() retruns %d (dlen=%d)\n",
+					__FUNCTION__, ret, (int)dlen);
+				if (ret != -84 || dlen > MAX_FRAME_SIZE)
+					break;
+			}
+			skb_put(rx_batch[rx_cnt++], dlen);
 		}
-		rx_mpdu = hctl->rx_buf;
-		hctl->rx_buf = ssv_skb_alloc(MAX_FRAME_SIZE);
-		if (hctl->rx_buf == NULL) {
-			pr_err("RX buffer allocation failure!\n");
-			hctl->rx_buf = rx_mpdu;
+		if (rx_cnt > 0)
+			HCI_IRQ_STATUS(hctl, &int_status);
+	}
+	rx_time = hctl->bench_on ? ktime_get() : ktime_set(0, 0);
+	for (i = count - 1; i >= rx_cnt; i--)
+		ssv6xxx_hci_rx_ring_put(hctl, rx_batch[i]);
+	for (i = 0; i < rx_cnt; i++) {
+		skb = ssv6xxx_hci_rx_copybreak(hctl, rx_batch[i]);
+		skb->tstamp = rx_time;
+		__skb_queue_tail(rx_list, skb);
+	}
+	hctl->rx_pkt += rx_cnt;
+	*status = (ret < 0) ? 0 : int_status;
+	return ((ret < 0) && (rx_cnt == 0)) ? ret : rx_cnt;
+}
+
+static void ssv6xxx_hci_isr_hist_reset(void)
+{
+	int cpu;
+	for_each_possible_cpu(cpu)
+	    memset(per_cpu_ptr(ctrl_hci->isr_hist, cpu), 0,
+		   sizeof(struct ssv6xxx_isr_hist));
+	ctrl_hci->isr_miss_cnt = 0;
+	ctrl_hci->prev_isr_ns = 0;
+}
+
+static u64 ssv6xxx_hci_hist_pct(const u32 *bucket, u64 total, u32 permille)
+{
+	u64 need = div_u64(total * permille + 999, 1000), acc = 0;
+	int b;
+	for (b = 0; b < SSV6XXX_ISR_HIST_BUCKETS; b++) {
+		acc += bucket[b];
+		if (acc >= need)
 			break;
+	}
+	return 1ULL << (min(b, SSV6XXX_ISR_HIST_BUCKETS - 1) + 1);
+}
+
+static int ssv6xxx_hci_isr_hist_show(char *buf, size_t len)
+{
+	static const char *const hist_name[SSV6XXX_HIST_NUM] = {
+		"isr", "irq_gap", "rx_io", "rx_proc", "tx_io"
+	};
+	struct ssv6xxx_isr_hist *pcpu;
+	u32 bucket[SSV6XXX_ISR_HIST_BUCKETS];
+	u64 total, sum;
+	int id, b, cpu, n = 0;
+	n += scnprintf(buf + n, len - n, ">> HCI ISR histograms(%s), ns\n",
+		       ctrl_hci->isr_hist_enable ? "enable" : "disable");
+	for (id = 0; id < SSV6XXX_HIST_NUM; id++) {
+		memset(bucket, 0, sizeof(bucket));
+		total = sum = 0;
+		for_each_possible_cpu(cpu) {
+			pcpu = per_cpu_ptr(ctrl_hci->isr_hist, cpu);
+			for (b = 0; b < SSV6XXX_ISR_HIST_BUCKETS; b++)
+				bucket[b] += pcpu->bucket[id][b];
+			sum += pcpu->sum_ns[id];
 		}
-		hctl->rx_pkt++;
-		skb_put(rx_mpdu, dlen);
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		if (hctl->isr_mib_enable)
-			getnstimeofday(&rx_proc_start_time);
-#endif
-#if !defined(USE_THREAD_RX) || defined(USE_BATCH_RX)
-		__skb_queue_tail(&rx_list, rx_mpdu);
-#else
-		hctl->shi->hci_rx_cb(rx_mpdu, hctl->shi->rx_cb_args);
-#endif
-		HCI_IRQ_STATUS(hctl, &status);
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		if (hctl->isr_mib_enable) {
-			getnstimeofday(&rx_proc_end_time);
-			hctl->isr_rx_io_count++;
-			rx_io_diff_time =
-			    timespec_sub(rx_io_end_time, rx_io_start_time);
-			hctl->isr_rx_io_time +=
-			    timespec_to_ns(&rx_io_diff_time);
-			rx_proc_diff_time =
-			    timespec_sub(rx_proc_end_time, rx_proc_start_time);
-			hctl->isr_rx_proc_time +=
-			    timespec_to_ns(&rx_proc_diff_time);
+		for (b = 0; b < SSV6XXX_ISR_HIST_BUCKETS; b++)
+			total += bucket[b];
+		n += scnprintf(buf + n, len - n, "%s: count %llu", hist_name[id],
+			       total);
+		if (total) {
+			n += scnprintf(buf + n, len - n,
+				       " avg %llu p50 <%llu p99 <%llu p999 <%llu",
+				       div64_u64(sum, total),
+				       ssv6xxx_hci_hist_pct(bucket, total, 500),
+				       ssv6xxx_hci_hist_pct(bucket, total, 990),
+				       ssv6xxx_hci_hist_pct(bucket, total,
+							    999));
+		}
+		n += scnprintf(buf + n, len - n, "\n");
+		for (b = 0; b < SSV6XXX_ISR_HIST_BUCKETS; b++) {
+			if (bucket[b] == 0)
+				continue;
+			n += scnprintf(buf + n, len - n, "    <%llu: %u\n",
+				       1ULL << (b + 1), bucket[b]);
 		}
-#endif
-	}
-#if !defined(USE_THREAD_RX) || defined(USE_BATCH_RX)
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-	if (hctl->isr_mib_enable)
-		getnstimeofday(&rx_proc_start_time);
-#endif
-	hctl->shi->hci_rx_cb(&rx_list, hctl->shi->rx_cb_args);
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-	if (hctl->isr_mib_enable) {
-		getnstimeofday(&rx_proc_end_time);
-		rx_proc_diff_time =
-		    timespec_sub(rx_proc_end_time, rx_proc_start_time);
-		hctl->isr_rx_proc_time += timespec_to_ns(&rx_proc_diff_time);
 	}
-#endif
-#endif
-	return ret;
+	n += scnprintf(buf + n, len - n, "isr_miss_cnt: %u\n",
+		       ctrl_hci->isr_miss_cnt);
+	return n;
 }
 
-static void ssv6xxx_hci_rx_work(struct work_struct *work)
+static int _do_rx(struct ssv6xxx_hci_ctrl *hctl, u32 isr_status)
 {
-#if !defined(USE_THREAD_RX) || defined(USE_BATCH_RX)
 	struct sk_buff_head rx_list;
-#endif
+#if defined(USE_THREAD_RX) && !defined(USE_BATCH_RX)
 	struct sk_buff *rx_mpdu;
-	int rx_cnt, ret;
-	size_t dlen;
-	u32 status;
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-	struct timespec rx_io_start_time, rx_io_end_time, rx_io_diff_time;
-	struct timespec rx_proc_start_time, rx_proc_end_time, rx_proc_diff_time;
 #endif
-	ctrl_hci->rx_work_running = 1;
-#if !defined(USE_THREAD_RX) || defined(USE_BATCH_RX)
+	int rx_cnt = 0, ret = 0;
+	u32 status = isr_status;
+	s64 start_ns;
 	skb_queue_head_init(&rx_list);
-#endif
-	status = SSV6XXX_INT_RX;
-	for (rx_cnt = 0; (status & SSV6XXX_INT_RX) && (rx_cnt < 32); rx_cnt++) {
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		if (ctrl_hci->isr_mib_enable)
-			getnstimeofday(&rx_io_start_time);
-#endif
-		ret = IF_RECV(ctrl_hci, ctrl_hci->rx_buf->data, &dlen);
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		if (ctrl_hci->isr_mib_enable)
-			getnstimeofday(&rx_io_end_time);
-#endif
-		if (ret < 0 || dlen <= 0) {
-			pr_warn("%s(): IF_RECV() retruns %d (dlen=%d)\n",
-			       __FUNCTION__, ret, (int)dlen);
-			if (ret != -84 || dlen > MAX_FRAME_SIZE)
-				break;
-		}
-		rx_mpdu = ctrl_hci->rx_buf;
-		ctrl_hci->rx_buf = ssv_skb_alloc(MAX_FRAME_SIZE);
-		if (ctrl_hci->rx_buf == NULL) {
-			pr_err("RX buffer allocation failure!\n");
-			ctrl_hci->rx_buf = rx_mpdu;
+	while ((status & SSV6XXX_INT_RX) && (rx_cnt < SSV6XXX_RX_MAX_PER_ISR)) {
+		start_ns = ssv6xxx_hci_hist_start(hctl);
+		ret = ssv6xxx_hci_rx_batch(hctl, SSV6XXX_RX_MAX_PER_ISR - rx_cnt,
+					   &rx_list, &status);
+		if (ret <= 0)
 			break;
-		}
-		ctrl_hci->rx_pkt++;
-		skb_put(rx_mpdu, dlen);
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		if (ctrl_hci->isr_mib_enable)
-			getnstimeofday(&rx_proc_start_time);
-#endif
-#if !defined(USE_THREAD_RX) || defined(USE_BATCH_RX)
-		__skb_queue_tail(&rx_list, rx_mpdu);
-#else
-		ctrl_hci->shi->hci_rx_cb(rx_mpdu, ctrl_hci->shi->rx_cb_args);
-#endif
-		HCI_IRQ_STATUS(ctrl_hci, &status);
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		if (ctrl_hci->isr_mib_enable) {
-			getnstimeofday(&rx_proc_end_time);
-			ctrl_hci->isr_rx_io_count++;
-			rx_io_diff_time =
-			    timespec_sub(rx_io_end_time, rx_io_start_time);
-			ctrl_hci->isr_rx_io_time +=
-			    timespec_to_ns(&rx_io_diff_time);
-			rx_proc_diff_time =
-			    timespec_sub(rx_proc_end_time, rx_proc_start_time);
-			ctrl_hci->isr_rx_proc_time +=
-			    timespec_to_ns(&rx_proc_diff_time);
-		}
-#endif
+		ssv6xxx_hci_hist_end(hctl, SSV6XXX_HIST_RX_IO, start_ns);
+		rx_cnt += ret;
 	}
+	if (!skb_queue_empty(&rx_list)) {
+		start_ns = ssv6xxx_hci_hist_start(hctl);
 #if !defined(USE_THREAD_RX) || defined(USE_BATCH_RX)
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-	if (ctrl_hci->isr_mib_enable)
-		getnstimeofday(&rx_proc_start_time);
+		hctl->shi->hci_rx_cb(&rx_list, hctl->shi->rx_cb_args);
+#else
+		while ((rx_mpdu = __skb_dequeue(&rx_list)) != NULL)
+			hctl->shi->hci_rx_cb(rx_mpdu, hctl->shi->rx_cb_args);
 #endif
-	ctrl_hci->shi->hci_rx_cb(&rx_list, ctrl_hci->shi->rx_cb_args);
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-	if (ctrl_hci->isr_mib_enable) {
-		getnstimeofday(&rx_proc_end_time);
-		rx_proc_diff_time =
-		    timespec_sub(rx_proc_end_time, rx_proc_start_time);
-		ctrl_hci->isr_rx_proc_time +=
-		    timespec_to_ns(&rx_proc_diff_time);
+		ssv6xxx_hci_hist_end(hctl, SSV6XXX_HIST_RX_PROC, start_ns);
 	}
-#endif
-#endif
-	ctrl_hci->rx_work_running = 0;
+	if (skb_queue_len(&hctl->rx_ring) < SSV6XXX_RX_RING_LOW)
+		queue_work(hctl->hci_work_queue, &hctl->rx_refill_work);
+	return (rx_cnt > 0) ? rx_cnt : ret;
 }
 
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-static void ssv6xxx_isr_mib_reset(void)
+static void ssv6xxx_hci_rx_work(struct work_struct *work)
 {
-	ctrl_hci->isr_mib_reset = 0;
-	ctrl_hci->isr_total_time = 0;
-	ctrl_hci->isr_rx_io_time = 0;
-	ctrl_hci->isr_tx_io_time = 0;
-	ctrl_hci->isr_rx_io_count = 0;
-	ctrl_hci->isr_tx_io_count = 0;
-	ctrl_hci->isr_rx_proc_time = 0;
+	ctrl_hci->rx_work_running = 1;
+	_do_rx(ctrl_hci, SSV6XXX_INT_RX);
+	ctrl_hci->rx_work_running = 0;
 }
 
+#ifdef CONFIG_SSV6XXX_DEBUGFS
 static int hw_txq_len_open(struct inode *inode, struct file *filp)
 {
 	filp->private_data = inode->i_private;
@@ -619,8 +1204,11 @@ static ssize_t hw_txq_len_read(struct file *filp, char __user * buffer,
 		return -ENOMEM;
 	for (i = 0; i < SSV_HW_TXQ_NUM; i++) {
 		prt_size =
-		    snprintf(prn_ptr, buf_size, "\n\rhw_txq%d_len: %d", i,
-			     skb_queue_len(&hctl->hw_txq[i].qhead));
+		    snprintf(prn_ptr, buf_size,
+			     "\n\rhw_txq%d_len: %d bytes: %d limit: %u", i,
+			     skb_queue_len(&hctl->hw_txq[i].qhead),
+			     atomic_read(&hctl->hw_txq[i].qbytes),
+			     hctl->hw_txq[i].limit_bytes);
 		prn_ptr += prt_size;
 		buf_size -= prt_size;
 	}
@@ -637,8 +1225,65 @@ struct file_operations hw_txq_len_fops = {
 	.read = hw_txq_len_read,
 };
 
+static ssize_t bench_latency_read(struct file *filp, char __user * buffer,
+				  size_t count, loff_t * ppos)
+{
+	static const char *const dir_name[SSV6XXX_BENCH_DIR_NUM] =
+	    { "tx", "rx" };
+	struct ssv6xxx_hci_bench_stat stat;
+	char summary_buf[256];
+	int len = 0, dir;
+	if (ssv6xxx_hci_bench_stat(&stat))
+		return -ENOMEM;
+	for (dir = 0; dir < SSV6XXX_BENCH_DIR_NUM; dir++) {
+		len += snprintf(summary_buf + len, sizeof(summary_buf) - len,
+				"%s: frames %u bytes %llu samples %u "
+				"p50 %u p99 %u p999 %u ns\n", dir_name[dir],
+				stat.frames[dir], stat.bytes[dir],
+				stat.samples[dir], stat.p50_ns[dir],
+				stat.p99_ns[dir], stat.p999_ns[dir]);
+	}
+	return simple_read_from_buffer(buffer, count, ppos, summary_buf, len);
+}
+
+static ssize_t isr_hist_read(struct file *filp, char __user * buffer,
+			     size_t count, loff_t * ppos)
+{
+	ssize_t ret;
+	char *summary_buf = kzalloc(4096, GFP_KERNEL);
+	int len;
+	if (!summary_buf)
+		return -ENOMEM;
+	len = ssv6xxx_hci_isr_hist_show(summary_buf, 4096);
+	ret = simple_read_from_buffer(buffer, count, ppos, summary_buf, len);
+	kfree(summary_buf);
+	return ret;
+}
+
+static ssize_t isr_hist_write(struct file *filp, const char __user * buffer,
+			      size_t count, loff_t * ppos)
+{
+	ssv6xxx_hci_isr_hist_reset();
+	return count;
+}
+
+struct file_operations isr_hist_fops = {
+	.owner = THIS_MODULE,
+	.open = hw_txq_len_open,
+	.read = isr_hist_read,
+	.write = isr_hist_write,
+};
+
+struct file_operations bench_latency_fops = {
+	.owner = THIS_MODULE,
+	.open = hw_txq_len_open,
+	.read = bench_latency_read,
+};
+
 bool ssv6xxx_hci_init_debugfs(struct dentry *dev_deugfs_dir)
 {
+	char name[16];
+	int i;
 	ctrl_hci->debugfs_dir = debugfs_create_dir("hci", dev_deugfs_dir);
 	if (ctrl_hci->debugfs_dir == NULL) {
 		dev_err(ctrl_hci->shi->dev,
@@ -647,24 +1292,25 @@ bool ssv6xxx_hci_init_debugfs(struct dentry *dev_deugfs_dir)
 	}
 	debugfs_create_u32("TXQ_mask", 00444, ctrl_hci->debugfs_dir,
 			   &ctrl_hci->txq_mask);
-	debugfs_create_u32("hci_isr_mib_enable", 00644, ctrl_hci->debugfs_dir,
-			   &ctrl_hci->isr_mib_enable);
-	debugfs_create_u32("hci_isr_mib_reset", 00644, ctrl_hci->debugfs_dir,
-			   &ctrl_hci->isr_mib_reset);
-	debugfs_create_u64("isr_total_time", 00444, ctrl_hci->debugfs_dir,
-			   &ctrl_hci->isr_total_time);
-	debugfs_create_u64("tx_io_time", 00444, ctrl_hci->debugfs_dir,
-			   &ctrl_hci->isr_tx_io_time);
-	debugfs_create_u64("rx_io_time", 00444, ctrl_hci->debugfs_dir,
-			   &ctrl_hci->isr_rx_io_time);
-	debugfs_create_u32("tx_io_count", 00444, ctrl_hci->debugfs_dir,
-			   &ctrl_hci->isr_tx_io_count);
-	debugfs_create_u32("rx_io_count", 00444, ctrl_hci->debugfs_dir,
-			   &ctrl_hci->isr_rx_io_count);
-	debugfs_create_u64("rx_proc_time", 00444, ctrl_hci->debugfs_dir,
-			   &ctrl_hci->isr_rx_proc_time);
+	debugfs_create_u32("isr_hist_enable", 00644, ctrl_hci->debugfs_dir,
+			   &ctrl_hci->isr_hist_enable);
+	debugfs_create_file("isr_hist", 00644, ctrl_hci->debugfs_dir,
+			    ctrl_hci, &isr_hist_fops);
+	for (i = 0; i < SSV_HW_TXQ_NUM; i++) {
+		snprintf(name, sizeof(name), "TXQ%d_weight", i);
+		debugfs_create_u32(name, 00644, ctrl_hci->debugfs_dir,
+				   &ctrl_hci->hw_txq[i].weight);
+	}
 	debugfs_create_file("hw_txq_len", 00444, ctrl_hci->debugfs_dir,
 			    ctrl_hci, &hw_txq_len_fops);
+	debugfs_create_u32("rx_copybreak", 00644, ctrl_hci->debugfs_dir,
+			   &ctrl_hci->rx_copybreak);
+	debugfs_create_file("bench_latency", 00444, ctrl_hci->debugfs_dir,
+			    ctrl_hci, &bench_latency_fops);
+	debugfs_create_u32("rx_copybreak_count", 00444, ctrl_hci->debugfs_dir,
+			   &ctrl_hci->rx_copybreak_cnt);
+	debugfs_create_u32("tx_gather_count", 00444, ctrl_hci->debugfs_dir,
+			   &ctrl_hci->tx_gather_cnt);
 	return true;
 }
 
@@ -675,34 +1321,6 @@ void ssv6xxx_hci_deinit_debugfs(void)
 	ctrl_hci->debugfs_dir = NULL;
 }
 #endif
-static int _isr_do_rx(struct ssv6xxx_hci_ctrl *hctl, u32 isr_status)
-{
-	int status;
-	u32 before = jiffies;
-
-	if (hctl->isr_summary_eable && hctl->prev_rx_isr_jiffes) {
-		if (hctl->isr_rx_idle_time) {
-			hctl->isr_rx_idle_time +=
-			    (jiffies - hctl->prev_rx_isr_jiffes);
-			hctl->isr_rx_idle_time = hctl->isr_rx_idle_time >> 1;
-		} else {
-			hctl->isr_rx_idle_time +=
-			    (jiffies - hctl->prev_rx_isr_jiffes);
-		}
-	}
-	status = _do_rx(hctl, isr_status);
-	if (hctl->isr_summary_eable) {
-		if (hctl->isr_rx_time) {
-			hctl->isr_rx_time += (jiffies - before);
-			hctl->isr_rx_time = hctl->isr_rx_time >> 1;
-		} else {
-			hctl->isr_rx_time += (jiffies - before);
-		}
-		hctl->prev_rx_isr_jiffes = jiffies;
-	}
-	return status;
-}
-
 static int _do_tx(struct ssv6xxx_hci_ctrl *hctl, u32 status)
 {
 	int q_num;
@@ -710,43 +1328,16 @@ static int _do_tx(struct ssv6xxx_hci_ctrl *hctl, u32 status)
 	u32 to_disable_int = 1;
 	unsigned long flags;
 	struct ssv_hw_txq *hw_txq;
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-	struct timespec tx_io_start_time, tx_io_end_time, tx_io_diff_time;
-#endif
 #ifdef CONFIG_IRQ_DEBUG_COUNT
 	if ((!(status & SSV6XXX_INT_RX)) && htcl->irq_enable)
 		hctl->tx_irq_count++;
 #endif
 	if ((status & SSV6XXX_INT_RESOURCE_LOW) == 0)
 		return 0;
-	for (q_num = (SSV_HW_TXQ_NUM - 1); q_num >= 0; q_num--) {
-		u32 before = jiffies;
-		hw_txq = &hctl->hw_txq[q_num];
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		if (hctl->isr_mib_enable)
-			getnstimeofday(&tx_io_start_time);
-#endif
-		tx_count += ssv6xxx_hci_tx_handler(hw_txq, 999);
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		if (hctl->isr_mib_enable) {
-			getnstimeofday(&tx_io_end_time);
-			tx_io_diff_time =
-			    timespec_sub(tx_io_end_time, tx_io_start_time);
-			hctl->isr_tx_io_time +=
-			    timespec_to_ns(&tx_io_diff_time);
-		}
-#endif
-		if (hctl->isr_summary_eable) {
-			if (hctl->isr_tx_time) {
-				hctl->isr_tx_time += (jiffies - before);
-				hctl->isr_tx_time = hctl->isr_tx_time >> 1;
-			} else {
-				hctl->isr_tx_time += (jiffies - before);
-			}
-		}
-	}
+	tx_count = ssv6xxx_hci_tx_schedule(hctl);
 	mutex_lock(&hctl->hci_mutex);
-	spin_lock_irqsave(&hctl->int_lock, flags);
+	clear_bit(SSV6XXX_TX_IRQ_ARMED, &hctl->tx_irq_state);
+	smp_mb__after_atomic();
 	for (q_num = (SSV_HW_TXQ_NUM - 1); q_num >= 0; q_num--) {
 		hw_txq = &hctl->hw_txq[q_num];
 		if (skb_queue_len(&hw_txq->qhead) > 0) {
@@ -756,12 +1347,13 @@ static int _do_tx(struct ssv6xxx_hci_ctrl *hctl, u32 status)
 	}
 	if (to_disable_int) {
 		u32 reg_val;
+		spin_lock_irqsave(&hctl->int_lock, flags);
 		hctl->int_mask &= ~(SSV6XXX_INT_RESOURCE_LOW | SSV6XXX_INT_TX);
 		reg_val = ~hctl->int_mask;
 		spin_unlock_irqrestore(&hctl->int_lock, flags);
 		HCI_IRQ_SET_MASK(hctl, reg_val);
 	} else {
-		spin_unlock_irqrestore(&hctl->int_lock, flags);
+		set_bit(SSV6XXX_TX_IRQ_ARMED, &hctl->tx_irq_state);
 	}
 	mutex_unlock(&hctl->hci_mutex);
 	return tx_count;
@@ -774,32 +1366,21 @@ irqreturn_t ssv6xxx_hci_isr(int irq, void *args)
 	unsigned long flags;
 	int ret = IRQ_HANDLED;
 	bool dbg_isr_miss = true;
-	if (ctrl_hci->isr_summary_eable && ctrl_hci->prev_isr_jiffes) {
-		if (ctrl_hci->isr_idle_time) {
-			ctrl_hci->isr_idle_time +=
-			    (jiffies - ctrl_hci->prev_isr_jiffes);
-			ctrl_hci->isr_idle_time = ctrl_hci->isr_idle_time >> 1;
-		} else {
-			ctrl_hci->isr_idle_time +=
-			    (jiffies - ctrl_hci->prev_isr_jiffes);
-		}
-	}
+	s64 start_ns;
 	BUG_ON(!args);
+	start_ns = ssv6xxx_hci_hist_start(hctl);
+	if (start_ns && hctl->prev_isr_ns)
+		ssv6xxx_hci_hist_add(hctl, SSV6XXX_HIST_IRQ_GAP,
+				     start_ns - hctl->prev_isr_ns);
+	hctl->prev_isr_ns = start_ns;
 	do {
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		struct timespec start_time, end_time, diff_time;
-		if (hctl->isr_mib_reset)
-			ssv6xxx_isr_mib_reset();
-		if (hctl->isr_mib_enable)
-			getnstimeofday(&start_time);
-#endif
 #ifdef CONFIG_IRQ_DEBUG_COUNT
 		if (ctrl_hci->irq_enable)
 			ctrl_hci->irq_count++;
 #endif
-		mutex_lock(&hctl->hci_mutex);
-		if (hctl->int_status) {
+		if (READ_ONCE(hctl->int_status)) {
 			u32 regval;
+			mutex_lock(&hctl->hci_mutex);
 			spin_lock_irqsave(&hctl->int_lock, flags);
 			hctl->int_mask |= hctl->int_status;
 			hctl->int_status = 0;
@@ -807,24 +1388,23 @@ irqreturn_t ssv6xxx_hci_isr(int irq, void *args)
 			smp_mb();
 			spin_unlock_irqrestore(&hctl->int_lock, flags);
 			HCI_IRQ_SET_MASK(hctl, regval);
+			mutex_unlock(&hctl->hci_mutex);
 		}
 		ret = HCI_IRQ_STATUS(hctl, &status);
-		if ((ret < 0) || ((status & hctl->int_mask) == 0)) {
+		spin_lock_irqsave(&hctl->int_lock, flags);
+		status &= hctl->int_mask;
+		spin_unlock_irqrestore(&hctl->int_lock, flags);
+		if ((ret < 0) || (status == 0)) {
 #ifdef CONFIG_IRQ_DEBUG_COUNT
 			if (ctrl_hci->irq_enable)
 				ctrl_hci->invalid_irq_count++;
 #endif
-			mutex_unlock(&hctl->hci_mutex);
 			ret = IRQ_NONE;
 			break;
 		}
-		spin_lock_irqsave(&hctl->int_lock, flags);
-		status &= hctl->int_mask;
-		spin_unlock_irqrestore(&hctl->int_lock, flags);
-		mutex_unlock(&hctl->hci_mutex);
 		ctrl_hci->isr_running = 1;
 		if (status & SSV6XXX_INT_RX) {
-			ret = _isr_do_rx(hctl, status);
+			ret = _do_rx(hctl, status);
 			if (ret < 0) {
 				ret = IRQ_NONE;
 				break;
@@ -835,18 +1415,11 @@ irqreturn_t ssv6xxx_hci_isr(int irq, void *args)
 			dbg_isr_miss = false;
 		}
 		ctrl_hci->isr_running = 0;
-#ifdef CONFIG_SSV6XXX_DEBUGFS
-		if (ctrl_hci->isr_mib_enable) {
-			getnstimeofday(&end_time);
-			diff_time = timespec_sub(end_time, start_time);
-			ctrl_hci->isr_total_time += timespec_to_ns(&diff_time);
-		}
-#endif
 	} while (1);
-	if (ctrl_hci->isr_summary_eable) {
+	if (start_ns) {
+		ssv6xxx_hci_hist_end(hctl, SSV6XXX_HIST_ISR, start_ns);
 		if (dbg_isr_miss)
-			ctrl_hci->isr_miss_cnt++;
-		ctrl_hci->prev_isr_jiffes = jiffies;
+			hctl->isr_miss_cnt++;
 	}
 	return ret;
 }
@@ -856,6 +1429,7 @@ static struct ssv6xxx_hci_ops hci_ops = {
 	.hci_stop = ssv6xxx_hci_stop,
 	.hci_read_word = ssv6xxx_hci_read_word,
 	.hci_write_word = ssv6xxx_hci_write_word,
+	.hci_write_word_batch = ssv6xxx_hci_write_word_batch,
 	.hci_tx = ssv6xxx_hci_enqueue,
 	.hci_tx_pause = ssv6xxx_hci_txq_pause,
 	.hci_tx_resume = ssv6xxx_hci_txq_resume,
@@ -871,6 +1445,13 @@ static struct ssv6xxx_hci_ops hci_ops = {
 	.hci_deinit_debugfs = ssv6xxx_hci_deinit_debugfs,
 #endif
 	.hci_interface_reset = ssv6xxx_hci_interface_reset,
+	.hci_reg_shadow_invalidate = ssv6xxx_hci_reg_shadow_invalidate,
+	.hci_bench_start = ssv6xxx_hci_bench_start,
+	.hci_bench_stop = ssv6xxx_hci_bench_stop,
+	.hci_bench_stat = ssv6xxx_hci_bench_stat,
+	.hci_bench_rx_done = ssv6xxx_hci_bench_rx_done,
+	.hci_isr_hist_reset = ssv6xxx_hci_isr_hist_reset,
+	.hci_isr_hist_show = ssv6xxx_hci_isr_hist_show,
 };
 
 int ssv6xxx_hci_deregister(void)
@@ -905,27 +1486,25 @@ int ssv6xxx_hci_register(struct ssv6xxx_hci_info *shi)
 		skb_queue_head_init(&ctrl_hci->hw_txq[i].qhead);
 		ctrl_hci->hw_txq[i].txq_no = (u32) i;
 		ctrl_hci->hw_txq[i].max_qsize = SSV_HW_TXQ_MAX_SIZE;
-		ctrl_hci->hw_txq[i].resum_thres = SSV_HW_TXQ_RESUME_THRES;
+		atomic_set(&ctrl_hci->hw_txq[i].qbytes, 0);
+		ctrl_hci->hw_txq[i].limit_bytes = SSV_HW_TXQ_MIN_LIMIT;
+		ctrl_hci->hw_txq[i].weight = ssv6xxx_hci_txq_weight[i];
 	}
 	ctrl_hci->hci_work_queue =
 	    create_singlethread_workqueue("ssv6xxx_hci_wq");
 	INIT_WORK(&ctrl_hci->hci_rx_work, ssv6xxx_hci_rx_work);
 	INIT_WORK(&ctrl_hci->hci_tx_work, ssv6xxx_hci_tx_work);
+	INIT_WORK(&ctrl_hci->rx_refill_work, ssv6xxx_hci_rx_refill_work);
 	ctrl_hci->int_mask = SSV6XXX_INT_RX | SSV6XXX_INT_RESOURCE_LOW;
 	ctrl_hci->int_status = 0;
+	ctrl_hci->tx_irq_state = (1 << SSV6XXX_TX_IRQ_ARMED);
 	HCI_IRQ_SET_MASK(ctrl_hci, 0xFFFFFFFF);
 	ssv6xxx_hci_irq_disable();
 	HCI_IRQ_REQUEST(ctrl_hci, ssv6xxx_hci_isr);
+	ctrl_hci->isr_hist_enable = 0;
+	ssv6xxx_hci_isr_hist_reset();
 #ifdef CONFIG_SSV6XXX_DEBUGFS
 	ctrl_hci->debugfs_dir = NULL;
-	ctrl_hci->isr_mib_enable = false;
-	ctrl_hci->isr_mib_reset = 0;
-	ctrl_hci->isr_total_time = 0;
-	ctrl_hci->isr_rx_io_time = 0;
-	ctrl_hci->isr_tx_io_time = 0;
-	ctrl_hci->isr_rx_io_count = 0;
-	ctrl_hci->isr_tx_io_count = 0;
-	ctrl_hci->isr_rx_proc_time = 0;
 #endif
 	return 0;
 }
@@ -940,8 +1519,18 @@ int ssv6xxx_hci_init(void)
 	if (ctrl_hci == NULL)
 		return -ENOMEM;
 	memset((void *)ctrl_hci, 0, sizeof(*ctrl_hci));
-	ctrl_hci->rx_buf = ssv_skb_alloc(MAX_FRAME_SIZE);
-	if (ctrl_hci->rx_buf == NULL) {
+	mutex_init(&ctrl_hci->reg_shadow_lock);
+	spin_lock_init(&ctrl_hci->bench_lock);
+	ctrl_hci->rx_copybreak = SSV6XXX_RX_COPYBREAK;
+	ctrl_hci->isr_hist = alloc_percpu(struct ssv6xxx_isr_hist);
+	if (ctrl_hci->isr_hist == NULL) {
+		kfree(ctrl_hci);
+		return -ENOMEM;
+	}
+	skb_queue_head_init(&ctrl_hci->rx_ring);
+	if (ssv6xxx_hci_rx_ring_fill(ctrl_hci) < 0) {
+		skb_queue_purge(&ctrl_hci->rx_ring);
+		free_percpu(ctrl_hci->isr_hist);
 		kfree(ctrl_hci);
 		return -ENOMEM;
 	}
@@ -956,6 +1545,10 @@ void ssv6xxx_hci_exit(void)
 #ifdef CONFIG_SSV6200_CLI_ENABLE
 	extern struct ssv6xxx_hci_ctrl *ssv_dbg_ctrl_hci;
 #endif
+	skb_queue_purge(&ctrl_hci->rx_ring);
+	vfree(ctrl_hci->bench_lat[SSV6XXX_BENCH_TX].ns);
+	vfree(ctrl_hci->bench_lat[SSV6XXX_BENCH_RX].ns);
+	free_percpu(ctrl_hci->isr_hist);
 	kfree(ctrl_hci);
 	ctrl_hci = NULL;
 #ifdef CONFIG_SSV6200_CLI_ENABLE
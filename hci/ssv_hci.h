@@ -18,14 +18,41 @@
 #define _SSV_HCI_H_
 #define SSV_HW_TXQ_NUM 5
 #define SSV_HW_TXQ_MAX_SIZE 64
-#define SSV_HW_TXQ_RESUME_THRES ((SSV_HW_TXQ_MAX_SIZE >> 2) *3)
+#define SSV_HW_TXQ_TARGET_DELAY_MS 2
+#define SSV_HW_TXQ_RATE_INTERVAL_US 10000
+#define SSV_HW_TXQ_MIN_LIMIT (8 * 1024)
+#define SSV_HW_TXQ_MAX_LIMIT (96 * 1024)
+#define SSV_HW_TXQ_WEIGHT_BK 4
+#define SSV_HW_TXQ_WEIGHT_BE 8
+#define SSV_HW_TXQ_WEIGHT_VI 12
+#define SSV_HW_TXQ_WEIGHT_VO 16
+#define SSV_HW_TXQ_WEIGHT_MGMT 16
 #define HCI_FLAGS_ENQUEUE_HEAD 0x00000001
 #define HCI_FLAGS_NO_FLOWCTRL 0x00000002
+#define SSV6XXX_BENCH_TX 0
+#define SSV6XXX_BENCH_RX 1
+#define SSV6XXX_BENCH_DIR_NUM 2
+struct ssv6xxx_reg_batch;
+struct ssv6xxx_hci_bench_stat {
+	u32 frames[SSV6XXX_BENCH_DIR_NUM];
+	u64 bytes[SSV6XXX_BENCH_DIR_NUM];
+	u32 samples[SSV6XXX_BENCH_DIR_NUM];
+	u32 p50_ns[SSV6XXX_BENCH_DIR_NUM];
+	u32 p99_ns[SSV6XXX_BENCH_DIR_NUM];
+	u32 p999_ns[SSV6XXX_BENCH_DIR_NUM];
+};
 struct ssv_hw_txq {
 	u32 txq_no;
 	struct sk_buff_head qhead;
 	int max_qsize;
-	int resum_thres;
+	atomic_t qbytes;
+	u32 limit_bytes;
+	u32 drain_rate;
+	u32 done_bytes;
+	ktime_t done_start;
+	u32 weight;
+	int deficit;
+	u32 updated_head;
 	bool paused;
 	u32 tx_pkt;
 	u32 tx_flags;
@@ -35,6 +62,8 @@ struct ssv6xxx_hci_ops {
 	int (*hci_stop)(void);
 	int (*hci_read_word)(u32 addr, u32 * regval);
 	int (*hci_write_word)(u32 addr, u32 regval);
+	int (*hci_write_word_batch)(const struct ssv6xxx_reg_batch *regs,
+				    u32 count);
 	int (*hci_load_fw)(u8 * firmware_name, u8 openfile);
 	int (*hci_tx)(struct sk_buff *, int, u32);
 	int (*hci_tx_pause)(u32 txq_mask);
@@ -50,6 +79,13 @@ struct ssv6xxx_hci_ops {
 #endif
 	int (*hci_write_sram)(u32 addr, u8 * data, u32 size);
 	int (*hci_interface_reset)(void);
+	void (*hci_reg_shadow_invalidate)(void);
+	int (*hci_bench_start)(void);
+	void (*hci_bench_stop)(void);
+	int (*hci_bench_stat)(struct ssv6xxx_hci_bench_stat *stat);
+	void (*hci_bench_rx_done)(struct sk_buff *skb);
+	void (*hci_isr_hist_reset)(void);
+	int (*hci_isr_hist_show)(char *buf, size_t len);
 };
 struct ssv6xxx_hci_info {
 	struct device *dev;
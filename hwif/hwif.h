@@ -47,11 +47,16 @@
     SSV_REG_WRITE(sh, reg, reg_val); \
 }
 #endif
+struct ssv6xxx_reg_batch {
+    u32 addr;
+    u32 value;
+};
 struct ssv6xxx_hwif_ops {
     int __must_check (*read)(struct device *child, void *buf,size_t *size);
     int __must_check (*write)(struct device *child, void *buf, size_t len,u8 queue_num);
     int __must_check (*readreg)(struct device *child, u32 addr, u32 *buf);
     int __must_check (*writereg)(struct device *child, u32 addr, u32 buf);
+    int __must_check (*writereg_batch)(struct device *child, const struct ssv6xxx_reg_batch *regs, u32 count);
     int (*trigger_tx_rx)(struct device *child);
     int (*irq_getmask)(struct device *child, u32 *mask);
     void (*irq_setmask)(struct device *child,int mask);
@@ -66,6 +71,9 @@ struct ssv6xxx_hwif_ops {
     int (*cmd52_write)(struct device *child, u32 addr, u32 value);
     bool (*support_scatter)(struct device *child);
     int (*rw_scatter)(struct device *child, struct sdio_scatter_req *scat_req);
+    int __must_check (*write_scatter)(struct device *child, struct sdio_scatter_req *scat_req, u8 queue_num);
+    int __must_check (*read_scatter)(struct device *child, struct sdio_scatter_req *scat_req, int *status);
+    int __must_check (*write_gather)(struct device *child, struct sdio_gather_req *gather_req, u8 queue_num);
     bool (*is_ready)(struct device *child);
     int (*write_sram)(struct device *child, u32 addr, u8 *data, u32 size);
     void (*interface_reset)(struct device *child);
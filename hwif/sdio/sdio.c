@@ -72,6 +72,9 @@ struct ssv6xxx_sdio_glue {
 	struct device *dev;
 	struct platform_device *core;
 	struct sk_buff *dma_skb;
+	u8 *gather_buf;
+	size_t gather_buf_len;
+	u8 *zero_pad;
 #ifdef CONFIG_PM
 	struct sk_buff *cmd_skb;
 #endif
@@ -213,6 +216,38 @@ ssv6xxx_sdio_write_reg(struct device *child, u32 addr, u32 buf)
 	return ret;
 }
 
+static int __must_check
+ssv6xxx_sdio_write_reg_batch(struct device *child,
+			     const struct ssv6xxx_reg_batch *regs, u32 count)
+{
+	int ret = 0;
+	u32 i;
+	struct ssv6xxx_sdio_glue *glue = dev_get_drvdata(child->parent);
+	struct sdio_func *func;
+
+    u32 data[2];
+
+    ret_if_not_ready(-1);
+
+    func = dev_to_sdio_func(glue->dev);
+
+    sdio_claim_host(func);
+    for (i = 0; i < count; i++) {
+        data[0] = regs[i].addr;
+        data[1] = regs[i].value;
+
+        ret = sdio_memcpy_toio(func, glue->ioport_reg, data, sizeof(data));
+        if (unlikely(ret)) {
+            dev_err(child->parent, "sdio batch write reg 0x%08x failed (%d)\n",
+                    regs[i].addr, ret);
+            break;
+        }
+    }
+    sdio_release_host(func);
+
+	return ret;
+}
+
 static int
 ssv6xxx_sdio_write_sram(struct device *child, u32 addr, u8 * data, u32 size)
 {
@@ -506,6 +541,8 @@ ssv6xxx_sdio_read(struct device *child, void *buf, size_t *size)
 
     if (unlikely(ret)) {
         dev_err(child->parent, "sdio read failed size ret[%d]\n", ret);
+        if (ret == -EILSEQ)
+            *size = data_size;
         goto out;
     }
     
@@ -518,6 +555,74 @@ out:
 	return ret;
 }
 
+/*
+ * Read up to scat_entries pending frames while holding the host once.
+ * Each scat_list entry holds a buffer and its capacity on entry and the
+ * received frame length on return. The interrupt status is re-read after
+ * every frame and the batch ends as soon as no RX is pending; the last
+ * status read is returned through status so the caller can skip its own
+ * status poll. A CRC error (-EILSEQ) on the data transfer keeps the frame
+ * and the batch going, as the single-frame path always has.
+ */
+static int __must_check
+ssv6xxx_sdio_read_scatter(struct device *child,
+			  struct sdio_scatter_req *scat_req, int *status)
+{
+	int ret = 0, i;
+	u32 data_size;
+	struct ssv6xxx_sdio_glue *glue = dev_get_drvdata(child->parent);
+	struct sdio_func *func;
+
+    ret_if_not_ready(-1);
+
+    func = dev_to_sdio_func(glue->dev);
+    sdio_claim_host(func);
+
+    *status = 0;
+    for (i = 0; i < scat_req->scat_entries;) {
+        data_size = sdio_readb(func, REG_CARD_PKT_LEN_0, &ret);
+        if (unlikely(ret))
+            break;
+
+        data_size = data_size | (sdio_readb(func, REG_CARD_PKT_LEN_1, &ret) << 0x8);
+        if (unlikely(ret))
+            break;
+
+        if (unlikely((data_size == 0) || (data_size > scat_req->scat_list[i].len))) {
+            dev_err(child->parent, "sdio read invalid frame size %d\n", data_size);
+            ret = -EIO;
+            break;
+        }
+
+        ret = sdio_memcpy_fromio(func, scat_req->scat_list[i].buf, glue->ioport_data,
+                                 sdio_align_size(func, data_size));
+        if (unlikely(ret == -EILSEQ)) {
+            dev_warn(child->parent, "sdio read CRC error at %d, len=%d\n", i, data_size);
+            ret = 0;
+        }
+        if (unlikely(ret))
+            break;
+
+        scat_req->scat_list[i++].len = data_size;
+
+        *status = sdio_readb(func, REG_INT_STATUS, &ret);
+        if (unlikely(ret) || !(*status & SDIO_INT_STATUS_RX))
+            break;
+    }
+
+    if (unlikely(ret)) {
+        dev_err(child->parent, "sdio scatter read failed at %d/%d, ret=%d\n",
+                i, scat_req->scat_entries, ret);
+        *status = 0;
+    }
+
+    scat_req->scat_entries = i;
+
+    sdio_release_host(func);
+
+	return ret;
+}
+
 static int __must_check
 ssv6xxx_sdio_write(struct device *child, void *buf, size_t len, u8 queue_num)
 {
@@ -554,6 +659,57 @@ ssv6xxx_sdio_write(struct device *child, void *buf, size_t len, u8 queue_num)
 
 }
 
+/*
+ * The data port treats every CMD53 as one frame, so a batch cannot be
+ * merged into a single block transfer like rw_scatter does. Instead the
+ * host is claimed once and each entry is written back to back. On error,
+ * scat_entries is updated to the number of frames actually written.
+ */
+static int __must_check
+ssv6xxx_sdio_write_scatter(struct device *child,
+			   struct sdio_scatter_req *scat_req, u8 queue_num)
+{
+	int ret = 0, i;
+	struct ssv6xxx_sdio_glue *glue = dev_get_drvdata(child->parent);
+	struct sdio_func *func;
+	void *ptr;
+	size_t len;
+
+    ret_if_not_ready(-1);
+
+    func = dev_to_sdio_func(glue->dev);
+
+    sdio_claim_host(func);
+
+    for (i = 0; i < scat_req->scat_entries; i++) {
+        ptr = scat_req->scat_list[i].buf;
+        len = scat_req->scat_list[i].len;
+#ifdef CONFIG_ARM64
+        if (((u64) ptr) & 3) {
+#else
+        if (((u32) ptr) & 3) {
+#endif
+            memcpy(glue->dma_skb->data, ptr, len);
+            ptr = glue->dma_skb->data;
+        }
+
+        ret = sdio_memcpy_toio(func, glue->ioport_data, ptr,
+                               sdio_align_size(func, len));
+
+        if (unlikely(ret)) {
+            dev_err(glue->dev, "sdio scatter write failed at %d/%d, ret=%d\n",
+                    i, scat_req->scat_entries, ret);
+            scat_req->scat_entries = i;
+            break;
+        }
+    }
+
+    sdio_release_host(func);
+
+    return ret;
+
+}
+
 static void ssv6xxx_sdio_irq_handler(struct sdio_func *func)
 {
 	int status;
@@ -874,6 +1030,113 @@ ssv6xxx_sdio_rw_scatter(struct device *child, struct sdio_scatter_req *scat_req)
 
 }
 
+static bool
+ssv6xxx_sdio_gather_dma_ok(struct sdio_func *func,
+			   struct sdio_gather_req *gather_req, size_t len)
+{
+	struct mmc_host *host = func->card->host;
+	int i;
+	if (!func->card->cccr.multi_block || (len % func->cur_blksize)
+	    || (len > host->max_req_size)
+	    || ((len / func->cur_blksize) > host->max_blk_count)
+	    || (gather_req->entries + 1 > host->max_segs)
+	    || (gather_req->entries + 1 > MAX_GATHER_ENTRIES_PER_REQ))
+		return false;
+	for (i = 0; i < gather_req->entries; i++) {
+		if ((((unsigned long)gather_req->list[i].buf) & 3)
+		    || (gather_req->list[i].len & 3)
+		    || (gather_req->list[i].len > host->max_seg_size))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Write one frame from several buffers with a single block mode CMD53,
+ * the last sg entry padding the transfer up to the block size from a
+ * zeroed buffer. When the host cannot take the list as is, the frame goes
+ * through a bounce buffer.
+ */
+static int __must_check
+ssv6xxx_sdio_write_gather(struct device *child,
+			  struct sdio_gather_req *gather_req, u8 queue_num)
+{
+	struct ssv6xxx_sdio_glue *glue = dev_get_drvdata(child->parent);
+	struct sdio_func *func;
+	struct mmc_request mmc_req;
+	struct mmc_command cmd;
+	struct mmc_data data;
+	struct scatterlist *sg;
+	size_t len, pad;
+	u8 *ptr;
+	int i, ret;
+
+    ret_if_not_ready(-1);
+
+    func = dev_to_sdio_func(glue->dev);
+    len = sdio_align_size(func, gather_req->len);
+
+    if ((glue->zero_pad == NULL) || (func->cur_blksize > SDIO_DEF_BLOCK_SIZE)
+        || !ssv6xxx_sdio_gather_dma_ok(func, gather_req, len))
+        goto bounce;
+
+    memset(&mmc_req, 0, sizeof(struct mmc_request));
+    memset(&cmd, 0, sizeof(struct mmc_command));
+    memset(&data, 0, sizeof(struct mmc_data));
+    sg = gather_req->sgentries;
+    pad = len - gather_req->len;
+    sg_init_table(sg, gather_req->entries + (pad ? 1 : 0));
+    for (i = 0; i < gather_req->entries; i++)
+        sg_set_buf(&sg[i], gather_req->list[i].buf, gather_req->list[i].len);
+    if (pad)
+        sg_set_buf(&sg[i++], glue->zero_pad, pad);
+    data.sg = sg;
+    data.sg_len = i;
+    data.blksz = func->cur_blksize;
+    data.blocks = len / func->cur_blksize;
+    data.flags = MMC_DATA_WRITE;
+    ssv6xxx_sdio_set_cmd53_arg(&cmd.arg, CMD53_ARG_WRITE, func->num,
+                    CMD53_ARG_BLOCK_BASIS, CMD53_ARG_FIXED_ADDRESS,
+                    glue->ioport_data, data.blocks);
+    cmd.opcode = SD_IO_RW_EXTENDED;
+    cmd.flags = MMC_RSP_SPI_R5 | MMC_RSP_R5 | MMC_CMD_ADTC;
+    mmc_req.cmd = &cmd;
+    mmc_req.data = &data;
+
+    sdio_claim_host(func);
+    mmc_set_data_timeout(&data, func->card);
+    mmc_wait_for_req(func->card->host, &mmc_req);
+    sdio_release_host(func);
+
+    ret = cmd.error ? cmd.error : data.error;
+    if (unlikely(ret))
+        dev_err(glue->dev, "sdio gather write failed, ret=%d\n", ret);
+    return ret;
+
+bounce:
+    if (glue->gather_buf_len < len) {
+        kfree(glue->gather_buf);
+        glue->gather_buf = kmalloc(len, GFP_KERNEL);
+        glue->gather_buf_len = glue->gather_buf ? len : 0;
+        if (glue->gather_buf == NULL)
+            return -ENOMEM;
+    }
+    ptr = glue->gather_buf;
+    for (i = 0; i < gather_req->entries; i++) {
+        memcpy(ptr, gather_req->list[i].buf, gather_req->list[i].len);
+        ptr += gather_req->list[i].len;
+    }
+    memset(ptr, 0, len - gather_req->len);
+
+    sdio_claim_host(func);
+    ret = sdio_memcpy_toio(func, glue->ioport_data, glue->gather_buf, len);
+    sdio_release_host(func);
+
+    if (unlikely(ret))
+        dev_err(glue->dev, "sdio gather write failed, ret=%d\n", ret);
+    return ret;
+}
+
 static void ssv6xxx_set_sdio_clk(struct sdio_func *func, u32 sdio_hz)
 {
 	struct mmc_host *host;
@@ -907,6 +1170,7 @@ static struct ssv6xxx_hwif_ops sdio_ops = {
 	.write = ssv6xxx_sdio_write,
 	.readreg = ssv6xxx_sdio_read_reg,
 	.writereg = ssv6xxx_sdio_write_reg,
+	.writereg_batch = ssv6xxx_sdio_write_reg_batch,
 #ifdef ENABLE_WAKE_IO_ISR_WHEN_HCI_ENQUEUE
 	.trigger_tx_rx = ssv6xxx_sdio_trigger_tx_rx,
 #endif
@@ -923,6 +1187,9 @@ static struct ssv6xxx_hwif_ops sdio_ops = {
 	.cmd52_write = ssv6xxx_sdio_cmd52_write,
 	.support_scatter = ssv6xxx_sdio_support_scatter,
 	.rw_scatter = ssv6xxx_sdio_rw_scatter,
+	.write_scatter = ssv6xxx_sdio_write_scatter,
+	.read_scatter = ssv6xxx_sdio_read_scatter,
+	.write_gather = ssv6xxx_sdio_write_gather,
 	.is_ready = ssv6xxx_is_ready,
 	.write_sram = ssv6xxx_sdio_write_sram,
 	.interface_reset = ssv6xxx_sdio_reset,
@@ -1004,6 +1271,7 @@ ssv6xxx_sdio_probe(struct sdio_func *func, const struct sdio_device_id *id)
 	ssv6xxx_low_sdio_clk(func);
 
 	glue->dma_skb = __dev_alloc_skb(SDIO_DMA_BUFFER_LEN, GFP_KERNEL);
+	glue->zero_pad = kzalloc(SDIO_DEF_BLOCK_SIZE, GFP_KERNEL);
 
 #ifdef CONFIG_PM
 	glue->cmd_skb = __dev_alloc_skb(SDIO_COMMAND_BUFFER_LEN, GFP_KERNEL);
@@ -1060,6 +1328,7 @@ ssv6xxx_sdio_probe(struct sdio_func *func, const struct sdio_device_id *id)
  out_dev_put:
 	platform_device_put(glue->core);
  out_free_glue:
+	kfree(glue->zero_pad);
 	kfree(glue);
 
 	return ret;
@@ -1083,6 +1352,8 @@ static void ssv6xxx_sdio_remove(struct sdio_func *func)
 
 		if (glue->dma_skb != NULL)
 			dev_kfree_skb(glue->dma_skb);
+		kfree(glue->gather_buf);
+		kfree(glue->zero_pad);
 
 		dev_dbg(&func->dev, "ssv6xxx_sdio_remove - disable mask\n");
 		ssv6xxx_sdio_irq_setmask(&glue->core->dev, 0xff);
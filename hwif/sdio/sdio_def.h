@@ -24,6 +24,7 @@
 #define REG_INT_MASK (BASE_SDIO + 0x04)
 #define REG_INT_STATUS (BASE_SDIO + 0x08)
 #define REG_INT_TRIGGER (BASE_SDIO + 0x09)
+#define SDIO_INT_STATUS_RX 0x01
 #define REG_Fn1_STATUS (BASE_SDIO + 0x0c)
 #define REG_CARD_PKT_LEN_0 (BASE_SDIO + 0x10)
 #define REG_CARD_PKT_LEN_1 (BASE_SDIO + 0x11)
@@ -66,6 +67,17 @@ struct sdio_scatter_req {
 	struct sdio_scatter_item scat_list[MAX_SCATTER_ENTRIES_PER_REQ];
 	struct scatterlist sgentries[MAX_SCATTER_ENTRIES_PER_REQ];
 };
+/*
+ * One frame written with a single CMD53 from several buffers: the TX
+ * descriptor, up to MAX_AGGR_NUM delimited MPDUs and the block padding.
+ */
+#define MAX_GATHER_ENTRIES_PER_REQ 32
+struct sdio_gather_req {
+	u32 len;
+	int entries;
+	struct sdio_scatter_item list[MAX_GATHER_ENTRIES_PER_REQ];
+	struct scatterlist sgentries[MAX_GATHER_ENTRIES_PER_REQ];
+};
 #define SDIO_READ 0x00000001
 #define SDIO_WRITE 0x00000002
 #define CMD53_ARG_READ 0
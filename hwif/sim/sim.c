@@ -0,0 +1,858 @@
+/*
+ * Copyright (c) 2015 South Silicon Valley Microelectronics Inc.
+ * Copyright (c) 2015 iComm Corporation
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Software model of the SSV6051 behind the hwif ops, for running hci/ and
+ * smac/ on a machine without the card. It keeps an in-memory register
+ * file, hands out packet IDs through ADR_WR_ALC, accounts TX pages and
+ * IDs the way ADR_TX_ID_ALL_INFO reports them, and feeds an RX FIFO that
+ * the interrupt status follows. RESOURCE_LOW is latched when a completion
+ * takes usage under the low-threshold trigger or frees a slot in a full
+ * out-queue, or when the host unmasks it, and is cleared when the host
+ * reads ADR_TX_ID_ALL_INFO. The handful of firmware behaviours the
+ * driver waits on (calibration result, watchdog kicks, RX throughput
+ * test) are answered as host events.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/skbuff.h>
+#include <linux/workqueue.h>
+#include <linux/hashtable.h>
+#include <linux/delay.h>
+#include <linux/version.h>
+#include <ssv6200.h>
+#include <ssv_firmware_version.h>
+
+#define SIM_REG_HASH_BITS 8
+#define SIM_MAX_FRAME_SIZE 4096
+#define SIM_RX_FIFO_DEPTH 64
+#define SIM_IRQ_MAX_LOOP 64
+#define SIM_INT_RX 0x01
+#define SIM_INT_RESOURCE_LOW 0x80
+#define SIM_PBUF_ADDR(id) (0x80000000 | ((id) << 16))
+#define SIM_CHIP_ID(a,b,c,d) (((a) << 24) | ((b) << 16) | ((c) << 8) | (d))
+
+static bool ssv_sim_loopback = false;
+module_param(ssv_sim_loopback, bool, 0644);
+MODULE_PARM_DESC(ssv_sim_loopback, "Loop transmitted data frames back as RX");
+
+static uint ssv_sim_airtime_us = 0;
+module_param(ssv_sim_airtime_us, uint, 0644);
+MODULE_PARM_DESC(ssv_sim_airtime_us, "Simulated air time per TX frame in us");
+
+extern void *ssv6xxx_ifdebug_info[];
+
+struct ssv6xxx_sim_reg {
+	struct hlist_node node;
+	u32 addr;
+	u32 value;
+};
+
+static const u8 ssv6xxx_sim_txq_limit[SSV_HW_TXQ_NUM] = {
+	SSV6200_ID_AC_BK_OUT_QUEUE, SSV6200_ID_AC_BE_OUT_QUEUE,
+	SSV6200_ID_AC_VI_OUT_QUEUE, SSV6200_ID_AC_VO_OUT_QUEUE,
+	SSV6200_ID_MANAGER_QUEUE,
+};
+
+struct ssv6xxx_sim_txinfo {
+	u8 id;
+	u8 txq;
+	u16 pages;
+};
+#define SIM_TXINFO(_skb) ((struct ssv6xxx_sim_txinfo *)((_skb)->cb))
+
+struct ssv6xxx_sim_glue {
+	struct device *dev;
+	struct platform_device *pdev;
+	struct platform_device *core;
+	struct ssv6xxx_platform_data pdata;
+	spinlock_t lock;
+	DECLARE_HASHTABLE(regs, SIM_REG_HASH_BITS);
+	DECLARE_BITMAP(id_map, SSV6200_ID_NUMBER);
+	u32 tx_use_page;
+	u32 tx_use_id;
+	u32 txq_size[SSV_HW_TXQ_NUM];
+	bool res_low;
+	struct sk_buff_head tx_fifo;
+	struct sk_buff_head rx_fifo;
+	u32 rxtput_size;
+	u32 rxtput_remain;
+	u32 evt_seq_no;
+	u8 int_mask;
+	bool irq_enabled;
+	irq_handler_t irq_handler;
+	void *irq_dev;
+	struct workqueue_struct *wq;
+	struct workqueue_struct *tx_wq;
+	struct delayed_work irq_work;
+	struct work_struct tx_work;
+	struct delayed_work wdog_work;
+	bool wdog_running;
+};
+
+static struct ssv6xxx_sim_glue *ssv6xxx_sim;
+
+static struct ssv6xxx_sim_reg *ssv6xxx_sim_reg_find(struct ssv6xxx_sim_glue
+						    *glue, u32 addr)
+{
+	struct ssv6xxx_sim_reg *reg;
+	hash_for_each_possible(glue->regs, reg, node, addr) {
+		if (reg->addr == addr)
+			return reg;
+	}
+	return NULL;
+}
+
+static void ssv6xxx_sim_reg_store(struct ssv6xxx_sim_glue *glue, u32 addr,
+				  u32 value)
+{
+	struct ssv6xxx_sim_reg *reg = ssv6xxx_sim_reg_find(glue, addr);
+	if (reg == NULL) {
+		reg = kzalloc(sizeof(*reg), GFP_ATOMIC);
+		if (reg == NULL)
+			return;
+		reg->addr = addr;
+		hash_add(glue->regs, &reg->node, addr);
+	}
+	reg->value = value;
+}
+
+static u32 ssv6xxx_sim_reg_load(struct ssv6xxx_sim_glue *glue, u32 addr)
+{
+	struct ssv6xxx_sim_reg *reg = ssv6xxx_sim_reg_find(glue, addr);
+	return (reg == NULL) ? 0 : reg->value;
+}
+
+static void ssv6xxx_sim_reg_free(struct ssv6xxx_sim_glue *glue)
+{
+	struct ssv6xxx_sim_reg *reg;
+	struct hlist_node *tmp;
+	int bkt;
+	hash_for_each_safe(glue->regs, bkt, tmp, reg, node) {
+		hash_del(&reg->node);
+		kfree(reg);
+	}
+}
+
+static void ssv6xxx_sim_reg_reset(struct ssv6xxx_sim_glue *glue)
+{
+	ssv6xxx_sim_reg_free(glue);
+	ssv6xxx_sim_reg_store(glue, ADR_CHIP_ID_3,
+			      SIM_CHIP_ID('S', 'S', 'V', '6'));
+	ssv6xxx_sim_reg_store(glue, ADR_CHIP_ID_2,
+			      SIM_CHIP_ID('0', '5', '1', 'Q'));
+	ssv6xxx_sim_reg_store(glue, ADR_CHIP_ID_1,
+			      SIM_CHIP_ID('-', 'S', 'I', 'M'));
+	ssv6xxx_sim_reg_store(glue, ADR_CHIP_ID_0, 0);
+	ssv6xxx_sim_reg_store(glue, ADR_READ_ONLY_FLAGS_1,
+			      0x00000002 | SAR_ADC_FSM_RDY_MSK);
+	bitmap_zero(glue->id_map, SSV6200_ID_NUMBER);
+	glue->tx_use_page = 0;
+	glue->tx_use_id = 0;
+	memset(glue->txq_size, 0, sizeof(glue->txq_size));
+	glue->res_low = false;
+}
+
+static int ssv6xxx_sim_id_alloc(struct ssv6xxx_sim_glue *glue)
+{
+	int id = find_first_zero_bit(glue->id_map, SSV6200_ID_NUMBER);
+	if (id >= SSV6200_ID_NUMBER)
+		return -1;
+	set_bit(id, glue->id_map);
+	return id;
+}
+
+static u32 ssv6xxx_sim_int_status(struct ssv6xxx_sim_glue *glue)
+{
+	u32 status = 0;
+	if (!skb_queue_empty(&glue->rx_fifo))
+		status |= SIM_INT_RX;
+	if (glue->res_low)
+		status |= SIM_INT_RESOURCE_LOW;
+	return status;
+}
+
+static void ssv6xxx_sim_kick_irq(struct ssv6xxx_sim_glue *glue)
+{
+	queue_delayed_work(glue->wq, &glue->irq_work, 0);
+}
+
+static void ssv6xxx_sim_irq_work(struct work_struct *work)
+{
+	struct ssv6xxx_sim_glue *glue =
+	    container_of(work, struct ssv6xxx_sim_glue, irq_work.work);
+	unsigned long flags;
+	u32 pending;
+	int loop;
+	for (loop = 0; loop < SIM_IRQ_MAX_LOOP; loop++) {
+		spin_lock_irqsave(&glue->lock, flags);
+		pending = ssv6xxx_sim_int_status(glue) & ~glue->int_mask;
+		if (!glue->irq_enabled || (glue->irq_handler == NULL)
+		    || (pending == 0)) {
+			spin_unlock_irqrestore(&glue->lock, flags);
+			return;
+		}
+		spin_unlock_irqrestore(&glue->lock, flags);
+		glue->irq_handler(0, glue->irq_dev);
+	}
+	queue_delayed_work(glue->wq, &glue->irq_work, 1);
+}
+
+static void ssv6xxx_sim_rx_enqueue(struct ssv6xxx_sim_glue *glue,
+				   struct sk_buff *skb)
+{
+	unsigned long flags;
+	spin_lock_irqsave(&glue->lock, flags);
+	__skb_queue_tail(&glue->rx_fifo, skb);
+	spin_unlock_irqrestore(&glue->lock, flags);
+}
+
+static void ssv6xxx_sim_send_event(struct ssv6xxx_sim_glue *glue, u8 h_event,
+				   u32 evt_seq_no, u32 len)
+{
+	struct sk_buff *skb;
+	struct cfg_host_event *h_evt;
+	len = max_t(u32, len, sizeof(*h_evt));
+	skb = alloc_skb(len, GFP_KERNEL);
+	if (skb == NULL)
+		return;
+	h_evt = (struct cfg_host_event *)skb_put(skb, len);
+	memset(h_evt, 0, len);
+	h_evt->len = len;
+	h_evt->c_type = HOST_EVENT;
+	h_evt->h_event = h_event;
+	h_evt->evt_seq_no = evt_seq_no;
+	ssv6xxx_sim_rx_enqueue(glue, skb);
+}
+
+static void ssv6xxx_sim_rxtput_fill(struct ssv6xxx_sim_glue *glue)
+{
+	unsigned long flags;
+	u32 seq_no, size;
+	for (;;) {
+		spin_lock_irqsave(&glue->lock, flags);
+		if (!glue->rxtput_remain
+		    || (skb_queue_len(&glue->rx_fifo) >= SIM_RX_FIFO_DEPTH)) {
+			spin_unlock_irqrestore(&glue->lock, flags);
+			break;
+		}
+		glue->rxtput_remain--;
+		seq_no = glue->evt_seq_no++;
+		size = glue->rxtput_size;
+		spin_unlock_irqrestore(&glue->lock, flags);
+		ssv6xxx_sim_send_event(glue, SOC_EVT_SDIO_TEST_COMMAND, seq_no,
+				       size);
+	}
+}
+
+static void ssv6xxx_sim_wdog_work(struct work_struct *work)
+{
+	struct ssv6xxx_sim_glue *glue =
+	    container_of(work, struct ssv6xxx_sim_glue, wdog_work.work);
+	if (!glue->wdog_running)
+		return;
+	ssv6xxx_sim_send_event(glue, SOC_EVT_WATCHDOG_TRIGGER,
+			       glue->evt_seq_no++, 0);
+	ssv6xxx_sim_kick_irq(glue);
+	queue_delayed_work(glue->wq, &glue->wdog_work, HZ);
+}
+
+static void ssv6xxx_sim_host_cmd(struct ssv6xxx_sim_glue *glue,
+				 struct cfg_host_cmd *host_cmd, size_t len)
+{
+	struct sdio_rxtput_cfg *rxtput;
+	unsigned long flags;
+	switch (host_cmd->h_cmd) {
+	case SSV6XXX_HOST_CMD_INIT_CALI:
+		ssv6xxx_sim_send_event(glue, SOC_EVT_TXLOOPBK_RESULT,
+				       SSV6XXX_STATE_OK, 0);
+		break;
+	case SSV6XXX_HOST_CMD_WATCHDOG_START:
+		glue->wdog_running = true;
+		queue_delayed_work(glue->wq, &glue->wdog_work, HZ);
+		break;
+	case SSV6XXX_HOST_CMD_WATCHDOG_STOP:
+		glue->wdog_running = false;
+		break;
+	case SSV6XXX_HOST_CMD_RX_TPUT:
+		if (len < HOST_CMD_HDR_LEN + sizeof(*rxtput))
+			break;
+		rxtput = (struct sdio_rxtput_cfg *)host_cmd->dat32;
+		spin_lock_irqsave(&glue->lock, flags);
+		glue->rxtput_size = clamp_t(u32, rxtput->size_per_frame,
+					    sizeof(struct cfg_host_event),
+					    SIM_MAX_FRAME_SIZE);
+		glue->rxtput_remain = rxtput->total_frames;
+		spin_unlock_irqrestore(&glue->lock, flags);
+		ssv6xxx_sim_rxtput_fill(glue);
+		break;
+	default:
+		break;
+	}
+	ssv6xxx_sim_kick_irq(glue);
+}
+
+static void ssv6xxx_sim_loopback_frame(struct ssv6xxx_sim_glue *glue,
+				       struct sk_buff *tx_skb)
+{
+	struct ssv6200_tx_desc *tx_desc = (struct ssv6200_tx_desc *)tx_skb->data;
+	struct ssv6200_rx_desc *rx_desc;
+	struct ssv6200_rxphy_info *rxphy;
+	struct sk_buff *skb;
+	u32 flen, len;
+	if ((tx_skb->len <= SSV6XXX_TX_DESC_LEN) || !tx_desc->f80211
+	    || (tx_desc->reason == ID_TRAP_SW_TXTPUT))
+		return;
+	flen = tx_skb->len - SSV6XXX_TX_DESC_LEN;
+	len = SSV6XXX_RX_DESC_LEN + flen +
+	    sizeof(struct ssv6200_rxphy_info_padding);
+	if (len > SIM_MAX_FRAME_SIZE)
+		return;
+	skb = alloc_skb(len, GFP_KERNEL);
+	if (skb == NULL)
+		return;
+	memset(skb_put(skb, len), 0, len);
+	rx_desc = (struct ssv6200_rx_desc *)skb->data;
+	rx_desc->len = len;
+	rx_desc->c_type = M0_RXEVENT;
+	rx_desc->f80211 = 1;
+	rx_desc->qos = tx_desc->qos;
+	rx_desc->unicast = tx_desc->unicast;
+	rx_desc->hdr_len = tx_desc->hdr_len;
+	rx_desc->wsid = tx_desc->wsid;
+	rx_desc->rate_idx = tx_desc->drate_idx;
+	rxphy = (struct ssv6200_rxphy_info *)(rx_desc + 1);
+	rxphy->len = flen;
+	memcpy(skb->data + SSV6XXX_RX_DESC_LEN,
+	       tx_skb->data + SSV6XXX_TX_DESC_LEN, flen);
+	ssv6xxx_sim_rx_enqueue(glue, skb);
+}
+
+static void ssv6xxx_sim_tx_work(struct work_struct *work)
+{
+	struct ssv6xxx_sim_glue *glue =
+	    container_of(work, struct ssv6xxx_sim_glue, tx_work);
+	struct ssv6xxx_sim_txinfo *txinfo;
+	struct sk_buff *skb;
+	unsigned long flags;
+	while ((skb = skb_dequeue(&glue->tx_fifo)) != NULL) {
+		if (ssv_sim_airtime_us)
+			usleep_range(ssv_sim_airtime_us,
+				     ssv_sim_airtime_us + 10);
+		if (ssv_sim_loopback)
+			ssv6xxx_sim_loopback_frame(glue, skb);
+		txinfo = SIM_TXINFO(skb);
+		spin_lock_irqsave(&glue->lock, flags);
+		clear_bit(txinfo->id, glue->id_map);
+		glue->tx_use_page -= txinfo->pages;
+		glue->tx_use_id--;
+		if (glue->txq_size[txinfo->txq]--
+		    == ssv6xxx_sim_txq_limit[txinfo->txq])
+			glue->res_low = true;
+		if ((glue->tx_use_page <= SSV6200_TX_LOWTHRESHOLD_PAGE_TRIGGER)
+		    && (glue->tx_use_id <= (SSV6200_ID_TX_THRESHOLD -
+					    SSV6200_TX_LOWTHRESHOLD_ID_TRIGGER)))
+			glue->res_low = true;
+		spin_unlock_irqrestore(&glue->lock, flags);
+		kfree_skb(skb);
+		ssv6xxx_sim_kick_irq(glue);
+	}
+}
+
+static int ssv6xxx_sim_tx_frame(struct ssv6xxx_sim_glue *glue,
+				struct sk_buff *skb)
+{
+	struct ssv6200_tx_desc *tx_desc = (struct ssv6200_tx_desc *)skb->data;
+	struct ssv6xxx_sim_txinfo *txinfo;
+	unsigned long flags;
+	u32 pages;
+	int id;
+	pages = (skb->len + SSV6200_ALLOC_RSVD + (1 << HW_MMU_PAGE_SHIFT) - 1)
+	    >> HW_MMU_PAGE_SHIFT;
+	spin_lock_irqsave(&glue->lock, flags);
+	id = ssv6xxx_sim_id_alloc(glue);
+	if ((id < 0) || (tx_desc->txq_idx >= SSV_HW_TXQ_NUM)) {
+		if (id >= 0)
+			clear_bit(id, glue->id_map);
+		spin_unlock_irqrestore(&glue->lock, flags);
+		kfree_skb(skb);
+		return -EBUSY;
+	}
+	txinfo = SIM_TXINFO(skb);
+	txinfo->id = id;
+	txinfo->txq = tx_desc->txq_idx;
+	txinfo->pages = pages;
+	glue->tx_use_page += pages;
+	glue->tx_use_id++;
+	glue->txq_size[txinfo->txq]++;
+	spin_unlock_irqrestore(&glue->lock, flags);
+	skb_queue_tail(&glue->tx_fifo, skb);
+	queue_work(glue->tx_wq, &glue->tx_work);
+	return 0;
+}
+
+static int __must_check
+ssv6xxx_sim_write(struct device *child, void *buf, size_t len, u8 queue_num)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	struct ssv6200_tx_desc *tx_desc = buf;
+	struct sk_buff *skb;
+	if (len < sizeof(struct cfg_host_cmd))
+		return -EINVAL;
+	switch (tx_desc->c_type) {
+	case HOST_CMD:
+		ssv6xxx_sim_host_cmd(glue, buf, len);
+		return 0;
+	case M0_TXREQ:
+	case M1_TXREQ:
+	case M2_TXREQ:
+		skb = alloc_skb(len, GFP_KERNEL);
+		if (skb == NULL)
+			return -ENOMEM;
+		memcpy(skb_put(skb, len), buf, len);
+		return ssv6xxx_sim_tx_frame(glue, skb);
+	default:
+		return 0;
+	}
+}
+
+static int __must_check
+ssv6xxx_sim_write_gather(struct device *child,
+			 struct sdio_gather_req *gather_req, u8 queue_num)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	struct sk_buff *skb;
+	int i;
+	if ((gather_req->entries == 0)
+	    || (gather_req->list[0].len < sizeof(struct ssv6200_tx_desc)))
+		return -EINVAL;
+	skb = alloc_skb(gather_req->len, GFP_KERNEL);
+	if (skb == NULL)
+		return -ENOMEM;
+	for (i = 0; i < gather_req->entries; i++)
+		memcpy(skb_put(skb, gather_req->list[i].len),
+		       gather_req->list[i].buf, gather_req->list[i].len);
+	return ssv6xxx_sim_tx_frame(glue, skb);
+}
+
+static int __must_check
+ssv6xxx_sim_write_scatter(struct device *child,
+			  struct sdio_scatter_req *scat_req, u8 queue_num)
+{
+	int ret = 0, i;
+	for (i = 0; i < scat_req->scat_entries; i++) {
+		ret = ssv6xxx_sim_write(child, scat_req->scat_list[i].buf,
+					scat_req->scat_list[i].len, queue_num);
+		if (ret) {
+			scat_req->scat_entries = i;
+			break;
+		}
+	}
+	return ret;
+}
+
+static int ssv6xxx_sim_rx_frame(struct ssv6xxx_sim_glue *glue, void *buf,
+				size_t max_len, size_t *size)
+{
+	struct sk_buff *skb;
+	unsigned long flags;
+	spin_lock_irqsave(&glue->lock, flags);
+	skb = __skb_dequeue(&glue->rx_fifo);
+	spin_unlock_irqrestore(&glue->lock, flags);
+	if (skb == NULL)
+		return -EIO;
+	if (skb->len > max_len) {
+		kfree_skb(skb);
+		return -EIO;
+	}
+	memcpy(buf, skb->data, skb->len);
+	*size = skb->len;
+	kfree_skb(skb);
+	ssv6xxx_sim_rxtput_fill(glue);
+	return 0;
+}
+
+static int __must_check
+ssv6xxx_sim_read(struct device *child, void *buf, size_t *size)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	return ssv6xxx_sim_rx_frame(glue, buf, SIM_MAX_FRAME_SIZE, size);
+}
+
+static int __must_check
+ssv6xxx_sim_read_scatter(struct device *child,
+			 struct sdio_scatter_req *scat_req, int *status)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	unsigned long flags;
+	int ret = 0, i;
+	size_t len;
+	*status = 0;
+	for (i = 0; i < scat_req->scat_entries;) {
+		ret = ssv6xxx_sim_rx_frame(glue, scat_req->scat_list[i].buf,
+					   scat_req->scat_list[i].len, &len);
+		if (ret)
+			break;
+		scat_req->scat_list[i++].len = len;
+		spin_lock_irqsave(&glue->lock, flags);
+		*status = ssv6xxx_sim_int_status(glue);
+		spin_unlock_irqrestore(&glue->lock, flags);
+		if (!(*status & SIM_INT_RX))
+			break;
+	}
+	if (ret)
+		*status = 0;
+	scat_req->scat_entries = i;
+	return ret;
+}
+
+static int __must_check
+ssv6xxx_sim_read_reg(struct device *child, u32 addr, u32 * buf)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	unsigned long flags;
+	spin_lock_irqsave(&glue->lock, flags);
+	switch (addr) {
+	case ADR_BRG_SW_RST:
+	case ADR_MCU_STATUS:
+		*buf = 0;
+		break;
+	case ADR_TX_ID_ALL_INFO:
+		glue->res_low = false;
+		*buf = (glue->tx_use_page << TX_PAGE_USE_7_0_SFT)
+		    | (glue->tx_use_id << TX_ID_USE_5_0_SFT)
+		    | (glue->txq_size[0] << EDCA0_FFO_CNT_SFT)
+		    | (glue->txq_size[1] << EDCA1_FFO_CNT_3_0_SFT)
+		    | (glue->txq_size[2] << EDCA2_FFO_CNT_SFT)
+		    | (glue->txq_size[3] << EDCA3_FFO_CNT_SFT);
+		break;
+	case ADR_TX_ID_ALL_INFO2:
+		*buf = (glue->tx_use_page << TX_PAGE_USE2_SFT)
+		    | (glue->tx_use_id << TX_ID_USE2_SFT)
+		    | (glue->txq_size[4] << EDCA4_FFO_CNT_SFT);
+		break;
+	default:
+		*buf = ssv6xxx_sim_reg_load(glue, addr);
+		break;
+	}
+	spin_unlock_irqrestore(&glue->lock, flags);
+	return 0;
+}
+
+static void ssv6xxx_sim_reg_write_locked(struct ssv6xxx_sim_glue *glue,
+					 u32 addr, u32 value)
+{
+	int id;
+	switch (addr) {
+	case ADR_BRG_SW_RST:
+		break;
+	case ADR_WR_ALC:
+		id = ssv6xxx_sim_id_alloc(glue);
+		ssv6xxx_sim_reg_store(glue, addr,
+				      (id < 0) ? 0 : SIM_PBUF_ADDR(id));
+		break;
+	case ADR_CH0_TRIG_1:
+		if (((value >> 7) & 0x0f) == M_ENG_TRASH_CAN)
+			clear_bit(value & 0x7f, glue->id_map);
+		break;
+	default:
+		ssv6xxx_sim_reg_store(glue, addr, value);
+		break;
+	}
+}
+
+static int __must_check
+ssv6xxx_sim_write_reg(struct device *child, u32 addr, u32 buf)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	unsigned long flags;
+	spin_lock_irqsave(&glue->lock, flags);
+	ssv6xxx_sim_reg_write_locked(glue, addr, buf);
+	spin_unlock_irqrestore(&glue->lock, flags);
+	return 0;
+}
+
+static int __must_check
+ssv6xxx_sim_write_reg_batch(struct device *child,
+			    const struct ssv6xxx_reg_batch *regs, u32 count)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	unsigned long flags;
+	u32 i;
+	spin_lock_irqsave(&glue->lock, flags);
+	for (i = 0; i < count; i++)
+		ssv6xxx_sim_reg_write_locked(glue, regs[i].addr, regs[i].value);
+	spin_unlock_irqrestore(&glue->lock, flags);
+	return 0;
+}
+
+#ifdef ENABLE_WAKE_IO_ISR_WHEN_HCI_ENQUEUE
+static int ssv6xxx_sim_trigger_tx_rx(struct device *child)
+{
+	ssv6xxx_sim_kick_irq(dev_get_drvdata(child->parent));
+	return 0;
+}
+#endif
+
+static int ssv6xxx_sim_irq_getmask(struct device *child, u32 * mask)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	unsigned long flags;
+	spin_lock_irqsave(&glue->lock, flags);
+	*mask = glue->int_mask;
+	spin_unlock_irqrestore(&glue->lock, flags);
+	return 0;
+}
+
+static void ssv6xxx_sim_irq_setmask(struct device *child, int mask)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	unsigned long flags;
+	spin_lock_irqsave(&glue->lock, flags);
+	if ((glue->int_mask & SIM_INT_RESOURCE_LOW)
+	    && !(mask & SIM_INT_RESOURCE_LOW))
+		glue->res_low = true;
+	glue->int_mask = (u8) mask;
+	spin_unlock_irqrestore(&glue->lock, flags);
+	ssv6xxx_sim_kick_irq(glue);
+}
+
+static void ssv6xxx_sim_irq_enable(struct device *child)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	glue->irq_enabled = true;
+	ssv6xxx_sim_kick_irq(glue);
+}
+
+static void ssv6xxx_sim_irq_disable(struct device *child, bool iswaitirq)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	glue->irq_enabled = false;
+}
+
+static int ssv6xxx_sim_irq_getstatus(struct device *child, int *status)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	unsigned long flags;
+	spin_lock_irqsave(&glue->lock, flags);
+	*status = ssv6xxx_sim_int_status(glue);
+	spin_unlock_irqrestore(&glue->lock, flags);
+	return 0;
+}
+
+static void
+ssv6xxx_sim_irq_request(struct device *child, irq_handler_t irq_handler,
+			void *irq_dev)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	glue->irq_dev = irq_dev;
+	glue->irq_handler = irq_handler;
+}
+
+static void ssv6xxx_sim_irq_trigger(struct device *child)
+{
+	ssv6xxx_sim_kick_irq(dev_get_drvdata(child->parent));
+}
+
+static void ssv6xxx_sim_pmu_wakeup(struct device *child)
+{
+}
+
+static int __must_check
+ssv6xxx_sim_load_firmware(struct device *child, u8 * firmware_name,
+			  u8 openfile)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	unsigned long flags;
+	dev_info(child, "simulated firmware %s loaded\n", firmware_name);
+	spin_lock_irqsave(&glue->lock, flags);
+	ssv6xxx_sim_reg_store(glue, FW_VERSION_REG, ssv_firmware_version);
+	spin_unlock_irqrestore(&glue->lock, flags);
+	return 0;
+}
+
+static int ssv6xxx_sim_cmd52_read(struct device *child, u32 addr, u32 * value)
+{
+	*value = 0;
+	return 0;
+}
+
+static int ssv6xxx_sim_cmd52_write(struct device *child, u32 addr, u32 value)
+{
+	return 0;
+}
+
+static bool ssv6xxx_sim_support_scatter(struct device *child)
+{
+	return false;
+}
+
+static bool ssv6xxx_sim_is_ready(struct device *child)
+{
+	return true;
+}
+
+static int
+ssv6xxx_sim_write_sram(struct device *child, u32 addr, u8 * data, u32 size)
+{
+	return 0;
+}
+
+static void ssv6xxx_sim_reset(struct device *child)
+{
+	struct ssv6xxx_sim_glue *glue = dev_get_drvdata(child->parent);
+	unsigned long flags;
+	glue->wdog_running = false;
+	flush_work(&glue->tx_work);
+	spin_lock_irqsave(&glue->lock, flags);
+	__skb_queue_purge(&glue->rx_fifo);
+	glue->rxtput_remain = 0;
+	ssv6xxx_sim_reg_reset(glue);
+	spin_unlock_irqrestore(&glue->lock, flags);
+}
+
+static struct ssv6xxx_hwif_ops sim_ops = {
+	.read = ssv6xxx_sim_read,
+	.write = ssv6xxx_sim_write,
+	.readreg = ssv6xxx_sim_read_reg,
+	.writereg = ssv6xxx_sim_write_reg,
+	.writereg_batch = ssv6xxx_sim_write_reg_batch,
+#ifdef ENABLE_WAKE_IO_ISR_WHEN_HCI_ENQUEUE
+	.trigger_tx_rx = ssv6xxx_sim_trigger_tx_rx,
+#endif
+	.irq_getmask = ssv6xxx_sim_irq_getmask,
+	.irq_setmask = ssv6xxx_sim_irq_setmask,
+	.irq_enable = ssv6xxx_sim_irq_enable,
+	.irq_disable = ssv6xxx_sim_irq_disable,
+	.irq_getstatus = ssv6xxx_sim_irq_getstatus,
+	.irq_request = ssv6xxx_sim_irq_request,
+	.irq_trigger = ssv6xxx_sim_irq_trigger,
+	.pmu_wakeup = ssv6xxx_sim_pmu_wakeup,
+	.load_fw = ssv6xxx_sim_load_firmware,
+	.cmd52_read = ssv6xxx_sim_cmd52_read,
+	.cmd52_write = ssv6xxx_sim_cmd52_write,
+	.support_scatter = ssv6xxx_sim_support_scatter,
+	.write_scatter = ssv6xxx_sim_write_scatter,
+	.read_scatter = ssv6xxx_sim_read_scatter,
+	.write_gather = ssv6xxx_sim_write_gather,
+	.is_ready = ssv6xxx_sim_is_ready,
+	.write_sram = ssv6xxx_sim_write_sram,
+	.interface_reset = ssv6xxx_sim_reset,
+};
+
+int ssv6xxx_sim_init(void)
+{
+	struct ssv6xxx_sim_glue *glue;
+	int ret;
+	glue = kzalloc(sizeof(*glue), GFP_KERNEL);
+	if (!glue)
+		return -ENOMEM;
+	spin_lock_init(&glue->lock);
+	hash_init(glue->regs);
+	skb_queue_head_init(&glue->tx_fifo);
+	skb_queue_head_init(&glue->rx_fifo);
+	glue->int_mask = 0xff;
+	ssv6xxx_sim_reg_reset(glue);
+	INIT_DELAYED_WORK(&glue->irq_work, ssv6xxx_sim_irq_work);
+	INIT_WORK(&glue->tx_work, ssv6xxx_sim_tx_work);
+	INIT_DELAYED_WORK(&glue->wdog_work, ssv6xxx_sim_wdog_work);
+	glue->wq = create_singlethread_workqueue("ssv6xxx_sim_wq");
+	if (!glue->wq) {
+		ret = -ENOMEM;
+		goto out_free_glue;
+	}
+	glue->tx_wq = create_singlethread_workqueue("ssv6xxx_sim_tx_wq");
+	if (!glue->tx_wq) {
+		ret = -ENOMEM;
+		goto out_destroy_wq;
+	}
+	glue->pdev = platform_device_register_simple("ssv6xxx_sim", -1,
+						     NULL, 0);
+	if (IS_ERR(glue->pdev)) {
+		ret = PTR_ERR(glue->pdev);
+		goto out_destroy_tx_wq;
+	}
+	glue->dev = &glue->pdev->dev;
+	dev_set_drvdata(glue->dev, glue);
+	atomic_set(&glue->pdata.irq_handling, 0);
+	glue->pdata.is_enabled = true;
+	glue->pdata.ops = &sim_ops;
+	glue->core = platform_device_alloc("ssv6200", -1);
+	if (!glue->core) {
+		dev_err(glue->dev, "can't allocate platform_device");
+		ret = -ENOMEM;
+		goto out_unregister;
+	}
+	glue->core->dev.parent = glue->dev;
+	ret = platform_device_add_data(glue->core, &glue->pdata,
+				       sizeof(glue->pdata));
+	if (ret) {
+		dev_err(glue->dev, "can't add platform data\n");
+		goto out_dev_put;
+	}
+	ret = platform_device_add(glue->core);
+	if (ret) {
+		dev_err(glue->dev, "can't add platform device\n");
+		goto out_dev_put;
+	}
+	ssv6xxx_ifdebug_info[0] = (void *)&glue->core->dev;
+	ssv6xxx_ifdebug_info[1] = (void *)glue->core;
+	ssv6xxx_ifdebug_info[2] = (void *)&sim_ops;
+	ssv6xxx_sim = glue;
+	dev_info(glue->dev, "simulated SSV6051 registered\n");
+	return 0;
+
+ out_dev_put:
+	platform_device_put(glue->core);
+ out_unregister:
+	platform_device_unregister(glue->pdev);
+ out_destroy_tx_wq:
+	destroy_workqueue(glue->tx_wq);
+ out_destroy_wq:
+	destroy_workqueue(glue->wq);
+ out_free_glue:
+	ssv6xxx_sim_reg_free(glue);
+	kfree(glue);
+	return ret;
+}
+
+void ssv6xxx_sim_exit(void)
+{
+	struct ssv6xxx_sim_glue *glue = ssv6xxx_sim;
+	if (glue == NULL)
+		return;
+	glue->irq_enabled = false;
+	glue->wdog_running = false;
+	platform_device_unregister(glue->core);
+	cancel_delayed_work_sync(&glue->wdog_work);
+	cancel_delayed_work_sync(&glue->irq_work);
+	flush_work(&glue->tx_work);
+	destroy_workqueue(glue->tx_wq);
+	destroy_workqueue(glue->wq);
+	platform_device_unregister(glue->pdev);
+	skb_queue_purge(&glue->tx_fifo);
+	skb_queue_purge(&glue->rx_fifo);
+	ssv6xxx_sim_reg_free(glue);
+	kfree(glue);
+	ssv6xxx_sim = NULL;
+}
+
+EXPORT_SYMBOL(ssv6xxx_sim_init);
+EXPORT_SYMBOL(ssv6xxx_sim_exit);
@@ -49,6 +49,7 @@ struct ssv6xxx_cfg {
 	u32 wifi_tx_gain_level_b;
 	u32 rssi_ctl;
 	u32 sr_bhvr;
+	u32 rc_host_sample;
 	u32 configuration[EXTERNEL_CONFIG_SUPPORT + 1][2];
 	u8 firmware_path[128];
 	u8 flash_bin_path[128];
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2015 South Silicon Valley Microelectronics Inc.
+ * Copyright (c) 2015 iComm Corporation
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ssv6xxx
+
+#if !defined(_SSV_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _SSV_TRACE_H_
+#include <linux/skbuff.h>
+#include <linux/tracepoint.h>
+
+/*
+ * TX pipeline stages, in order. The skb address is the frame id; an
+ * A-MPDU gets a new one at aggregation and keeps it to tx_done.
+ */
+DECLARE_EVENT_CLASS(ssv6xxx_tx_stage,
+	TP_PROTO(const struct sk_buff *skb, int queue),
+	TP_ARGS(skb, queue),
+	TP_STRUCT__entry(
+		__field(const void *, skbaddr)
+		__field(int, queue)
+		__field(unsigned int, len)
+	),
+	TP_fast_assign(
+		__entry->skbaddr = skb;
+		__entry->queue = queue;
+		__entry->len = skb->len;
+	),
+	TP_printk("skb=%p queue=%d len=%u",
+		  __entry->skbaddr, __entry->queue, __entry->len)
+);
+
+DEFINE_EVENT(ssv6xxx_tx_stage, ssv6xxx_tx_mac80211,
+	TP_PROTO(const struct sk_buff *skb, int queue),
+	TP_ARGS(skb, queue)
+);
+
+DEFINE_EVENT(ssv6xxx_tx_stage, ssv6xxx_tx_frame,
+	TP_PROTO(const struct sk_buff *skb, int queue),
+	TP_ARGS(skb, queue)
+);
+
+DEFINE_EVENT(ssv6xxx_tx_stage, ssv6xxx_hci_enqueue,
+	TP_PROTO(const struct sk_buff *skb, int queue),
+	TP_ARGS(skb, queue)
+);
+
+DEFINE_EVENT(ssv6xxx_tx_stage, ssv6xxx_hci_send,
+	TP_PROTO(const struct sk_buff *skb, int queue),
+	TP_ARGS(skb, queue)
+);
+
+DEFINE_EVENT(ssv6xxx_tx_stage, ssv6xxx_tx_done,
+	TP_PROTO(const struct sk_buff *skb, int queue),
+	TP_ARGS(skb, queue)
+);
+
+TRACE_EVENT(ssv6xxx_ampdu_aggr,
+	TP_PROTO(const struct sk_buff *skb, int queue, u32 tid, u32 nr_mpdu),
+	TP_ARGS(skb, queue, tid, nr_mpdu),
+	TP_STRUCT__entry(
+		__field(const void *, skbaddr)
+		__field(int, queue)
+		__field(unsigned int, len)
+		__field(u32, tid)
+		__field(u32, nr_mpdu)
+	),
+	TP_fast_assign(
+		__entry->skbaddr = skb;
+		__entry->queue = queue;
+		__entry->len = skb->len;
+		__entry->tid = tid;
+		__entry->nr_mpdu = nr_mpdu;
+	),
+	TP_printk("skb=%p queue=%d len=%u tid=%u mpdus=%u",
+		  __entry->skbaddr, __entry->queue, __entry->len,
+		  __entry->tid, __entry->nr_mpdu)
+);
+
+/*
+ * Links an MPDU id to the A-MPDU id it is aggregated into, once per
+ * aggregation, so retried MPDUs show up under each new container.
+ */
+TRACE_EVENT(ssv6xxx_ampdu_mpdu,
+	TP_PROTO(const struct sk_buff *mpdu, const struct sk_buff *ampdu,
+		 u16 ssn),
+	TP_ARGS(mpdu, ampdu, ssn),
+	TP_STRUCT__entry(
+		__field(const void *, skbaddr)
+		__field(const void *, ampduaddr)
+		__field(unsigned int, len)
+		__field(u16, ssn)
+	),
+	TP_fast_assign(
+		__entry->skbaddr = mpdu;
+		__entry->ampduaddr = ampdu;
+		__entry->len = mpdu->len;
+		__entry->ssn = ssn;
+	),
+	TP_printk("skb=%p ampdu=%p len=%u ssn=%u",
+		  __entry->skbaddr, __entry->ampduaddr, __entry->len,
+		  __entry->ssn)
+);
+
+/*
+ * Rate control reports as the engines consume them. tools/rc_replay
+ * reads this output back.
+ */
+struct ssv_rc_report;
+TRACE_EVENT(ssv6xxx_rc_report,
+	TP_PROTO(const struct ssv_rc_report *report),
+	TP_ARGS(report),
+	TP_STRUCT__entry(
+		__field(u8, wsid)
+		__field(u8, ampdu)
+		__field(u16, len)
+		__field(u16, ack)
+		__array(s8, rate, 3)
+		__array(u8, count, 3)
+	),
+	TP_fast_assign(
+		int i;
+		__entry->wsid = report->wsid;
+		__entry->ampdu = (report->h_event == SOC_EVT_RC_AMPDU_REPORT);
+		__entry->len = report->ampdu_len;
+		__entry->ack = report->ampdu_ack_len;
+		for (i = 0; i < 3; i++) {
+			__entry->rate[i] = report->rates[i].data_rate;
+			__entry->count[i] = report->rates[i].count;
+		}
+	),
+	TP_printk("wsid=%u ampdu=%u len=%u ack=%u rates=%d/%u,%d/%u,%d/%u",
+		  __entry->wsid, __entry->ampdu, __entry->len, __entry->ack,
+		  __entry->rate[0], __entry->count[0],
+		  __entry->rate[1], __entry->count[1],
+		  __entry->rate[2], __entry->count[2])
+);
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH include
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE ssv_trace
+#include <trace/define_trace.h>
@@ -65,6 +65,9 @@ ccflags-y += -DRATE_CONTROL_REALTIME_UPDATA
 
 #ccflags-y += -DCONFIG_SSV_SDIO_EXT_INT
 
+# Replace the SDIO bus with the in-memory chip model (hwif/sim).
+#ccflags-y += -DCONFIG_SSV_HWIF_SIM
+
 #######################################################
 ccflags-y += -DCONFIG_SSV6200_HAS_RX_WORKQUEUE
 #ccflags-y += -DUSE_THREAD_RX
@@ -15,12 +15,19 @@
  */
 
 #include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,12,0)
+#include <linux/unaligned.h>
+#else
+#include <asm/unaligned.h>
+#endif
 #include <ssv6200.h>
 #include "dev.h"
 #include "ap.h"
 #include "sec.h"
 #include "ssv_rc_common.h"
+#include "ssv_rc.h"
 #include "ssv_ht_rc.h"
+#include <ssv_trace.h>
 extern struct ieee80211_ops ssv6200_ops;
 
 // Hack: redefine MAX_AMPDU_BUF because buf_size here is a 8-bit char
@@ -30,6 +37,11 @@ extern struct ieee80211_ops ssv6200_ops;
 #define IEEE80211_MAX_AMPDU_BUF 0x40
 #endif
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,2,0)
+#define ssv_timer_shutdown_sync(t) timer_shutdown_sync(t)
+#else
+#define ssv_timer_shutdown_sync(t) del_timer_sync(t)
+#endif
 #define BA_WAIT_TIMEOUT (800)
 #define AMPDU_BA_FRAME_LEN (68)
 #define ampdu_skb_hdr(skb) ((struct ieee80211_hdr*)((u8*)((skb)->data)+AMPDU_DELIMITER_LEN))
@@ -53,6 +65,8 @@ static void void_func(const char *fmt, ...)
     })
 #define INDEX_PKT_BY_SSN(tid,ssn) \
     ((tid)->aggr_pkts[(ssn) % SSV_AMPDU_BA_WINDOW_SIZE])
+#define SSN_TO_SLOT(ssn) ((ssn) % SSV_AMPDU_BA_WINDOW_SIZE)
+#define SSN_TO_SLOT_BIT(ssn) BIT_ULL(SSN_TO_SLOT(ssn))
 #define NEXT_PKT_SN(sn) \
     ({ (sn + 1) % SSV_AMPDU_MAX_SSN; })
 #define INC_PKT_SN(sn) \
@@ -76,7 +90,7 @@ static struct sk_buff *_alloc_ampdu_skb(struct ssv_softc *sc,
 					u32 len);
 static bool _sync_ampdu_pkt_arr(struct AMPDU_TID_st *ampdu_tid,
 				struct sk_buff *ampdu_skb, bool retry);
-static void _put_mpdu_to_ampdu(struct sk_buff *ampdu, struct sk_buff *mpdu);
+static bool _put_mpdu_to_ampdu(struct sk_buff *ampdu, struct sk_buff *mpdu);
 static void _add_ampdu_txinfo(struct ssv_softc *sc, struct sk_buff *ampdu_skb);
 static u32 _flush_early_ampdu_q(struct ssv_softc *sc,
 				struct AMPDU_TID_st *ampdu_tid);
@@ -86,7 +100,8 @@ static void _aggr_ampdu_tx_q(struct ieee80211_hw *hw,
 static void _queue_early_ampdu(struct ssv_softc *sc,
 			       struct AMPDU_TID_st *ampdu_tid,
 			       struct sk_buff *ampdu_skb);
-static int _mark_skb_retry(struct SKB_info_st *skb_info, struct sk_buff *skb);
+static int _mark_skb_retry(struct AMPDU_TID_st *ampdu_tid,
+			   struct SKB_info_st *skb_info, struct sk_buff *skb);
 #ifdef CONFIG_DEBUG_SKB_TIMESTAMP
 unsigned int cal_duration_of_ampdu(struct sk_buff *ampdu_skb, int stage)
 {
@@ -117,47 +132,54 @@ unsigned int cal_duration_of_ampdu(struct sk_buff *ampdu_skb, int stage)
 	return timeout;
 }
 #endif
-static u8 _cal_ampdu_delm_half_crc(u8 value)
-{
-	u32 c32 = value, v32 = value;
-	c32 ^= (v32 >> 1) | (v32 << 7);
-	c32 ^= (v32 >> 2);
-	if (v32 & 2)
-		c32 ^= (0xC0);
-	c32 ^= ((v32 << 4) & 0x30);
-	return (u8) c32;
-}
+#define AMPDU_DELM_HALF_CRC(v) \
+    ((u8)((v) ^ (((v) >> 1) | ((v) << 7)) ^ ((v) >> 2) \
+          ^ (((v) & 2) ? 0xC0 : 0) ^ (((v) << 4) & 0x30)))
+#define AMPDU_DELM_HALF_CRC4(n) \
+    AMPDU_DELM_HALF_CRC(n), AMPDU_DELM_HALF_CRC((n) + 1), \
+    AMPDU_DELM_HALF_CRC((n) + 2), AMPDU_DELM_HALF_CRC((n) + 3)
+#define AMPDU_DELM_HALF_CRC16(n) \
+    AMPDU_DELM_HALF_CRC4(n), AMPDU_DELM_HALF_CRC4((n) + 4), \
+    AMPDU_DELM_HALF_CRC4((n) + 8), AMPDU_DELM_HALF_CRC4((n) + 12)
+#define AMPDU_DELM_HALF_CRC64(n) \
+    AMPDU_DELM_HALF_CRC16(n), AMPDU_DELM_HALF_CRC16((n) + 16), \
+    AMPDU_DELM_HALF_CRC16((n) + 32), AMPDU_DELM_HALF_CRC16((n) + 48)
+static const u8 ampdu_delm_half_crc[256] = {
+	AMPDU_DELM_HALF_CRC64(0), AMPDU_DELM_HALF_CRC64(64),
+	AMPDU_DELM_HALF_CRC64(128), AMPDU_DELM_HALF_CRC64(192)
+};
 
-static u8 _cal_ampdu_delm_crc(u8 * pointer)
+/*
+ * The delimiter CRC covers the reserved bits and the 12-bit length, so
+ * the whole little-endian delimiter word follows from the length.
+ */
+static u32 _ampdu_delimiter(u32 length)
 {
-	u8 crc = 0xCF;
-	crc ^= _cal_ampdu_delm_half_crc(*pointer++);
-	crc =
-	    _cal_ampdu_delm_half_crc(crc) ^ _cal_ampdu_delm_half_crc(*pointer);
-	return ~crc;
+	u8 crc = 0xCF ^ ampdu_delm_half_crc[(length << 4) & 0xF0];
+	crc = ~(ampdu_delm_half_crc[crc]
+		^ ampdu_delm_half_crc[(length >> 4) & 0xFF]);
+	return ((length & 0xFFF) << 4) | ((u32) crc << 16)
+	    | ((u32) AMPDU_SIGNATURE << 24);
 }
 
 static bool ssv6200_ampdu_add_delimiter_and_crc32(struct sk_buff *mpdu)
 {
-	p_AMPDU_DELIMITER delimiter_p;
 	struct ieee80211_hdr *mpdu_hdr;
-	int ret;
 	u32 orig_mpdu_len = mpdu->len;
 	u32 pad = (4 - (orig_mpdu_len % 4)) % 4;
+	u32 tail = AMPDU_FCS_LEN + pad;
 	mpdu_hdr = (struct ieee80211_hdr *)(mpdu->data);
 	mpdu_hdr->duration_id = AMPDU_TX_NAV_MCS_567;
-	ret = skb_padto(mpdu, mpdu->len + (AMPDU_FCS_LEN + pad));
-	if (ret) {
-		pr_err("Failed to extand skb for aggregation\n");
-		return false;
+	if (unlikely(skb_cloned(mpdu) || (skb_tailroom(mpdu) < tail))) {
+		if (pskb_expand_head(mpdu, 0, tail, GFP_ATOMIC)) {
+			pr_err("Failed to extand skb for aggregation\n");
+			return false;
+		}
 	}
-	skb_put(mpdu, AMPDU_FCS_LEN + pad);
+	memset(skb_put(mpdu, tail), 0, tail);
 	skb_push(mpdu, AMPDU_DELIMITER_LEN);
-	delimiter_p = (p_AMPDU_DELIMITER) mpdu->data;
-	delimiter_p->reserved = 0;
-	delimiter_p->length = orig_mpdu_len + AMPDU_FCS_LEN;
-	delimiter_p->signature = AMPDU_SIGNATURE;
-	delimiter_p->crc = _cal_ampdu_delm_crc((u8 *) (delimiter_p));
+	put_unaligned_le32(_ampdu_delimiter(orig_mpdu_len + AMPDU_FCS_LEN),
+			   mpdu->data);
 	return true;
 }
 
@@ -171,6 +193,96 @@ static void ssv6200_ampdu_hw_init(struct ieee80211_hw *hw)
 	SMAC_REG_READ(sc->sh, ADR_MTX_MISC_EN, &temp32);
 }
 
+/*
+ * Per-TID aggregation sizing. The byte limit is what the rate moves in
+ * the TID's airtime target, capped by the PPDU limit of the rate; the
+ * frame limit grows by one on clean BlockAcks and halves on lossy ones.
+ */
+static u32 _ampdu_tid_max_len(struct AMPDU_TID_st *ampdu_tid, u32 rate_idx)
+{
+	u32 max_len = ampdu_max_transmit_length[rate_idx];
+	u32 budget;
+	if (max_len == 0)
+		return 0;
+	budget = (u32)div_u64((u64)ampdu_rate_kbps[rate_idx]
+			      * ampdu_tid->airtime_target_us, 8000);
+	if (budget < SSV_AMPDU_MIN_AGGR_LEN)
+		budget = SSV_AMPDU_MIN_AGGR_LEN;
+	if (budget < max_len)
+		max_len = budget;
+	ampdu_tid->aggr_rate_idx = rate_idx;
+	ampdu_tid->aggr_len_limit = max_len;
+	return max_len;
+}
+
+static void _ampdu_tid_ba_update(struct AMPDU_TID_st *ampdu_tid,
+				 u32 aggr_num, u32 acked_num)
+{
+	u32 ratio;
+	if (aggr_num == 0)
+		return;
+	ratio = acked_num * 100 / aggr_num;
+	ampdu_tid->ba_success =
+	    (ratio * (100 - SSV_AMPDU_BA_EWMA_WEIGHT)
+	     + ampdu_tid->ba_success * SSV_AMPDU_BA_EWMA_WEIGHT) / 100;
+	if (ampdu_tid->ba_success >= SSV_AMPDU_BA_GOOD) {
+		if (ampdu_tid->aggr_num_limit < ampdu_tid->agg_num_max)
+			ampdu_tid->aggr_num_limit++;
+	} else if ((ampdu_tid->ba_success < SSV_AMPDU_BA_POOR)
+		   && (ratio < SSV_AMPDU_BA_POOR)) {
+		ampdu_tid->aggr_num_limit =
+		    max_t(u32, ampdu_tid->aggr_num_limit / 2,
+			  SSV_AMPDU_MIN_AGGR_NUM);
+	}
+}
+
+/*
+ * Per-TID timers only mark the TID and wake the owning thread: the RX
+ * task runs the BA timeout check, the TX task flushes partial aggregates.
+ * They are armed only with pkt_array_lock held and the TID operating;
+ * ssv6200_ampdu_tx_stop() leaves that state under the same lock before
+ * shutting the timers down, so none can be re-armed behind it.
+ */
+static void _ampdu_ba_timer_fn(struct timer_list *t)
+{
+	struct AMPDU_TID_st *ampdu_tid = from_timer(ampdu_tid, t, ba_timer);
+	struct ssv_softc *sc = ampdu_tid->sc;
+	set_bit(SSV_AMPDU_TIMER_BA, &ampdu_tid->timer_flags);
+	set_bit(SSV_AMPDU_TIMER_BA, &sc->tx.ampdu_timer_flags);
+	wake_up_interruptible(&sc->rx_wait_q);
+}
+
+static void _ampdu_flush_timer_fn(struct timer_list *t)
+{
+	struct AMPDU_TID_st *ampdu_tid = from_timer(ampdu_tid, t, flush_timer);
+	struct ssv_softc *sc = ampdu_tid->sc;
+	set_bit(SSV_AMPDU_TIMER_FLUSH, &ampdu_tid->timer_flags);
+	set_bit(SSV_AMPDU_TIMER_FLUSH, &sc->tx.ampdu_timer_flags);
+	wake_up_interruptible(&sc->tx_wait_q);
+}
+
+static void _ampdu_arm_flush_timer(struct AMPDU_TID_st *ampdu_tid)
+{
+	struct sk_buff *ampdu_skb = ampdu_tid->cur_ampdu_pkt;
+	bool pending = (skb_queue_len(&ampdu_tid->early_aggr_ampdu_q) > 0);
+	if (ampdu_tid->state != AMPDU_STATE_OPERATION)
+		return;
+	if (ampdu_skb != NULL) {
+		struct ampdu_hdr_st *ampdu_hdr =
+		    (struct ampdu_hdr_st *)ampdu_skb->head;
+		if (skb_queue_len(&ampdu_hdr->mpdu_q))
+			pending = true;
+	}
+	if (!pending)
+		return;
+	spin_lock_bh(&ampdu_tid->pkt_array_lock);
+	if ((ampdu_tid->state == AMPDU_STATE_OPERATION)
+	    && !timer_pending(&ampdu_tid->flush_timer))
+		mod_timer(&ampdu_tid->flush_timer,
+			  jiffies + msecs_to_jiffies(SSV_AMPDU_FLUSH_TIMEOUT));
+	spin_unlock_bh(&ampdu_tid->pkt_array_lock);
+}
+
 bool _sync_ampdu_pkt_arr(struct AMPDU_TID_st *ampdu_tid, struct sk_buff *ampdu,
 			 bool retry)
 {
@@ -226,6 +338,9 @@ bool _sync_ampdu_pkt_arr(struct AMPDU_TID_st *ampdu_tid, struct sk_buff *ampdu,
 			*pp_aggr_pkt = mpdu;
 			if (!retry)
 				ampdu_tid->aggr_pkt_num++;
+			ampdu_tid->sent_map &= ~SSN_TO_SLOT_BIT(ssn);
+			ampdu_tid->acked_map &= ~SSN_TO_SLOT_BIT(ssn);
+			ampdu_tid->retry_map &= ~SSN_TO_SLOT_BIT(ssn);
 			mpdu_skb_info->ampdu_tx_status = AMPDU_ST_AGGREGATED;
 			if (ampdu_tid->ssv_baw_head == SSV_ILLEGAL_SN) {
 				ampdu_tid->ssv_baw_head = ssn;
@@ -266,6 +381,7 @@ struct sk_buff *_aggr_retry_mpdu(struct ssv_softc *sc,
 	unsigned long flags;
 	u16 head_ssn = ampdu_tid->ssv_baw_head;
 	struct ampdu_hdr_st *ampdu_hdr;
+	struct sk_buff_head drop_q;
 	BUG_ON(head_ssn == SSV_ILLEGAL_SN);
 	num_retry_mpdu = skb_queue_len(retry_queue);
 	if (num_retry_mpdu == 0)
@@ -275,8 +391,9 @@ struct sk_buff *_aggr_retry_mpdu(struct ssv_softc *sc,
 		return NULL;
 	ampdu_hdr = (struct ampdu_hdr_st *)new_ampdu_skb->head;
 	total_skb_size = 0;
+	__skb_queue_head_init(&drop_q);
 	spin_lock_irqsave(&retry_queue->lock, flags);
-	for (temp_i = 0; temp_i < ampdu_tid->agg_num_max; temp_i++) {
+	for (temp_i = 0; temp_i < ampdu_tid->aggr_num_limit; temp_i++) {
 		struct ieee80211_hdr *mpdu_hdr;
 		u16 mpdu_sn;
 		u16 diff;
@@ -294,24 +411,45 @@ struct sk_buff *_aggr_retry_mpdu(struct ssv_softc *sc,
 			struct SKB_info_st *skb_info;
 			prn_aggr_err("Z. release skb (s %d, h %d, d %d)\n",
 				     mpdu_sn, head_ssn, diff);
+			__skb_unlink(retry_mpdu, retry_queue);
 			skb_info = (struct SKB_info_st *)(retry_mpdu->head);
 			skb_info->ampdu_tx_status = AMPDU_ST_DROPPED;
+			__skb_queue_tail(&drop_q, retry_mpdu);
 			ampdu_tid->mib.ampdu_mib_discard_counter++;
 			continue;
 		}
 		new_total_skb_size = total_skb_size + retry_mpdu->len;
 		if (new_total_skb_size > ampdu_hdr->max_size)
 			break;
-		total_skb_size = new_total_skb_size;
 		retry_mpdu = __skb_dequeue(retry_queue);
-		_put_mpdu_to_ampdu(new_ampdu_skb, retry_mpdu);
+		if (!_put_mpdu_to_ampdu(new_ampdu_skb, retry_mpdu)) {
+			__skb_queue_head(retry_queue, retry_mpdu);
+			break;
+		}
+		total_skb_size = new_total_skb_size;
 		ampdu_tid->mib.ampdu_mib_retry_counter++;
 	}
 	ampdu_tid->mib.ampdu_mib_aggr_retry_counter += 1;
 	ampdu_tid->mib.ampdu_mib_dist[temp_i] += 1;
 	spin_unlock_irqrestore(&retry_queue->lock, flags);
+	if (!skb_queue_empty(&drop_q)) {
+		struct sk_buff *skb, *tmp;
+		spin_lock_bh(&ampdu_tid->pkt_array_lock);
+		skb_queue_walk_safe(&drop_q, skb, tmp) {
+			u16 sn = ampdu_skb_ssn(skb);
+			if (INDEX_PKT_BY_SSN(ampdu_tid, sn) != skb)
+				continue;
+			__skb_unlink(skb, &drop_q);
+			ampdu_tid->acked_map |= SSN_TO_SLOT_BIT(sn);
+		}
+		spin_unlock_bh(&ampdu_tid->pkt_array_lock);
+		while ((retry_mpdu = __skb_dequeue(&drop_q)) != NULL) {
+			skb_pull(retry_mpdu, AMPDU_DELIMITER_LEN);
+			ieee80211_free_txskb(sc->hw, retry_mpdu);
+		}
+	}
 	if (ampdu_hdr->mpdu_num == 0) {
-		dev_kfree_skb_any(new_ampdu_skb);
+		ssv6200_ampdu_release_skb(new_ampdu_skb, sc->hw);
 		return NULL;
 	}
 	return new_ampdu_skb;
@@ -359,7 +497,7 @@ static void ssv6200_ampdu_send_retry(struct ieee80211_hw *hw,
 		return;
 	ampdu_retry_skb = skb_peek(ampdu_skb_retry_queue_p);
 	lowest_rate = ssv62xx_ht_rate_update(ampdu_retry_skb, sc, rates);
-	max_agg_len = ampdu_max_transmit_length[lowest_rate];
+	max_agg_len = _ampdu_tid_max_len(cur_ampdu_tid, lowest_rate);
 	if (max_agg_len > 0) {
 		u32 cur_ampdu_max_size = SSV_GET_MAX_AMPDU_SIZE(sc->sh);
 		if (max_agg_len >= cur_ampdu_max_size)
@@ -407,11 +545,98 @@ static void ssv6200_ampdu_send_retry(struct ieee80211_hw *hw,
 	}
 }
 
+/*
+ * Containers are allocated with the data offset already chosen so the TX
+ * descriptor pushed in front of the MPDUs is 4-byte aligned, and reset to
+ * the same offset when they come back.
+ */
+static void _ampdu_pool_reset(struct ssv_ampdu_pool *pool, struct sk_buff *skb)
+{
+	skb->data = skb->head;
+	skb_reset_tail_pointer(skb);
+	skb_reserve(skb, pool->reserve);
+	skb->len = 0;
+	skb->data_len = 0;
+	skb->truesize = SKB_TRUESIZE(skb_end_offset(skb));
+	skb->tstamp = ktime_set(0, 0);
+	memset(skb->cb, 0, sizeof(skb->cb));
+}
+
+static void _ampdu_pool_destructor(struct sk_buff *skb)
+{
+}
+
+static struct sk_buff *_ampdu_pool_get(struct ssv_softc *sc)
+{
+	struct ssv_ampdu_pool *pool = &sc->tx.ampdu_pool;
+	struct sk_buff *skb = skb_dequeue(&pool->free_q);
+	if (skb != NULL)
+		return skb;
+	pool->miss_cnt++;
+	skb = alloc_skb(pool->reserve, GFP_KERNEL);
+	if (skb == NULL)
+		return NULL;
+	pool->alloc_cnt++;
+	skb->destructor = _ampdu_pool_destructor;
+	_ampdu_pool_reset(pool, skb);
+	return skb;
+}
+
+static void _ampdu_pool_put(struct ssv_softc *sc, struct sk_buff *skb)
+{
+	struct ssv_ampdu_pool *pool = &sc->tx.ampdu_pool;
+	struct sk_buff *frag, *next;
+	if (skb_shared(skb) || skb_cloned(skb)
+	    || (skb_queue_len(&pool->free_q) >= SSV_AMPDU_POOL_DEPTH(sc->sh))) {
+		pool->drop_cnt++;
+		dev_kfree_skb_any(skb);
+		return;
+	}
+	for (frag = skb_shinfo(skb)->frag_list; frag != NULL; frag = next) {
+		next = frag->next;
+		dev_kfree_skb_any(frag);
+	}
+	skb_shinfo(skb)->frag_list = NULL;
+	_ampdu_pool_reset(pool, skb);
+	pool->recycle_cnt++;
+	skb_queue_tail(&pool->free_q, skb);
+}
+
+void ssv6xxx_ampdu_pool_purge(struct ssv_softc *sc)
+{
+	skb_queue_purge(&sc->tx.ampdu_pool.free_q);
+}
+
+#ifdef CONFIG_SSV6XXX_DEBUGFS
+ssize_t ssv6xxx_ampdu_pool_dump(struct ssv_softc *sc, char *buf,
+				ssize_t buf_size)
+{
+	struct ssv_ampdu_pool *pool = &sc->tx.ampdu_pool;
+	return scnprintf(buf, buf_size,
+			 "idle %u/%u\nalloc %u\nrecycle %u\nmiss %u\ndrop %u\n",
+			 skb_queue_len(&pool->free_q),
+			 SSV_AMPDU_POOL_DEPTH(sc->sh), pool->alloc_cnt,
+			 pool->recycle_cnt, pool->miss_cnt, pool->drop_cnt);
+}
+#endif
+
 void ssv6200_ampdu_init(struct ieee80211_hw *hw)
 {
 	struct ssv_softc *sc = hw->priv;
+	struct ssv_ampdu_pool *pool = &sc->tx.ampdu_pool;
+	u32 desc_len = sc->sh->tx_desc_len;
 	ssv6200_ampdu_hw_init(hw);
 	sc->tx.ampdu_tx_group_id = 0;
+	pool->reserve = ALIGN(hw->extra_tx_headroom - desc_len, 4) + desc_len;
+	while (skb_queue_len(&pool->free_q) < SSV_AMPDU_POOL_DEPTH(sc->sh)) {
+		struct sk_buff *skb = alloc_skb(pool->reserve, GFP_KERNEL);
+		if (skb == NULL)
+			break;
+		pool->alloc_cnt++;
+		skb->destructor = _ampdu_pool_destructor;
+		_ampdu_pool_reset(pool, skb);
+		skb_queue_tail(&pool->free_q, skb);
+	}
 #ifdef USE_ENCRYPT_WORK
 	INIT_WORK(&sc->ampdu_tx_encry_work, encry_work);
 	INIT_WORK(&sc->sync_hwkey_work, sync_hw_key_work);
@@ -424,7 +649,10 @@ void ssv6200_ampdu_deinit(struct ieee80211_hw *hw)
 
 void ssv6200_ampdu_release_skb(struct sk_buff *skb, struct ieee80211_hw *hw)
 {
-	ieee80211_free_txskb(hw, skb);
+	if (skb->destructor == _ampdu_pool_destructor)
+		_ampdu_pool_put(hw->priv, skb);
+	else
+		ieee80211_free_txskb(hw, skb);
 }
 
 #ifdef CONFIG_SSV6XXX_DEBUGFS
@@ -644,6 +872,20 @@ static void ssv6200_ampdu_tx_init_debugfs(struct ssv_softc *sc,
 				   &ampdu_mib->ampdu_mib_BA_counter);
 		debugfs_create_u32("Pass", 00444, ampdu_tx_debugfs_dir,
 				   &ampdu_mib->ampdu_mib_pass_counter);
+		debugfs_create_u32("airtime_target_us", 00644,
+				   ampdu_tx_debugfs_dir,
+				   &ampdu_tid->airtime_target_us);
+		debugfs_create_u32("ba_success", 00444, ampdu_tx_debugfs_dir,
+				   &ampdu_tid->ba_success);
+		debugfs_create_u32("aggr_num_limit", 00444,
+				   ampdu_tx_debugfs_dir,
+				   &ampdu_tid->aggr_num_limit);
+		debugfs_create_u32("aggr_len_limit", 00444,
+				   ampdu_tx_debugfs_dir,
+				   &ampdu_tid->aggr_len_limit);
+		debugfs_create_u32("aggr_rate_idx", 00444,
+				   ampdu_tx_debugfs_dir,
+				   &ampdu_tid->aggr_rate_idx);
 		for (j = 0; j <= SSV_AMPDU_aggr_num_max; j++) {
 			char dist_dbg_name[10];
 			snprintf(dist_dbg_name, sizeof(dist_dbg_name),
@@ -667,6 +909,14 @@ void ssv6200_ampdu_tx_add_sta(struct ieee80211_hw *hw,
 	for (temp_i = 0; temp_i < WMM_TID_NUM; temp_i++) {
 		ssv_sta_priv->ampdu_tid[temp_i].sta = sta;
 		ssv_sta_priv->ampdu_tid[temp_i].state = AMPDU_STATE_STOP;
+		ssv_sta_priv->ampdu_tid[temp_i].airtime_target_us =
+		    SSV_AMPDU_AIRTIME_TARGET_US;
+		ssv_sta_priv->ampdu_tid[temp_i].sc = sc;
+		ssv_sta_priv->ampdu_tid[temp_i].timer_flags = 0;
+		timer_setup(&ssv_sta_priv->ampdu_tid[temp_i].ba_timer,
+			    _ampdu_ba_timer_fn, 0);
+		timer_setup(&ssv_sta_priv->ampdu_tid[temp_i].flush_timer,
+			    _ampdu_flush_timer_fn, 0);
 		spin_lock_init(&ssv_sta_priv->ampdu_tid[temp_i].
 			       ampdu_skb_tx_queue_lock);
 		spin_lock_init(&ssv_sta_priv->ampdu_tid[temp_i].pkt_array_lock);
@@ -703,6 +953,8 @@ void ssv6200_ampdu_tx_start(u16 tid, struct ieee80211_sta *sta,
 			sc->tid[j] = ampdu_tid;
 	}
 #endif
+	timer_setup(&ampdu_tid->ba_timer, _ampdu_ba_timer_fn, 0);
+	timer_setup(&ampdu_tid->flush_timer, _ampdu_flush_timer_fn, 0);
 	list_add_tail_rcu(&ampdu_tid->list, &sc->tx.ampdu_tx_que);
 	skb_queue_head_init(&ampdu_tid->ampdu_skb_tx_queue);
 	skb_queue_head_init(&ampdu_tid->early_aggr_ampdu_q);
@@ -715,6 +967,9 @@ void ssv6200_ampdu_tx_start(u16 tid, struct ieee80211_sta *sta,
 	     (sizeof(ampdu_tid->aggr_pkts) / sizeof(ampdu_tid->aggr_pkts[0]));
 	     i++)
 		ampdu_tid->aggr_pkts[i] = 0;
+	ampdu_tid->sent_map = 0;
+	ampdu_tid->acked_map = 0;
+	ampdu_tid->retry_map = 0;
 	ampdu_tid->aggr_pkt_num = 0;
 	ampdu_tid->cur_ampdu_pkt = _alloc_ampdu_skb(sc, ampdu_tid, 0);
 #ifdef AMPDU_CHECK_SKB_SEQNO
@@ -738,6 +993,8 @@ void ssv6200_ampdu_tx_operation(u16 tid, struct ieee80211_sta *sta,
 	ssv_sta_priv->ampdu_tid[tid].tidno = tid;
 	ssv_sta_priv->ampdu_tid[tid].sta = sta;
 	ssv_sta_priv->ampdu_tid[tid].agg_num_max = MAX_AGGR_NUM;
+	ssv_sta_priv->ampdu_tid[tid].aggr_num_limit = MAX_AGGR_NUM;
+	ssv_sta_priv->ampdu_tid[tid].ba_success = 100;
 	if (buffer_size > IEEE80211_MAX_AMPDU_BUF) {
 		buffer_size = IEEE80211_MAX_AMPDU_BUF;
 	}
@@ -766,9 +1023,13 @@ void ssv6200_ampdu_tx_stop(u16 tid, struct ieee80211_sta *sta,
 	struct ssv_softc *sc = hw->priv;
 	struct ssv_sta_priv_data *ssv_sta_priv;
 	ssv_sta_priv = (struct ssv_sta_priv_data *)sta->drv_priv;
-	if (ssv_sta_priv->ampdu_tid[tid].state == AMPDU_STATE_STOP)
+	spin_lock_bh(&ssv_sta_priv->ampdu_tid[tid].pkt_array_lock);
+	if (ssv_sta_priv->ampdu_tid[tid].state == AMPDU_STATE_STOP) {
+		spin_unlock_bh(&ssv_sta_priv->ampdu_tid[tid].pkt_array_lock);
 		return;
+	}
 	ssv_sta_priv->ampdu_tid[tid].state = AMPDU_STATE_STOP;
+	spin_unlock_bh(&ssv_sta_priv->ampdu_tid[tid].pkt_array_lock);
 	dev_dbg(sc->dev, "ssv6200_ampdu_tx_stop\n");
 	if (!list_empty(&sc->tx.ampdu_tx_que)) {
 #ifdef DEBUG_AMPDU_FLUSH
@@ -792,6 +1053,9 @@ void ssv6200_ampdu_tx_stop(u16 tid, struct ieee80211_sta *sta,
 #endif
 		list_del_rcu(&ssv_sta_priv->ampdu_tid[tid].list);
 	}
+	ssv_timer_shutdown_sync(&ssv_sta_priv->ampdu_tid[tid].ba_timer);
+	ssv_timer_shutdown_sync(&ssv_sta_priv->ampdu_tid[tid].flush_timer);
+	ssv_sta_priv->ampdu_tid[tid].timer_flags = 0;
 	dev_dbg(sc->dev, "clear tx q len=%d\n",
 	       skb_queue_len(&ssv_sta_priv->ampdu_tid[tid].ampdu_skb_tx_queue));
 	_clear_mpdu_q(sc->hw, &ssv_sta_priv->ampdu_tid[tid].ampdu_skb_tx_queue,
@@ -808,7 +1072,8 @@ void ssv6200_ampdu_tx_stop(u16 tid, struct ieee80211_sta *sta,
 		      false);
 #endif
 	if (ssv_sta_priv->ampdu_tid[tid].cur_ampdu_pkt != NULL) {
-		dev_kfree_skb_any(ssv_sta_priv->ampdu_tid[tid].cur_ampdu_pkt);
+		ssv6200_ampdu_release_skb(ssv_sta_priv->ampdu_tid[tid].
+					  cur_ampdu_pkt, sc->hw);
 		ssv_sta_priv->ampdu_tid[tid].cur_ampdu_pkt = NULL;
 	}
 	ssv6200_tx_flow_control((void *)sc,
@@ -871,20 +1136,34 @@ void ssv6200_ampdu_tx_update_state(void *priv, struct ieee80211_sta *sta,
 	}
 }
 
-void _put_mpdu_to_ampdu(struct sk_buff *ampdu, struct sk_buff *mpdu)
+/*
+ * The A-MPDU skb only carries the TX descriptor in its linear part. Each
+ * delimited MPDU is chained to its frag_list as a clone, so the payload
+ * is shared with the original kept in mpdu_q for retries and HCI gathers
+ * the frame from the fragments instead of a copy.
+ */
+bool _put_mpdu_to_ampdu(struct sk_buff *ampdu, struct sk_buff *mpdu)
 {
 	bool is_empty_ampdu = (ampdu->len == 0);
-	unsigned char *data_dest;
 	struct ampdu_hdr_st *ampdu_hdr = (struct ampdu_hdr_st *)ampdu->head;
-	BUG_ON(skb_tailroom(ampdu) < mpdu->len);
-	data_dest = skb_tail_pointer(ampdu);
-	skb_put(ampdu, mpdu->len);
+	struct sk_buff *frag = skb_clone(mpdu, GFP_ATOMIC);
+	if (frag == NULL)
+		return false;
+	if (ampdu_hdr->frag_tail == NULL)
+		skb_shinfo(ampdu)->frag_list = frag;
+	else
+		ampdu_hdr->frag_tail->next = frag;
+	ampdu_hdr->frag_tail = frag;
+	ampdu->len += frag->len;
+	ampdu->data_len += frag->len;
+	ampdu->truesize += frag->truesize;
 	if (is_empty_ampdu) {
 		struct ieee80211_tx_info *ampdu_info = IEEE80211_SKB_CB(ampdu);
 		struct ieee80211_tx_info *mpdu_info = IEEE80211_SKB_CB(mpdu);
 		SKB_info *mpdu_skb_info = (SKB_info *) (mpdu->head);
 		u32 max_size_for_rate =
-		    ampdu_max_transmit_length[mpdu_skb_info->lowest_rate];
+		    _ampdu_tid_max_len(ampdu_hdr->ampdu_tid,
+				       mpdu_skb_info->lowest_rate);
 		BUG_ON(max_size_for_rate == 0);
 		memcpy(ampdu_info, mpdu_info, sizeof(struct ieee80211_tx_info));
 		skb_set_queue_mapping(ampdu, skb_get_queue_mapping(mpdu));
@@ -895,11 +1174,13 @@ void _put_mpdu_to_ampdu(struct sk_buff *ampdu, struct sk_buff *mpdu)
 		memcpy(ampdu_hdr->rates, mpdu_skb_info->rates,
 		       sizeof(ampdu_hdr->rates));
 	}
-	memcpy(data_dest, mpdu->data, mpdu->len);
 	__skb_queue_tail(&ampdu_hdr->mpdu_q, mpdu);
 	ampdu_hdr->ssn[ampdu_hdr->mpdu_num++] = ampdu_skb_ssn(mpdu);
 	ampdu_hdr->size += mpdu->len;
 	BUG_ON(ampdu_hdr->size > ampdu_hdr->max_size);
+	trace_ssv6xxx_ampdu_mpdu(mpdu, ampdu,
+				 ampdu_hdr->ssn[ampdu_hdr->mpdu_num - 1]);
+	return true;
 }
 
 u32 _flush_early_ampdu_q(struct ssv_softc *sc, struct AMPDU_TID_st *ampdu_tid)
@@ -949,7 +1230,6 @@ u32 _flush_early_ampdu_q(struct ssv_softc *sc, struct AMPDU_TID_st *ampdu_tid)
 	return flushed_ampdu;
 }
 
-volatile int max_aggr_num = 24;
 void _aggr_ampdu_tx_q(struct ieee80211_hw *hw, struct AMPDU_TID_st *ampdu_tid)
 {
 	struct ssv_softc *sc = hw->priv;
@@ -986,19 +1266,27 @@ void _aggr_ampdu_tx_q(struct ieee80211_hw *hw, struct AMPDU_TID_st *ampdu_tid)
 			mpdu_skb =
 			    __skb_dequeue(&ampdu_tid->ampdu_skb_tx_queue);
 			spin_unlock_irqrestore(&tx_q->lock, flags);
-			_put_mpdu_to_ampdu(ampdu_skb, mpdu_skb);
-		} while (++aggr_len < max_aggr_num);
-		if ((is_aggr_full || (aggr_len >= max_aggr_num))
+			if (!_put_mpdu_to_ampdu(ampdu_skb, mpdu_skb)) {
+				skb_queue_head(tx_q, mpdu_skb);
+				break;
+			}
+		} while (++aggr_len < ampdu_tid->aggr_num_limit);
+		if ((is_aggr_full || (aggr_len >= ampdu_tid->aggr_num_limit))
 		    || ((aggr_len > 0)
 			&& (skb_queue_len(&ampdu_tid->early_aggr_ampdu_q) == 0)
 			&& (ampdu_tid->ssv_baw_head == SSV_ILLEGAL_SN)
 			&& _is_skb_q_empty(sc, ampdu_skb))) {
 			_add_ampdu_txinfo(sc, ampdu_skb);
+			trace_ssv6xxx_ampdu_aggr(ampdu_skb,
+						 sc->tx.hw_txqid[ampdu_tid->ac],
+						 ampdu_tid->tidno,
+						 skb_queue_len(&ampdu_hdr->mpdu_q));
 			_queue_early_ampdu(sc, ampdu_tid, ampdu_skb);
 			ampdu_tid->cur_ampdu_pkt = ampdu_skb = NULL;
 		}
 		_flush_early_ampdu_q(sc, ampdu_tid);
 	}
+	_ampdu_arm_flush_timer(ampdu_tid);
 }
 
 void _queue_early_ampdu(struct ssv_softc *sc, struct AMPDU_TID_st *ampdu_tid,
@@ -1071,15 +1359,33 @@ void _flush_mpdu(struct ssv_softc *sc, struct ieee80211_sta *sta)
 	}
 }
 
+#ifdef REPORT_TX_STATUS_DIRECTLY
+/*
+ * Early status goes to mac80211 without a skb, on a copy of the tx_info,
+ * while the MPDU itself is aggregated in place and is freed through
+ * ieee80211_free_txskb() once released. The MPDU is orphaned so the
+ * socket gets its budget back as if it had been freed. Frames asking for
+ * their own TX status are not aggregated so their report stays exact.
+ */
+static void ssv6200_ampdu_report_tx_status(struct ieee80211_hw *hw,
+					   struct ieee80211_sta *sta,
+					   struct sk_buff *skb)
+{
+	struct ieee80211_tx_info info = *IEEE80211_SKB_CB(skb);
+	struct ieee80211_tx_status status = {
+		.sta = sta,
+		.info = &info,
+	};
+	info.flags |= IEEE80211_TX_STAT_ACK;
+	ieee80211_tx_status_ext(hw, &status);
+	skb_orphan(skb);
+}
+#endif
+
 bool ssv6200_ampdu_tx_handler(struct ieee80211_hw *hw, struct sk_buff *skb)
 {
 	struct ssv_softc *sc = hw->priv;
 	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
-#ifdef REPORT_TX_STATUS_DIRECTLY
-	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
-	struct sk_buff *tx_skb = skb;
-	struct sk_buff *copy_skb = NULL;
-#endif
 	struct SKB_info_st *mpdu_skb_info_p = (SKB_info *) (skb->head);
 	struct ieee80211_sta *sta = mpdu_skb_info_p->sta;
 	struct ssv_sta_priv_data *ssv_sta_priv =
@@ -1095,6 +1401,10 @@ bool ssv6200_ampdu_tx_handler(struct ieee80211_hw *hw, struct sk_buff *skb)
 	ampdu_tid = &ssv_sta_priv->ampdu_tid[tidno];
 	if (ampdu_tid->state != AMPDU_STATE_OPERATION)
 		return false;
+#ifdef REPORT_TX_STATUS_DIRECTLY
+	if (IEEE80211_SKB_CB(skb)->flags & IEEE80211_TX_CTL_REQ_TX_STATUS)
+		return false;
+#endif
 #ifdef AMPDU_CHECK_SKB_SEQNO
 	{
 		u32 skb_seqno = ((struct ieee80211_hdr *)(skb->data))->seq_ctrl
@@ -1120,23 +1430,20 @@ bool ssv6200_ampdu_tx_handler(struct ieee80211_hw *hw, struct sk_buff *skb)
 	mpdu_skb_info_p->ampdu_tx_status = AMPDU_ST_NON_AMPDU;
 	mpdu_skb_info_p->ampdu_tx_final_retry_count = 0;
 	ssv_sta_priv->ampdu_tid[tidno].ac = skb_get_queue_mapping(skb);
-#ifdef REPORT_TX_STATUS_DIRECTLY
-	info->flags |= IEEE80211_TX_STAT_ACK;
-	copy_skb = skb_copy(tx_skb, GFP_ATOMIC);
-	if (!copy_skb) {
-		dev_err(sc->dev, "create TX skb copy failed!\n");
-		return false;
-	}
-	ieee80211_tx_status(sc->hw, tx_skb);
-	skb = copy_skb;
-#endif
 	{
 		bool ret;
 		ret = ssv6200_ampdu_add_delimiter_and_crc32(skb);
-		if (ret == false) {
-			ssv6200_ampdu_release_skb(skb, hw);
+		if (ret == false)
 			return false;
-		}
+#ifdef SSV_TXQ_SCHED
+		ieee80211_sta_register_airtime(sta, tidno,
+					       skb->len * 8 * 1000 /
+					       ampdu_rate_kbps[mpdu_skb_info_p->
+							       lowest_rate], 0);
+#endif
+#ifdef REPORT_TX_STATUS_DIRECTLY
+		ssv6200_ampdu_report_tx_status(hw, sta, skb);
+#endif
 		skb_queue_tail(&ssv_sta_priv->ampdu_tid[tidno].
 			       ampdu_skb_tx_queue, skb);
 		ssv_sta_priv->ampdu_tid[tidno].timestamp = jiffies;
@@ -1145,6 +1452,38 @@ bool ssv6200_ampdu_tx_handler(struct ieee80211_hw *hw, struct sk_buff *skb)
 	return true;
 }
 
+static u32 _ampdu_flush_tid(struct ssv_softc *sc,
+			    struct AMPDU_TID_st *cur_AMPDU_TID)
+{
+	u32 flushed_ampdu = 0;
+	if (cur_AMPDU_TID->state != AMPDU_STATE_OPERATION) {
+		struct ieee80211_sta *sta = cur_AMPDU_TID->sta;
+		struct ssv_sta_priv_data *sta_priv =
+		    (struct ssv_sta_priv_data *)sta->drv_priv;
+		dev_dbg(sc->dev, "STA %d TID %d is @%d\n",
+			sta_priv->sta_idx, cur_AMPDU_TID->tidno,
+			cur_AMPDU_TID->state);
+		return 0;
+	}
+	if ((skb_queue_len(&cur_AMPDU_TID->early_aggr_ampdu_q) == 0)
+	    && (cur_AMPDU_TID->cur_ampdu_pkt != NULL)) {
+		struct ampdu_hdr_st *ampdu_hdr =
+		    (struct ampdu_hdr_st *)(cur_AMPDU_TID->cur_ampdu_pkt->head);
+		u32 aggr_len = skb_queue_len(&ampdu_hdr->mpdu_q);
+		if (aggr_len) {
+			struct sk_buff *ampdu_skb =
+			    cur_AMPDU_TID->cur_ampdu_pkt;
+			cur_AMPDU_TID->cur_ampdu_pkt = NULL;
+			_add_ampdu_txinfo(sc, ampdu_skb);
+			_queue_early_ampdu(sc, cur_AMPDU_TID, ampdu_skb);
+		}
+	}
+	if (skb_queue_len(&cur_AMPDU_TID->early_aggr_ampdu_q) > 0)
+		flushed_ampdu = _flush_early_ampdu_q(sc, cur_AMPDU_TID);
+	_ampdu_arm_flush_timer(cur_AMPDU_TID);
+	return flushed_ampdu;
+}
+
 u32 ssv6xxx_ampdu_flush(struct ieee80211_hw *hw)
 {
 	struct ssv_softc *sc = hw->priv;
@@ -1168,44 +1507,27 @@ u32 ssv6xxx_ampdu_flush(struct ieee80211_hw *hw)
 				}
 			}
 #endif
-			if (cur_AMPDU_TID->state != AMPDU_STATE_OPERATION) {
-				struct ieee80211_sta *sta = cur_AMPDU_TID->sta;
-				struct ssv_sta_priv_data *sta_priv =
-				    (struct ssv_sta_priv_data *)sta->drv_priv;
-				dev_dbg(sc->dev, "STA %d TID %d is @%d\n",
-					sta_priv->sta_idx, cur_AMPDU_TID->tidno,
-					cur_AMPDU_TID->state);
-				continue;
-			}
-			if ((cur_AMPDU_TID->state == AMPDU_STATE_OPERATION)
-			    &&
-			    (skb_queue_len(&cur_AMPDU_TID->early_aggr_ampdu_q)
-			     == 0)
-			    && (cur_AMPDU_TID->cur_ampdu_pkt != NULL)) {
-				struct ampdu_hdr_st *ampdu_hdr =
-				    (struct ampdu_hdr_st *)(cur_AMPDU_TID->
-							    cur_ampdu_pkt->
-							    head);
-				u32 aggr_len =
-				    skb_queue_len(&ampdu_hdr->mpdu_q);
-				if (aggr_len) {
-					struct sk_buff *ampdu_skb =
-					    cur_AMPDU_TID->cur_ampdu_pkt;
-					cur_AMPDU_TID->cur_ampdu_pkt = NULL;
-					_add_ampdu_txinfo(sc, ampdu_skb);
-					_queue_early_ampdu(sc, cur_AMPDU_TID,
-							   ampdu_skb);
-				}
-			}
-			if (skb_queue_len(&cur_AMPDU_TID->early_aggr_ampdu_q) >
-			    0)
-				flushed_ampdu +=
-				    _flush_early_ampdu_q(sc, cur_AMPDU_TID);
+			flushed_ampdu += _ampdu_flush_tid(sc, cur_AMPDU_TID);
 		}
 	}
 	return flushed_ampdu;
 }
 
+void ssv6xxx_ampdu_flush_expired(struct ieee80211_hw *hw)
+{
+	struct ssv_softc *sc = hw->priv;
+	struct AMPDU_TID_st *cur_AMPDU_TID;
+	if (!list_empty(&sc->tx.ampdu_tx_que)) {
+		list_for_each_entry_rcu(cur_AMPDU_TID, &sc->tx.ampdu_tx_que,
+					list) {
+			if (!test_and_clear_bit(SSV_AMPDU_TIMER_FLUSH,
+						&cur_AMPDU_TID->timer_flags))
+				continue;
+			_ampdu_flush_tid(sc, cur_AMPDU_TID);
+		}
+	}
+}
+
 int _dump_BA_notification(char *buf,
 			  struct ampdu_ba_notify_data *ba_notification)
 {
@@ -1241,178 +1563,116 @@ int _dump_ba_skb(char *buf, int buf_size, struct sk_buff *ba_skb)
 	return prt_size;
 }
 
-static bool _ssn_to_bit_idx(u32 start_ssn, u32 mpdu_ssn, u32 * word_idx,
-			    u32 * bit_idx)
+/*
+ * The TX window is tracked per slot (SSN modulo the window size) in three
+ * bitmaps: sent_map for frames waiting on a BA, acked_map for frames done
+ * or dropped and ready to release, retry_map for frames to be collected
+ * for retransmission. All three are protected by pkt_array_lock.
+ */
+static void _release_frames(struct AMPDU_TID_st *ampdu_tid)
 {
-	u32 ret_bit_idx, ret_word_idx = 0;
-	s32 diff = mpdu_ssn - start_ssn;
-	if (diff >= 0) {
-		if (diff >= SSV_AMPDU_BA_WINDOW_SIZE) {
-			return false;
-		}
-		ret_bit_idx = diff;
-	} else {
-		diff = -diff;
-		if (diff <= (SSV_AMPDU_MAX_SSN - SSV_AMPDU_BA_WINDOW_SIZE)) {
-			*word_idx = 0;
-			*bit_idx = 0;
-			return false;
-		}
-		ret_bit_idx = SSV_AMPDU_MAX_SSN - diff;
+	u32 head_ssn;
+	u64 done;
+	u32 num, i;
+	spin_lock_bh(&ampdu_tid->pkt_array_lock);
+	head_ssn = ampdu_tid->ssv_baw_head;
+	if (head_ssn >= SSV_AMPDU_MAX_SSN) {
+		spin_unlock_bh(&ampdu_tid->pkt_array_lock);
+		prn_aggr_err("l x.x %d\n", head_ssn);
+		return;
 	}
-	if (ret_bit_idx >= 32) {
-		ret_bit_idx -= 32;
-		ret_word_idx = 1;
+	done = ror64(ampdu_tid->acked_map, SSN_TO_SLOT(head_ssn));
+	num = (~done) ? __ffs64(~done) : SSV_AMPDU_BA_WINDOW_SIZE;
+	for (i = 0; i < num; i++) {
+		struct sk_buff **skb = &INDEX_PKT_BY_SSN(ampdu_tid, head_ssn);
+		struct SKB_info_st *skb_info =
+		    (struct SKB_info_st *)((*skb)->head);
+		if (skb_info->ampdu_tx_status == AMPDU_ST_DROPPED)
+			ampdu_tid->mib.ampdu_mib_discard_counter++;
+		__skb_queue_tail(&ampdu_tid->release_queue, *skb);
+		*skb = NULL;
+		ampdu_tid->acked_map &= ~SSN_TO_SLOT_BIT(head_ssn);
+		ampdu_tid->aggr_pkt_num--;
+		INC_PKT_SN(head_ssn);
 	}
-	*bit_idx = ret_bit_idx;
-	*word_idx = ret_word_idx;
-	return true;
+	if (INDEX_PKT_BY_SSN(ampdu_tid, head_ssn) == NULL)
+		head_ssn = SSV_ILLEGAL_SN;
+	ampdu_tid->ssv_baw_head = head_ssn;
+	spin_unlock_bh(&ampdu_tid->pkt_array_lock);
 }
 
-static bool _inc_bit_idx(u32 ssn_1st, u32 ssn_next, u32 * word_idx,
-			 u32 * bit_idx)
+static u32 _mark_timeout_frames(struct AMPDU_TID_st *ampdu_tid,
+				unsigned long *next_check)
 {
-	u32 ret_word_idx = *word_idx, ret_bit_idx = *bit_idx;
-	s32 diff = (s32) ssn_1st - (s32) ssn_next;
-	if (diff > 0) {
-		if (diff < (SSV_AMPDU_MAX_SSN - SSV_AMPDU_BA_WINDOW_SIZE)) {
-			prn_aggr_err
-			    ("Irrational SN distance in AMPDU: %d %d.\n",
-			     ssn_1st, ssn_next);
-			return false;
+	u32 head_slot;
+	u32 has_retry = 0;
+	u64 sent;
+	if (ampdu_tid->ssv_baw_head == SSV_ILLEGAL_SN)
+		return 0;
+	head_slot = SSN_TO_SLOT(ampdu_tid->ssv_baw_head);
+	sent = ror64(ampdu_tid->sent_map, head_slot);
+	while (sent) {
+		u32 slot = SSN_TO_SLOT(__ffs64(sent) + head_slot);
+		struct sk_buff *skb = ampdu_tid->aggr_pkts[slot];
+		struct SKB_info_st *skb_info = (SKB_info *) (skb->head);
+		unsigned long timeout_jiffies = skb_info->aggr_timestamp
+		    + msecs_to_jiffies(BA_WAIT_TIMEOUT);
+		sent &= sent - 1;
+		if (time_before(jiffies, timeout_jiffies)) {
+			if (next_check != NULL)
+				*next_check = timeout_jiffies;
+			break;
 		}
-		diff = SSV_AMPDU_MAX_SSN - diff;
-	} else {
-		diff = -diff;
-	}
-	if (diff > SSV_AMPDU_MAX_SSN)
-		prn_aggr_err("DF %d - %d = %d\n", ssn_1st, ssn_next, diff);
-	ret_bit_idx += diff;
-	if (ret_bit_idx >= 32) {
-		ret_bit_idx -= 32;
-		ret_word_idx++;
+		prn_aggr_err("rt S%d-T%d-%d (%u)\n",
+			     ((struct ssv_sta_priv_data *)skb_info->sta->
+			      drv_priv)->sta_idx, ampdu_tid->tidno,
+			     ampdu_skb_ssn(skb),
+			     jiffies_to_msecs(jiffies -
+					      skb_info->aggr_timestamp));
+		has_retry += _mark_skb_retry(ampdu_tid, skb_info, skb);
 	}
-	*word_idx = ret_word_idx;
-	*bit_idx = ret_bit_idx;
-	return true;
+	return has_retry;
 }
 
-static void _release_frames(struct AMPDU_TID_st *ampdu_tid)
+static int _collect_retry_frames(struct AMPDU_TID_st *ampdu_tid)
 {
-	u32 head_ssn, head_ssn_before, last_ssn;
-	struct sk_buff **skb;
-	struct SKB_info_st *skb_info;
+	struct sk_buff_head retry_q;
+	unsigned long flags;
+	u32 head_slot;
+	u64 retry;
+	int num_retry;
+	__skb_queue_head_init(&retry_q);
 	spin_lock_bh(&ampdu_tid->pkt_array_lock);
-	head_ssn_before = ampdu_tid->ssv_baw_head;
-	if (head_ssn_before >= SSV_AMPDU_MAX_SSN) {
+	if (ampdu_tid->ssv_baw_head == SSV_ILLEGAL_SN) {
 		spin_unlock_bh(&ampdu_tid->pkt_array_lock);
-		prn_aggr_err("l x.x %d\n", head_ssn_before);
-		return;
+		return 0;
+	}
+	_mark_timeout_frames(ampdu_tid, NULL);
+	head_slot = SSN_TO_SLOT(ampdu_tid->ssv_baw_head);
+	retry = ror64(ampdu_tid->retry_map, head_slot);
+	ampdu_tid->retry_map = 0;
+	while (retry) {
+		u32 slot = SSN_TO_SLOT(__ffs64(retry) + head_slot);
+		retry &= retry - 1;
+		__skb_queue_tail(&retry_q, ampdu_tid->aggr_pkts[slot]);
 	}
-	head_ssn = ampdu_tid->ssv_baw_head;
-	last_ssn = head_ssn;
-	do {
-		skb = &INDEX_PKT_BY_SSN(ampdu_tid, head_ssn);
-		if (*skb == NULL) {
-			head_ssn = SSV_ILLEGAL_SN;
-			{
-				int i;
-				char sn_str[66 * 5] = "";
-				char *str = sn_str;
-				for (i = 0; i < 64; i++)
-					if (ampdu_tid->aggr_pkts[i] != NULL) {
-						str += sprintf(str, "%d ",
-							       ampdu_skb_ssn
-							       (ampdu_tid->
-								aggr_pkts[i]));
-					}
-				*str = 0;
-				if (str == sn_str) {
-				} else
-					prn_aggr_err("ILL %d %d - %d (%s)\n",
-						     head_ssn_before, last_ssn,
-						     ampdu_tid->aggr_pkt_num,
-						     sn_str);
-			}
-			break;
-		}
-		skb_info = (struct SKB_info_st *)((*skb)->head);
-		if ((skb_info->ampdu_tx_status == AMPDU_ST_DONE)
-		    || (skb_info->ampdu_tx_status == AMPDU_ST_DROPPED)) {
-			__skb_queue_tail(&ampdu_tid->release_queue, *skb);
-			*skb = NULL;
-			last_ssn = head_ssn;
-			INC_PKT_SN(head_ssn);
-			ampdu_tid->aggr_pkt_num--;
-			if (skb_info->ampdu_tx_status == AMPDU_ST_DROPPED)
-				ampdu_tid->mib.ampdu_mib_discard_counter++;
-		} else {
-			break;
-		}
-	} while (1);
-	ampdu_tid->ssv_baw_head = head_ssn;
 	spin_unlock_bh(&ampdu_tid->pkt_array_lock);
-}
-
-static int _collect_retry_frames(struct AMPDU_TID_st *ampdu_tid)
-{
-	u16 ssn, head_ssn, end_ssn;
-	int num_retry = 0;
-	int timeout_check = 1;
-	unsigned long check_jiffies = jiffies;
-	head_ssn = ampdu_tid->ssv_baw_head;
-	ssn = head_ssn;
-	if (ssn == SSV_ILLEGAL_SN)
+	num_retry = skb_queue_len(&retry_q);
+	ampdu_tid->mib.ampdu_mib_retry_counter += num_retry;
+	ampdu_tid->timestamp = jiffies;
+	if (num_retry == 0)
 		return 0;
-	end_ssn = (head_ssn + SSV_AMPDU_BA_WINDOW_SIZE) % SSV_AMPDU_MAX_SSN;
-	do {
-		struct sk_buff *skb = INDEX_PKT_BY_SSN(ampdu_tid, ssn);
-		struct SKB_info_st *skb_info;
-		int timeout_retry = 0;
-		if (skb == NULL)
-			break;
-		skb_info = (SKB_info *) (skb->head);
-		if (timeout_check
-		    && (skb_info->ampdu_tx_status == AMPDU_ST_SENT)) {
-			unsigned long cur_jiffies = jiffies;
-			unsigned long timeout_jiffies = skb_info->aggr_timestamp
-			    + msecs_to_jiffies(BA_WAIT_TIMEOUT);
-			u32 delta_ms;
-			if (time_before(cur_jiffies, timeout_jiffies)) {
-				timeout_check = 0;
-				continue;
-			}
-			_mark_skb_retry(skb_info, skb);
-			delta_ms =
-			    jiffies_to_msecs(cur_jiffies -
-					     skb_info->aggr_timestamp);
-			prn_aggr_err("t S%d-T%d-%d (%u)\n",
-				     ((struct ssv_sta_priv_data *)skb_info->
-				      sta->drv_priv)->sta_idx, ampdu_tid->tidno,
-				     ssn, delta_ms);
-			if (delta_ms > 1000) {
-				prn_aggr_err("Last checktime %lu - %lu = %u\n",
-					     check_jiffies,
-					     ampdu_tid->timestamp,
-					     jiffies_to_msecs(check_jiffies -
-							      ampdu_tid->
-							      timestamp));
-			}
-			timeout_retry = 1;
-		}
-		if (skb_info->ampdu_tx_status == AMPDU_ST_RETRY) {
-			skb_queue_tail(&ampdu_tid->retry_queue, skb);
-			ampdu_tid->mib.ampdu_mib_retry_counter++;
-			num_retry++;
-		}
-		INC_PKT_SN(ssn);
-	} while (ssn != end_ssn);
-	ampdu_tid->timestamp = check_jiffies;
+	spin_lock_irqsave(&ampdu_tid->retry_queue.lock, flags);
+	skb_queue_splice_tail(&retry_q, &ampdu_tid->retry_queue);
+	spin_unlock_irqrestore(&ampdu_tid->retry_queue.lock, flags);
 	return num_retry;
 }
 
-int _mark_skb_retry(struct SKB_info_st *skb_info, struct sk_buff *skb)
+int _mark_skb_retry(struct AMPDU_TID_st *ampdu_tid,
+		    struct SKB_info_st *skb_info, struct sk_buff *skb)
 {
+	u64 slot_bit = SSN_TO_SLOT_BIT(ampdu_skb_ssn(skb));
+	ampdu_tid->sent_map &= ~slot_bit;
 	if (skb_info->mpdu_retry_counter < SSV_AMPDU_retry_counter_max) {
 		if (skb_info->mpdu_retry_counter == 0) {
 			struct ieee80211_hdr *skb_hdr = ampdu_skb_hdr(skb);
@@ -1421,83 +1681,83 @@ int _mark_skb_retry(struct SKB_info_st *skb_info, struct sk_buff *skb)
 		}
 		skb_info->ampdu_tx_status = AMPDU_ST_RETRY;
 		skb_info->mpdu_retry_counter++;
+		ampdu_tid->retry_map |= slot_bit;
 		return 1;
 	} else {
 		skb_info->ampdu_tx_status = AMPDU_ST_DROPPED;
+		ampdu_tid->acked_map |= slot_bit;
 		prn_aggr_err("p %d\n", ampdu_skb_ssn(skb));
 		return 0;
 	}
 }
 
-static u32 _ba_map_walker(struct AMPDU_TID_st *ampdu_tid, u32 start_ssn,
-			  u32 sn_bit_map[2],
-			  struct ampdu_ba_notify_data *ba_notify_data,
-			  u32 * p_acked_num)
+/*
+ * Map the SSNs of a BA notification to window slots. Called with
+ * pkt_array_lock held. A slot counts only while it is in flight and holds
+ * the frame with that SSN, so a late or duplicated notification cannot
+ * ack or retry the frame that reuses the slot one window later.
+ */
+static u64 _ba_aggr_map(struct AMPDU_TID_st *ampdu_tid,
+			struct ampdu_ba_notify_data *ba_notify_data,
+			u32 start_ssn, u64 *p_in_ba_map, u32 *p_aggr_num)
 {
-	int i = 0;
-	u32 ssn = ba_notify_data->seq_no[0];
-	u32 word_idx = (-1), bit_idx = (-1);
-	bool found = _ssn_to_bit_idx(start_ssn, ssn, &word_idx, &bit_idx);
-	bool first_found = found;
+	u64 aggr_map = 0, in_ba_map = 0, slot_bit;
 	u32 aggr_num = 0;
-	u32 acked_num = 0;
-	if (found && (word_idx >= 2 || bit_idx >= 32))
-		prn_aggr_err("idx error 1: %d %d %d %d\n",
-			     start_ssn, ssn, word_idx, bit_idx);
-	while ((i < MAX_AGGR_NUM) && (ssn < SSV_AMPDU_MAX_SSN)) {
-		u32 cur_ssn;
-		struct sk_buff *skb = INDEX_PKT_BY_SSN(ampdu_tid, ssn);
-		u32 skb_ssn = (skb == NULL) ? (-1) : ampdu_skb_ssn(skb);
-		struct SKB_info_st *skb_info;
-		aggr_num++;
-		if (skb_ssn != ssn) {
-			prn_aggr_err("Unmatched SSN packet: %d - %d - %d\n",
-				     ssn, skb_ssn, start_ssn);
-		} else {
-			skb_info = (struct SKB_info_st *)(skb->head);
-			if (found && (sn_bit_map[word_idx] & (1 << bit_idx))) {
-				if (skb_info->ampdu_tx_status != AMPDU_ST_SENT) {
-					pr_err("BA marks a MPDU of status %d!\n",
-					       skb_info->ampdu_tx_status);
-				}
-				skb_info->ampdu_tx_status = AMPDU_ST_DONE;
-				acked_num++;
-			} else {
-				_mark_skb_retry(skb_info, skb);
-			}
-		}
-		cur_ssn = ssn;
-		if (++i >= MAX_AGGR_NUM)
-			break;
-		ssn = ba_notify_data->seq_no[i];
+	struct sk_buff *mpdu;
+	int i;
+	for (i = 0; i < MAX_AGGR_NUM; i++) {
+		u32 ssn = ba_notify_data->seq_no[i];
 		if (ssn >= SSV_AMPDU_MAX_SSN)
 			break;
-		if (first_found) {
-			u32 old_word_idx = word_idx, old_bit_idx = bit_idx;
-			found = _inc_bit_idx(cur_ssn, ssn, &word_idx, &bit_idx);
-			if (found && (word_idx >= 2 || bit_idx >= 32)) {
-				prn_aggr_err
-				    ("idx error 2: %d 0x%08X 0X%08X %d %d (%d %d) (%d %d)\n",
-				     start_ssn, sn_bit_map[1], sn_bit_map[0],
-				     cur_ssn, ssn, word_idx, bit_idx,
-				     old_word_idx, old_bit_idx);
-				found = false;
-			} else if (!found) {
-				char strbuf[256];
-				_dump_BA_notification(strbuf, ba_notify_data);
-				prn_aggr_err("SN out-of-order: %d\n%s\n",
-					     start_ssn, strbuf);
-			}
-		} else {
-			found =
-			    _ssn_to_bit_idx(start_ssn, ssn, &word_idx,
-					    &bit_idx);
-			first_found = found;
-			if (found && (word_idx >= 2 || bit_idx >= 32))
-				prn_aggr_err("idx error 3: %d %d %d %d\n",
-					     cur_ssn, ssn, word_idx, bit_idx);
+		aggr_num++;
+		slot_bit = SSN_TO_SLOT_BIT(ssn);
+		if (!(ampdu_tid->sent_map & slot_bit))
+			continue;
+		mpdu = INDEX_PKT_BY_SSN(ampdu_tid, ssn);
+		if ((mpdu == NULL) || (ampdu_skb_ssn(mpdu) != ssn)) {
+			prn_aggr_err("Unmatched SSN packet: %d - %d\n", ssn,
+				     mpdu ? ampdu_skb_ssn(mpdu) : -1);
+			continue;
 		}
+		aggr_map |= slot_bit;
+		if (((ssn - start_ssn) % SSV_AMPDU_MAX_SSN)
+		    < SSV_AMPDU_BA_WINDOW_SIZE)
+			in_ba_map |= slot_bit;
+	}
+	if (p_in_ba_map != NULL)
+		*p_in_ba_map = in_ba_map;
+	*p_aggr_num = aggr_num;
+	return aggr_map;
+}
+
+static u32 _ba_map_walker(struct AMPDU_TID_st *ampdu_tid, u32 start_ssn,
+			  u32 sn_bit_map[2],
+			  struct ampdu_ba_notify_data *ba_notify_data,
+			  u32 * p_acked_num)
+{
+	u64 ba_map = ((u64) sn_bit_map[1] << 32) | sn_bit_map[0];
+	u64 aggr_map, in_ba_map, acked, lost;
+	u32 aggr_num, acked_num;
+	spin_lock_bh(&ampdu_tid->pkt_array_lock);
+	aggr_map = _ba_aggr_map(ampdu_tid, ba_notify_data, start_ssn,
+				&in_ba_map, &aggr_num);
+	ba_map = rol64(ba_map, SSN_TO_SLOT(start_ssn)) & in_ba_map;
+	acked = aggr_map & ba_map;
+	lost = aggr_map & ~ba_map;
+	acked_num = hweight64(acked);
+	ampdu_tid->sent_map &= ~acked;
+	ampdu_tid->acked_map |= acked;
+	while (acked) {
+		struct sk_buff *skb = ampdu_tid->aggr_pkts[__ffs64(acked)];
+		acked &= acked - 1;
+		((SKB_info *) (skb->head))->ampdu_tx_status = AMPDU_ST_DONE;
+	}
+	while (lost) {
+		struct sk_buff *skb = ampdu_tid->aggr_pkts[__ffs64(lost)];
+		lost &= lost - 1;
+		_mark_skb_retry(ampdu_tid, (SKB_info *) (skb->head), skb);
 	}
+	spin_unlock_bh(&ampdu_tid->pkt_array_lock);
 	_release_frames(ampdu_tid);
 	if (p_acked_num != NULL)
 		*p_acked_num = acked_num;
@@ -1523,7 +1783,7 @@ static void _flush_release_queue(struct ieee80211_hw *hw,
 		tx_info->status.ampdu_len = 1;
 		tx_info->status.ampdu_ack_len = 1;
 #ifdef REPORT_TX_STATUS_DIRECTLY
-		dev_kfree_skb_any(ampdu_skb);
+		ieee80211_free_txskb(hw, ampdu_skb);
 #else
 #if defined(USE_THREAD_RX) && !defined(IRQ_PROC_TX_DATA)
 		ieee80211_tx_status(hw, ampdu_skb);
@@ -1547,8 +1807,8 @@ void ssv6200_ampdu_no_BA_handler(struct ieee80211_hw *hw, struct sk_buff *skb)
 	struct ssv_sta_priv_data *ssv_sta_priv;
 	char seq_str[256];
 	struct AMPDU_TID_st *ampdu_tid;
-	int i;
-	u16 aggr_num = 0;
+	u32 aggr_num = 0;
+	u64 lost;
 	struct firmware_rate_control_report_data *report_data;
 	if (sta == NULL) {
 		prn_aggr_err
@@ -1568,52 +1828,24 @@ void ssv6200_ampdu_no_BA_handler(struct ieee80211_hw *hw, struct sk_buff *skb)
 		dev_kfree_skb_any(skb);
 		return;
 	}
-	for (i = 0; i < MAX_AGGR_NUM; i++) {
-		u32 ssn = ba_notification->seq_no[i];
-		struct sk_buff *skb;
-		u32 skb_ssn;
-		struct SKB_info_st *skb_info;
-		if (ssn >= (4096))
-			break;
-		aggr_num++;
-		skb = INDEX_PKT_BY_SSN(ampdu_tid, ssn);
-		skb_ssn = (skb == NULL) ? (-1) : ampdu_skb_ssn(skb);
-		if (skb_ssn != ssn) {
-			prn_aggr_err("Unmatched SSN packet: %d - %d\n", ssn,
-				     skb_ssn);
-			continue;
-		}
-		skb_info = (struct SKB_info_st *)(skb->head);
-		if (skb_info->ampdu_tx_status == AMPDU_ST_SENT) {
-			if (skb_info->mpdu_retry_counter <
-			    SSV_AMPDU_retry_counter_max) {
-				if (skb_info->mpdu_retry_counter == 0) {
-					struct ieee80211_hdr *skb_hdr =
-					    ampdu_skb_hdr(skb);
-					skb_hdr->frame_control |=
-					    cpu_to_le16(IEEE80211_FCTL_RETRY);
-				}
-				skb_info->ampdu_tx_status = AMPDU_ST_RETRY;
-				skb_info->mpdu_retry_counter++;
-			} else {
-				skb_info->ampdu_tx_status = AMPDU_ST_DROPPED;
-				prn_aggr_err("p %d\n", skb_ssn);
-			}
-		} else {
-			prn_aggr_err("S %d %d\n", skb_ssn,
-				     skb_info->ampdu_tx_status);
-		}
+	spin_lock_bh(&ampdu_tid->pkt_array_lock);
+	lost = _ba_aggr_map(ampdu_tid, ba_notification, 0, NULL, &aggr_num);
+	while (lost) {
+		struct sk_buff *mpdu = ampdu_tid->aggr_pkts[__ffs64(lost)];
+		lost &= lost - 1;
+		_mark_skb_retry(ampdu_tid, (SKB_info *) (mpdu->head), mpdu);
 	}
+	spin_unlock_bh(&ampdu_tid->pkt_array_lock);
 	_release_frames(ampdu_tid);
+	_ampdu_tid_ba_update(ampdu_tid, aggr_num, 0);
 	host_event->h_event = SOC_EVT_RC_AMPDU_REPORT;
 	report_data =
 	    (struct firmware_rate_control_report_data *)&host_event->dat[0];
 	report_data->ampdu_len = aggr_num;
 	report_data->ampdu_ack_len = 0;
 	report_data->wsid = ssv_sta_priv->sta_info->hw_wsid;
-	skb_queue_tail(&sc->rc_report_queue, skb);
-	if (sc->rc_sample_sechedule == 0)
-		queue_work(sc->rc_sample_workqueue, &sc->rc_sample_work);
+	ssv6xxx_rc_report_put(sc, SOC_EVT_RC_AMPDU_REPORT, report_data);
+	dev_kfree_skb_any(skb);
 }
 
 void ssv6200_ampdu_BA_handler(struct ieee80211_hw *hw, struct sk_buff *skb)
@@ -1629,8 +1861,8 @@ void ssv6200_ampdu_BA_handler(struct ieee80211_hw *hw, struct sk_buff *skb)
 	u32 ssn, aggr_num = 0, acked_num = 0;
 	u8 tid_no;
 	u32 sn_bit_map[2];
-	struct firmware_rate_control_report_data *report_data;
-	HDR_HostEvent *host_evt;
+	struct firmware_rate_control_report_data rc_report;
+	struct firmware_rate_control_report_data *report_data = &rc_report;
 	sta = ssv6xxx_find_sta_by_rx_skb(sc, skb);
 	if (sta == NULL) {
 		if (skb->len > AMPDU_BA_FRAME_LEN) {
@@ -1677,6 +1909,8 @@ void ssv6200_ampdu_BA_handler(struct ieee80211_hw *hw, struct sk_buff *skb)
 	aggr_num =
 	    _ba_map_walker(&(ssv_sta_priv->ampdu_tid[tid_no]), ssn, sn_bit_map,
 			   ba_notification, &acked_num);
+	_ampdu_tid_ba_update(&ssv_sta_priv->ampdu_tid[tid_no], aggr_num,
+			     acked_num);
 #ifdef CONFIG_SSV6XXX_DEBUGFS
 	if (ssv_sta_priv->ampdu_tid[tid_no].debugfs_dir) {
 		struct sk_buff *dup_skb;
@@ -1692,11 +1926,6 @@ void ssv6200_ampdu_BA_handler(struct ieee80211_hw *hw, struct sk_buff *skb)
 				       dup_skb);
 	}
 #endif
-	skb_trim(skb, skb->len - sizeof(struct ampdu_ba_notify_data));
-	host_evt = (HDR_HostEvent *) skb->data;
-	host_evt->h_event = SOC_EVT_RC_AMPDU_REPORT;
-	report_data =
-	    (struct firmware_rate_control_report_data *)&host_evt->dat[0];
 	memcpy(report_data, ba_notification,
 	       sizeof(struct firmware_rate_control_report_data));
 	report_data->ampdu_len = aggr_num;
@@ -1721,9 +1950,8 @@ void ssv6200_ampdu_BA_handler(struct ieee80211_hw *hw, struct sk_buff *skb)
 		       aggr_num, acked_num);
 	}
 #endif
-	skb_queue_tail(&sc->rc_report_queue, skb);
-	if (sc->rc_sample_sechedule == 0)
-		queue_work(sc->rc_sample_workqueue, &sc->rc_sample_work);
+	ssv6xxx_rc_report_put(sc, SOC_EVT_RC_AMPDU_REPORT, report_data);
+	dev_kfree_skb_any(skb);
 }
 
 static void _postprocess_BA(struct ssv_softc *sc, struct ssv_sta_info *sta_info,
@@ -1970,32 +2198,21 @@ ssize_t ssv6xxx_ampdu_mib_dump(struct ieee80211_hw *hw, char *mib_str,
 struct sk_buff *_alloc_ampdu_skb(struct ssv_softc *sc,
 				 struct AMPDU_TID_st *ampdu_tid, u32 len)
 {
-	unsigned char *payload_addr;
-	u32 headroom = sc->hw->extra_tx_headroom;
-	u32 offset;
 	u32 cur_max_ampdu_size = SSV_GET_MAX_AMPDU_SIZE(sc->sh);
 	u32 extra_room = sc->sh->tx_desc_len * 2 + 48;
 	u32 max_physical_len = (len
 				&& ((len + extra_room) < cur_max_ampdu_size))
 	    ? (len + extra_room)
 	    : cur_max_ampdu_size;
-	u32 skb_len = max_physical_len + headroom + 3;
-	struct sk_buff *ampdu_skb = __dev_alloc_skb(skb_len, GFP_KERNEL);
+	struct sk_buff *ampdu_skb = _ampdu_pool_get(sc);
 	struct ampdu_hdr_st *ampdu_hdr;
 	if (ampdu_skb == NULL) {
-		dev_err(sc->dev, "AMPDU allocation of size %d(%d) failed\n",
-			len, skb_len);
+		dev_err(sc->dev, "AMPDU container allocation failed\n");
 		return NULL;
 	}
-	payload_addr = ampdu_skb->data + headroom - sc->sh->tx_desc_len;
-	offset = ((size_t)payload_addr) % 4U;
-	if (offset) {
-		dev_dbg(sc->dev, "Align AMPDU data %d\n", offset);
-		skb_reserve(ampdu_skb, headroom + 4 - offset);
-	} else
-		skb_reserve(ampdu_skb, headroom);
 	ampdu_hdr = (struct ampdu_hdr_st *)ampdu_skb->head;
 	skb_queue_head_init(&ampdu_hdr->mpdu_q);
+	ampdu_hdr->frag_tail = NULL;
 	ampdu_hdr->max_size = max_physical_len - extra_room;
 	ampdu_hdr->size = 0;
 	ampdu_hdr->ampdu_tid = ampdu_tid;
@@ -2013,46 +2230,16 @@ bool _is_skb_q_empty(struct ssv_softc *sc, struct sk_buff *skb)
 
 static u32 _check_timeout(struct AMPDU_TID_st *ampdu_tid)
 {
-	u16 ssn, head_ssn, end_ssn;
-	unsigned long check_jiffies = jiffies;
-	u32 has_retry = 0;
-	head_ssn = ampdu_tid->ssv_baw_head;
-	ssn = head_ssn;
-	if (ssn == SSV_ILLEGAL_SN)
+	unsigned long next_check = jiffies + msecs_to_jiffies(BA_WAIT_TIMEOUT);
+	u32 has_retry;
+	if (ampdu_tid->ssv_baw_head == SSV_ILLEGAL_SN)
 		return 0;
-	end_ssn = (head_ssn + SSV_AMPDU_BA_WINDOW_SIZE) % SSV_AMPDU_MAX_SSN;
-	do {
-		struct sk_buff *skb = INDEX_PKT_BY_SSN(ampdu_tid, ssn);
-		struct SKB_info_st *skb_info;
-		unsigned long cur_jiffies;
-		unsigned long timeout_jiffies;
-		u32 delta_ms;
-		if (skb == NULL)
-			break;
-		skb_info = (SKB_info *) (skb->head);
-		cur_jiffies = jiffies;
-		timeout_jiffies =
-		    skb_info->aggr_timestamp +
-		    msecs_to_jiffies(BA_WAIT_TIMEOUT);
-		if ((skb_info->ampdu_tx_status != AMPDU_ST_SENT)
-		    || time_before(cur_jiffies, timeout_jiffies))
-			break;
-		delta_ms =
-		    jiffies_to_msecs(cur_jiffies - skb_info->aggr_timestamp);
-		prn_aggr_err("rt S%d-T%d-%d (%u)\n",
-			     ((struct ssv_sta_priv_data *)skb_info->sta->
-			      drv_priv)->sta_idx, ampdu_tid->tidno, ssn,
-			     delta_ms);
-		if (delta_ms > 1000) {
-			prn_aggr_err("Last checktime %lu - %lu = %u\n",
-				     check_jiffies, ampdu_tid->timestamp,
-				     jiffies_to_msecs(check_jiffies -
-						      ampdu_tid->timestamp));
-		}
-		has_retry += _mark_skb_retry(skb_info, skb);
-		INC_PKT_SN(ssn);
-	} while (ssn != end_ssn);
-	ampdu_tid->timestamp = check_jiffies;
+	spin_lock_bh(&ampdu_tid->pkt_array_lock);
+	has_retry = _mark_timeout_frames(ampdu_tid, &next_check);
+	if ((ampdu_tid->state == AMPDU_STATE_OPERATION) && ampdu_tid->sent_map)
+		mod_timer(&ampdu_tid->ba_timer, next_check);
+	spin_unlock_bh(&ampdu_tid->pkt_array_lock);
+	ampdu_tid->timestamp = jiffies;
 	return has_retry;
 }
 
@@ -2064,6 +2251,9 @@ void ssv6xxx_ampdu_check_timeout(struct ieee80211_hw *hw)
 		list_for_each_entry_rcu(cur_AMPDU_TID, &sc->tx.ampdu_tx_que,
 					list) {
 			u32 has_retry;
+			if (!test_and_clear_bit(SSV_AMPDU_TIMER_BA,
+						&cur_AMPDU_TID->timer_flags))
+				continue;
 			if (cur_AMPDU_TID->state != AMPDU_STATE_OPERATION)
 				continue;
 			has_retry = _check_timeout(cur_AMPDU_TID);
@@ -2106,6 +2296,12 @@ void ssv6xxx_ampdu_sent(struct ieee80211_hw *hw, struct sk_buff *ampdu)
 		mpdu_skb_info = (SKB_info *) (mpdu->head);
 		mpdu_skb_info->aggr_timestamp = cur_jiffies;
 		mpdu_skb_info->ampdu_tx_status = AMPDU_ST_SENT;
+		ampdu_hdr->ampdu_tid->sent_map |= SSN_TO_SLOT_BIT(ssn);
 	}
+	if ((ampdu_hdr->ampdu_tid->state == AMPDU_STATE_OPERATION)
+	    && ampdu_hdr->ampdu_tid->sent_map
+	    && !timer_pending(&ampdu_hdr->ampdu_tid->ba_timer))
+		mod_timer(&ampdu_hdr->ampdu_tid->ba_timer,
+			  cur_jiffies + msecs_to_jiffies(BA_WAIT_TIMEOUT));
 	spin_unlock_bh(&ampdu_hdr->ampdu_tid->pkt_array_lock);
 }
@@ -38,9 +38,19 @@
 #define SSV_AMPDU_BA_WINDOW_SIZE (64)
 #define SSV_AMPDU_WINDOW_SIZE (64)
 #define SSV_GET_MAX_AMPDU_SIZE(sh) (((sh)->tx_page_available/(sh)->ampdu_divider) << HW_MMU_PAGE_SHIFT)
+#define SSV_AMPDU_POOL_DEPTH(sh) ((sh)->ampdu_divider * 8)
+#define SSV_AMPDU_AIRTIME_TARGET_US (4000)
+#define SSV_AMPDU_MIN_AGGR_LEN (3200)
+#define SSV_AMPDU_MIN_AGGR_NUM (2)
+#define SSV_AMPDU_BA_EWMA_WEIGHT (75)
+#define SSV_AMPDU_BA_GOOD (90)
+#define SSV_AMPDU_BA_POOR (50)
 #define SSV_AMPDU_FLOW_CONTROL_UPPER_BOUND (64)
 #define SSV_AMPDU_FLOW_CONTROL_LOWER_BOUND (48)
 #define SSV_AMPDU_timer_period (50)
+#define SSV_AMPDU_FLUSH_TIMEOUT (SSV_AMPDU_timer_period / 2)
+#define SSV_AMPDU_TIMER_BA (0)
+#define SSV_AMPDU_TIMER_FLUSH (1)
 #define SSV_AMPDU_TX_TIME_THRESHOLD (50)
 #define SSV_AMPDU_MPDU_LIVE_TIME (SSV_AMPDU_retry_counter_max*8)
 #define SSV_AMPDU_BA_TIME (50)
@@ -84,6 +94,7 @@ typedef enum {
 struct ampdu_hdr_st {
 	u32 first_sn;
 	struct sk_buff_head mpdu_q;
+	struct sk_buff *frag_tail;
 	u32 max_size;
 	u32 size;
 	struct AMPDU_TID_st *ampdu_tid;
@@ -92,6 +103,19 @@ struct ampdu_hdr_st {
 	struct fw_rc_retry_params rates[SSV62XX_TX_MAX_RATES];
 	struct ieee80211_sta *sta;
 };
+/*
+ * Idle A-MPDU containers. At most ampdu_divider full-size aggregates fit
+ * in the TX pages at once; the pool keeps a few times that for the early
+ * queues and frames still waiting in HCI.
+ */
+struct ssv_ampdu_pool {
+	struct sk_buff_head free_q;
+	u32 reserve;
+	u32 alloc_cnt;
+	u32 recycle_cnt;
+	u32 miss_cnt;
+	u32 drop_cnt;
+};
 enum AMPDU_TX_STATUS_E {
 	AMPDU_ST_NON_AMPDU,
 	AMPDU_ST_AGGREGATED,
@@ -112,15 +136,25 @@ typedef struct AMPDU_MIB_st {
 	u32 ampdu_mib_pass_counter;
 	u32 ampdu_mib_dist[SSV_AMPDU_aggr_num_max + 1];
 } AMPDU_MIB;
+struct ssv_softc;
 typedef struct AMPDU_TID_st {
 	struct list_head list;
+	struct ssv_softc *sc;
 	volatile unsigned long timestamp;
+	struct timer_list ba_timer;
+	struct timer_list flush_timer;
+	unsigned long timer_flags;
 	u32 tidno;
 	u16 ac;
 	struct ieee80211_sta *sta;
 	u16 ssv_baw_size;
 	u8 agg_num_max;
 	u8 state;
+	u32 airtime_target_us;
+	u32 ba_success;
+	u32 aggr_num_limit;
+	u32 aggr_len_limit;
+	u32 aggr_rate_idx;
 #ifdef AMPDU_CHECK_SKB_SEQNO
 	u32 last_seqno;
 #endif
@@ -129,6 +163,9 @@ typedef struct AMPDU_TID_st {
 	struct sk_buff_head retry_queue;
 	struct sk_buff_head release_queue;
 	struct sk_buff *aggr_pkts[SSV_AMPDU_BA_WINDOW_SIZE];
+	u64 sent_map;
+	u64 acked_map;
+	u64 retry_map;
 	volatile u32 aggr_pkt_num;
 	volatile u16 ssv_baw_head;
 	spinlock_t pkt_array_lock;
@@ -186,6 +223,11 @@ void ssv6200_ampdu_timer_callback_func(unsigned long data);
 void ssv6200_ampdu_init(struct ieee80211_hw *hw);
 void ssv6200_ampdu_deinit(struct ieee80211_hw *hw);
 void ssv6200_ampdu_release_skb(struct sk_buff *skb, struct ieee80211_hw *hw);
+void ssv6xxx_ampdu_pool_purge(struct ssv_softc *sc);
+#ifdef CONFIG_SSV6XXX_DEBUGFS
+ssize_t ssv6xxx_ampdu_pool_dump(struct ssv_softc *sc, char *buf,
+				ssize_t buf_size);
+#endif
 void ssv6200_ampdu_tx_start(u16 tid, struct ieee80211_sta *sta,
 			    struct ieee80211_hw *hw, u16 * ssn);
 void ssv6200_ampdu_tx_operation(u16 tid, struct ieee80211_sta *sta,
@@ -194,6 +236,7 @@ void ssv6200_ampdu_tx_stop(u16 tid, struct ieee80211_sta *sta,
 			   struct ieee80211_hw *hw);
 bool ssv6200_ampdu_tx_handler(struct ieee80211_hw *hw, struct sk_buff *skb);
 u32 ssv6xxx_ampdu_flush(struct ieee80211_hw *hw);
+void ssv6xxx_ampdu_flush_expired(struct ieee80211_hw *hw);
 void ssv6200_ampdu_timeout_tx(struct ieee80211_hw *hw);
 struct cfg_host_event;
 void ssv6200_ampdu_no_BA_handler(struct ieee80211_hw *hw, struct sk_buff *skb);
@@ -36,6 +36,7 @@
 #ifdef CONFIG_SSV6XXX_DEBUGFS
 #include "ssv6xxx_debugfs.h"
 #endif
+#include <ssv_trace.h>
 struct rssi_res_st rssi_res, *p_rssi_res;
 #define NO_USE_RXQ_LOCK
 #ifndef WLAN_CIPHER_SUITE_SMS4
@@ -54,6 +55,23 @@ static u16 bits_per_symbol[][2] = {
 	{260, 540},
 };
 
+/*
+ * ceil(2^32 / d): for n below 2^21 and d up to 540, (n * recip) >> 32 is
+ * exactly n / d, which covers every frame length the TX path can see.
+ */
+#define SSV_TXTIME_RECIP(_d) ((u32)(0xFFFFFFFFULL / (_d)) + 1)
+#define SSV_TXTIME_DIV(_n,_recip) ((u32)(((u64)(_n) * (_recip)) >> 32))
+static const u32 bits_per_symbol_recip[][2] = {
+	{SSV_TXTIME_RECIP(26), SSV_TXTIME_RECIP(54)},
+	{SSV_TXTIME_RECIP(52), SSV_TXTIME_RECIP(108)},
+	{SSV_TXTIME_RECIP(78), SSV_TXTIME_RECIP(162)},
+	{SSV_TXTIME_RECIP(104), SSV_TXTIME_RECIP(216)},
+	{SSV_TXTIME_RECIP(156), SSV_TXTIME_RECIP(324)},
+	{SSV_TXTIME_RECIP(208), SSV_TXTIME_RECIP(432)},
+	{SSV_TXTIME_RECIP(234), SSV_TXTIME_RECIP(486)},
+	{SSV_TXTIME_RECIP(260), SSV_TXTIME_RECIP(540)},
+};
+
 #ifdef CONFIG_DEBUG_SKB_TIMESTAMP
 extern struct ssv6xxx_hci_ctrl *ssv_dbg_ctrl_hci;
 extern unsigned int cal_duration_of_ampdu(struct sk_buff *ampdu_skb, int stage);
@@ -200,6 +218,71 @@ static const struct ssv6xxx_calib_table vt_tbl[SSV6XXX_IQK_CFG_XTAL_MAX][14] = {
 
 #define FAIL_MAX 100
 #define RETRY_MAX 20
+#define SSV6XXX_CH_CFG_BATCH 8
+static int ssv6xxx_load_ch_cfg(struct ssv_hw *sh, bool ch13_14)
+{
+	struct ssv6xxx_reg_batch regs[SSV6XXX_CH_CFG_BATCH];
+	int chidx, n = 0, ret = 0;
+	for (chidx = 0; chidx < sh->ch_cfg_size; chidx++) {
+		regs[n].addr = sh->p_ch_cfg[chidx].reg_addr;
+		regs[n].value = (ch13_14) ? sh->p_ch_cfg[chidx].ch13_14_value :
+		    sh->p_ch_cfg[chidx].ch1_12_value;
+		if ((++n < SSV6XXX_CH_CFG_BATCH)
+		    && (chidx < (sh->ch_cfg_size - 1)))
+			continue;
+		ret = SMAC_REG_WRITE_BATCH(sh, regs, n);
+		if (ret)
+			break;
+		n = 0;
+	}
+	return ret;
+}
+
+static int ssv6xxx_set_channel_synth(struct ssv_softc *sc, int chidx)
+{
+	struct ssv_hw *sh = sc->sh;
+	static const u32 synth_regs[] = {
+		ADR_SYN_DIV_SDM_XOSC,
+		ADR_SX_LCK_BIN_REGISTERS_I,
+		ADR_SYN_REGISTER_1,
+		ADR_SYN_REGISTER_2,
+		ADR_SX_LCK_BIN_REGISTERS_II,
+		ADR_MANUAL_ENABLE_REGISTER,
+	};
+	struct ssv6xxx_reg_batch regs[ARRAY_SIZE(synth_regs) + 1];
+	u32 xosc;
+	int i, ret;
+	if ((sh->cfg.crystal_type == SSV6XXX_IQK_CFG_XTAL_26M)
+	    || (sh->cfg.crystal_type == SSV6XXX_IQK_CFG_XTAL_24M)) {
+		xosc = 0x00;
+	} else if (sh->cfg.crystal_type == SSV6XXX_IQK_CFG_XTAL_40M) {
+		xosc = 0x01;
+	} else {
+		dev_warn(sc->dev, "Illegal crystal setting in ssv6xxx_set_channel\n");
+		BUG_ON(1);
+		return -EINVAL;
+	}
+	for (i = 0; i < ARRAY_SIZE(synth_regs); i++) {
+		regs[i].addr = synth_regs[i];
+		if ((ret = SMAC_REG_READ(sh, synth_regs[i], &regs[i].value)) != 0)
+			return ret;
+	}
+	regs[0].value &= ~(0x01 << 13);
+	regs[0].value |= (xosc << 13);
+	regs[1].value |= (0x01 << 19);
+	regs[2].value &= ~(0x00ffffff << 0);
+	regs[2].value |= (vt_tbl[sh->cfg.crystal_type][chidx].rf_ctrl_F << 0);
+	regs[3].value &= ~(0x07ff << 0);
+	regs[3].value |= (vt_tbl[sh->cfg.crystal_type][chidx].rf_ctrl_N << 0);
+	regs[4].value &= ~(0x1fff << 0);
+	regs[4].value |=
+	    (vt_tbl[sh->cfg.crystal_type][chidx].rf_precision_default << 0);
+	regs[6].addr = regs[5].addr;
+	regs[5].value &= ~(0x01 << 14);
+	regs[6].value = regs[5].value | (0x01 << 14);
+	return SMAC_REG_WRITE_BATCH(sh, regs, ARRAY_SIZE(regs));
+}
+
 int ssv6xxx_set_channel(struct ssv_softc *sc, int ch)
 {
 	struct ssv_hw *sh = sc->sh;
@@ -213,26 +296,12 @@ int ssv6xxx_set_channel(struct ssv_softc *sc, int ch)
 	    || (sc->sh->cfg.chip_identity == SSV6051P)) {
 		if ((ch == 13) || (ch == 14)) {
 			if (sh->ipd_channel_touch == 0) {
-				for (chidx = 0; chidx < sh->ch_cfg_size;
-				     chidx++) {
-					SMAC_REG_WRITE(sh,
-						       sh->p_ch_cfg[chidx].
-						       reg_addr,
-						       sh->p_ch_cfg[chidx].
-						       ch13_14_value);
-				}
+				ssv6xxx_load_ch_cfg(sh, true);
 				sh->ipd_channel_touch = 1;
 			}
 		} else {
 			if (sh->ipd_channel_touch) {
-				for (chidx = 0; chidx < sh->ch_cfg_size;
-				     chidx++) {
-					SMAC_REG_WRITE(sh,
-						       sh->p_ch_cfg[chidx].
-						       reg_addr,
-						       sh->p_ch_cfg[chidx].
-						       ch1_12_value);
-				}
+				ssv6xxx_load_ch_cfg(sh, false);
 				sh->ipd_channel_touch = 0;
 			}
 		}
@@ -251,51 +320,7 @@ int ssv6xxx_set_channel(struct ssv_softc *sc, int ch)
 	if ((ret = ssv6xxx_rf_disable(sc->sh)) != 0)
 		goto exit;
 	do {
-		if ((sh->cfg.crystal_type == SSV6XXX_IQK_CFG_XTAL_26M)
-		    || (sh->cfg.crystal_type == SSV6XXX_IQK_CFG_XTAL_24M)) {
-			if ((ret =
-			     SMAC_REG_SET_BITS(sc->sh, ADR_SYN_DIV_SDM_XOSC,
-					       (0x00 << 13),
-					       (0x01 << 13))) != 0)
-				break;
-		} else if (sh->cfg.crystal_type == SSV6XXX_IQK_CFG_XTAL_40M) {
-			if ((ret =
-			     SMAC_REG_SET_BITS(sc->sh, ADR_SYN_DIV_SDM_XOSC,
-					       (0x01 << 13),
-					       (0x01 << 13))) != 0)
-				break;
-		} else {
-			dev_warn(sc->dev, "Illegal crystal setting in ssv6xxx_set_channel\n");
-			BUG_ON(1);
-		}
-		if ((ret = SMAC_REG_SET_BITS(sc->sh, ADR_SX_LCK_BIN_REGISTERS_I,
-					     (0x01 << 19), (0x01 << 19))) != 0)
-			break;
-		regval = vt_tbl[sh->cfg.crystal_type][chidx].rf_ctrl_F;
-		if ((ret = SMAC_REG_SET_BITS(sc->sh, ADR_SYN_REGISTER_1,
-					     (regval << 0),
-					     (0x00ffffff << 0))) != 0)
-			break;
-		regval = vt_tbl[sh->cfg.crystal_type][chidx].rf_ctrl_N;
-		if ((ret = SMAC_REG_SET_BITS(sc->sh, ADR_SYN_REGISTER_2,
-					     (regval << 0),
-					     (0x07ff << 0))) != 0)
-			break;
-		if ((ret =
-		     SMAC_REG_READ(sc->sh, ADR_SX_LCK_BIN_REGISTERS_I,
-				   &regval)) != 0)
-			break;
-		regval =
-		    vt_tbl[sh->cfg.crystal_type][chidx].rf_precision_default;
-		if ((ret =
-		     SMAC_REG_SET_BITS(sc->sh, ADR_SX_LCK_BIN_REGISTERS_II,
-				       (regval << 0), (0x1fff << 0))) != 0)
-			break;
-		if ((ret = SMAC_REG_SET_BITS(sc->sh, ADR_MANUAL_ENABLE_REGISTER,
-					     (0x00 << 14), (0x01 << 14))) != 0)
-			break;
-		if ((ret = SMAC_REG_SET_BITS(sc->sh, ADR_MANUAL_ENABLE_REGISTER,
-					     (0x01 << 14), (0x01 << 14))) != 0)
+		if ((ret = ssv6xxx_set_channel_synth(sc, chidx)) != 0)
 			break;
 		retry_cnt = 0;
 		do {
@@ -448,7 +473,8 @@ static u32 ssv6xxx_ht_txtime(u8 rix, int pktlen, int width,
 	streams = 1;
 	nbits = (pktlen << 3) + OFDM_PLCP_BITS;
 	nsymbits = bits_per_symbol[rix % 8][width] * streams;
-	nsymbols = (nbits + nsymbits - 1) / nsymbits;
+	nsymbols = SSV_TXTIME_DIV(nbits + nsymbits - 1,
+				  bits_per_symbol_recip[rix % 8][width]);
 	if (!half_gi)
 		duration = SYMBOL_TIME(nsymbols);
 	else {
@@ -467,8 +493,8 @@ static u32 ssv6xxx_ht_txtime(u8 rix, int pktlen, int width,
 	return duration;
 }
 
-static u32 ssv6xxx_non_ht_txtime(u8 phy, int kbps,
-				 u32 frameLen, bool shortPreamble)
+static u32 ssv6xxx_non_ht_txtime_calc(u8 phy, int kbps,
+				      u32 frameLen, bool shortPreamble)
 {
 	u32 bits_per_symbol, num_bits, num_symbols;
 	u32 phy_time, tx_time;
@@ -498,6 +524,58 @@ static u32 ssv6xxx_non_ht_txtime(u8 phy, int kbps,
 	return tx_time;
 }
 
+void ssv6xxx_rate_txtime_init(struct ssv_rate_txtime *txtime,
+			      const struct ssv_rc_rate *rc_table, int n_rates)
+{
+	static const u16 ctrl_len[SSV_CTRL_NUM] = {
+		[SSV_CTRL_ACK] = ACK_LEN,
+		[SSV_CTRL_BA] = BA_LEN,
+		[SSV_CTRL_CTS] = CTS_LEN,
+		[SSV_CTRL_RTS] = RTS_LEN,
+	};
+	const struct ssv_rc_rate *rate;
+	int i, sp, f;
+	memset(txtime, 0, sizeof(*txtime) * n_rates);
+	for (i = 0; i < n_rates; i++) {
+		rate = &rc_table[i];
+		txtime[i].phy_type = rate->phy_type;
+		if (rate->phy_type == WLAN_RC_PHY_CCK)
+			txtime[i].divisor = rate->rate_kbps / 500;
+		else if (rate->phy_type == WLAN_RC_PHY_OFDM)
+			txtime[i].divisor =
+			    (rate->rate_kbps * OFDM_SYMBOL_TIME) / 1000;
+		else
+			continue;
+		txtime[i].recip = SSV_TXTIME_RECIP(txtime[i].divisor);
+		for (sp = 0; sp < 2; sp++) {
+			txtime[i].data_us[sp] =
+			    ssv6xxx_non_ht_txtime_calc(rate->phy_type,
+						       rate->rate_kbps, 0, sp);
+			if (rate->phy_type == WLAN_RC_PHY_OFDM)
+				txtime[i].data_us[sp] -= OFDM_SYMBOL_TIME;
+			for (f = 0; f < SSV_CTRL_NUM; f++)
+				txtime[i].ctrl_us[sp][f] =
+				    ssv6xxx_non_ht_txtime_calc(rate->phy_type,
+							       rate->rate_kbps,
+							       ctrl_len[f], sp);
+		}
+	}
+}
+
+static u32 ssv6xxx_non_ht_txtime(const struct ssv_rate_txtime *txtime,
+				 u32 frameLen, bool shortPreamble)
+{
+	u32 num_bits = frameLen << 3;
+	if (txtime->divisor == 0)
+		return 0;
+	if (txtime->phy_type == WLAN_RC_PHY_CCK)
+		return txtime->data_us[shortPreamble]
+		    + SSV_TXTIME_DIV(num_bits << 1, txtime->recip);
+	num_bits += OFDM_PLCP_BITS + txtime->divisor - 1;
+	return txtime->data_us[shortPreamble]
+	    + SSV_TXTIME_DIV(num_bits, txtime->recip) * OFDM_SYMBOL_TIME;
+}
+
 static u32 ssv6xxx_set_frame_duration(struct ieee80211_tx_info *info,
 				      struct ssv_rate_info *ssv_rate, u16 len,
 				      struct ssv6200_tx_desc *tx_desc,
@@ -507,11 +585,12 @@ static u32 ssv6xxx_set_frame_duration(struct ieee80211_tx_info *info,
 	struct ieee80211_tx_rate *tx_drate;
 	u32 frame_time = 0, ack_time = 0, rts_cts_nav = 0, frame_consume_time =
 	    0;
-	u32 l_length = 0, drate_kbps = 0, crate_kbps = 0;
+	u32 l_length = 0;
 	bool ctrl_short_preamble = false, is_sgi, is_ht40;
 	bool is_ht, is_gf;
-	int d_phy, c_phy, nRCParams, mcsidx;
-	struct ssv_rate_ctrl *ssv_rc = NULL;
+	int nRCParams, mcsidx;
+	struct ssv_rate_ctrl *ssv_rc = sc->rc;
+	const struct ssv_rate_txtime *d_txtime, *c_txtime;
 	tx_drate = &info->control.rates[0];
 	is_sgi = !!(tx_drate->flags & IEEE80211_TX_RC_SHORT_GI);
 	is_ht40 = !!(tx_drate->flags & IEEE80211_TX_RC_40_MHZ_WIDTH);
@@ -522,79 +601,53 @@ static u32 ssv6xxx_set_frame_duration(struct ieee80211_tx_info *info,
 		ctrl_short_preamble = true;
 	pr_debug("mcs = %d, data rate idx=%d\n", tx_drate->idx, tx_drate[3].count);
 	for (nRCParams = 0; (nRCParams < SSV62XX_TX_MAX_RATES); nRCParams++) {
-		if ((rc_params == NULL) || (sc == NULL)) {
+		if (rc_params == NULL) {
 			mcsidx = tx_drate->idx;
-			drate_kbps = ssv_rate->drate_kbps;
-			crate_kbps = ssv_rate->crate_kbps;
+			d_txtime = &ssv_rc->txtime[ssv_rate->drate_hw_idx];
+			c_txtime = &ssv_rc->txtime[ssv_rate->crate_hw_idx];
 		} else {
 			if (rc_params[nRCParams].count == 0) {
 				break;
 			}
-			ssv_rc = sc->rc;
 			mcsidx =
 			    (rc_params[nRCParams].drate -
 			     SSV62XX_RATE_MCS_INDEX) % MCS_GROUP_RATES;
-			drate_kbps =
-			    ssv_rc->rc_table[rc_params[nRCParams].drate].
-			    rate_kbps;
-			crate_kbps =
-			    ssv_rc->rc_table[rc_params[nRCParams].crate].
-			    rate_kbps;
+			d_txtime = &ssv_rc->txtime[rc_params[nRCParams].drate];
+			c_txtime = &ssv_rc->txtime[rc_params[nRCParams].crate];
 		}
 		if (tx_drate->flags & IEEE80211_TX_RC_MCS) {
 			frame_time = ssv6xxx_ht_txtime(mcsidx,
 						       len, is_ht40, is_sgi,
 						       is_gf);
-			d_phy = 0;
 		} else {
-			if ((info->band == INDEX_80211_BAND_2GHZ) &&
-			    !(ssv_rate->d_flags & IEEE80211_RATE_ERP_G))
-				d_phy = WLAN_RC_PHY_CCK;
-			else
-				d_phy = WLAN_RC_PHY_OFDM;
-			frame_time = ssv6xxx_non_ht_txtime(d_phy, drate_kbps,
-							   len,
+			frame_time = ssv6xxx_non_ht_txtime(d_txtime, len,
 							   ctrl_short_preamble);
 		}
-		if ((info->band == INDEX_80211_BAND_2GHZ) &&
-		    !(ssv_rate->c_flags & IEEE80211_RATE_ERP_G))
-			c_phy = WLAN_RC_PHY_CCK;
-		else
-			c_phy = WLAN_RC_PHY_OFDM;
 		if (tx_desc->unicast) {
-			if (info->flags & IEEE80211_TX_CTL_AMPDU) {
-				ack_time = ssv6xxx_non_ht_txtime(c_phy,
-								 crate_kbps,
-								 BA_LEN,
-								 ctrl_short_preamble);
-			} else {
-				ack_time = ssv6xxx_non_ht_txtime(c_phy,
-								 crate_kbps,
-								 ACK_LEN,
-								 ctrl_short_preamble);
-			}
+			if (info->flags & IEEE80211_TX_CTL_AMPDU)
+				ack_time =
+				    c_txtime->ctrl_us[ctrl_short_preamble]
+				    [SSV_CTRL_BA];
+			else
+				ack_time =
+				    c_txtime->ctrl_us[ctrl_short_preamble]
+				    [SSV_CTRL_ACK];
 		}
 		if (tx_desc->do_rts_cts & IEEE80211_TX_RC_USE_RTS_CTS) {
 			rts_cts_nav = frame_time;
 			rts_cts_nav += ack_time;
-			rts_cts_nav += ssv6xxx_non_ht_txtime(c_phy,
-							     crate_kbps,
-							     CTS_LEN,
-							     ctrl_short_preamble);
+			rts_cts_nav +=
+			    c_txtime->ctrl_us[ctrl_short_preamble][SSV_CTRL_CTS];
 			frame_consume_time = rts_cts_nav;
-			frame_consume_time += ssv6xxx_non_ht_txtime(c_phy,
-								    crate_kbps,
-								    RTS_LEN,
-								    ctrl_short_preamble);
+			frame_consume_time +=
+			    c_txtime->ctrl_us[ctrl_short_preamble][SSV_CTRL_RTS];
 		} else if (tx_desc->
 			   do_rts_cts & IEEE80211_TX_RC_USE_CTS_PROTECT) {
 			rts_cts_nav = frame_time;
 			rts_cts_nav += ack_time;
 			frame_consume_time = rts_cts_nav;
-			frame_consume_time += ssv6xxx_non_ht_txtime(c_phy,
-								    crate_kbps,
-								    CTS_LEN,
-								    ctrl_short_preamble);
+			frame_consume_time +=
+			    c_txtime->ctrl_us[ctrl_short_preamble][SSV_CTRL_CTS];
 		} else {;
 		}
 		if (tx_drate->flags & IEEE80211_TX_RC_MCS) {
@@ -602,7 +655,7 @@ static u32 ssv6xxx_set_frame_duration(struct ieee80211_tx_info *info,
 			l_length = ((l_length - (HT_SIGNAL_EXT + 20)) + 3) >> 2;
 			l_length += ((l_length << 1) - 3);
 		}
-		if ((rc_params == NULL) || (sc == NULL)) {
+		if (rc_params == NULL) {
 			tx_desc->rts_cts_nav = rts_cts_nav;
 			tx_desc->frame_consume_time =
 			    (frame_consume_time >> 5) + 1;;
@@ -1538,6 +1591,7 @@ static int ssv6200_set_key(struct ieee80211_hw *hw,
 			vif_priv->force_sw_encrypt = true;
 		ret = -EOPNOTSUPP;
 	}
+	ssv6xxx_tx_tpl_invalidate(sc);
 	dev_dbg(sc->dev, "SET KEY %d\n", ret);
 	return ret;
 }
@@ -1555,6 +1609,7 @@ u32 _process_tx_done(struct ssv_softc *sc)
 			dev_dbg(sc->dev, "free cmd skb!\n");
 			continue;
 		}
+		trace_ssv6xxx_tx_done(skb, tx_desc->txq_idx);
 		if (tx_info->flags & IEEE80211_TX_CTL_AMPDU) {
 			ssv6200_ampdu_release_skb(skb, sc->hw);
 			continue;
@@ -1617,7 +1672,7 @@ void ssv6xxx_tx_rate_update(struct sk_buff *skb, void *args)
 		hdr = (struct ieee80211_hdr *)(skb->data + SSV6XXX_TX_DESC_LEN);
 		if ((ieee80211_is_data_qos(hdr->frame_control)
 		     || ieee80211_is_data(hdr->frame_control))
-		    && (tx_desc->wsid < SSV_RC_MAX_HARDWARE_SUPPORT)) {
+		    && (tx_desc->wsid < SSV_NUM_STA)) {
 			ret =
 			    ssv6xxx_rc_hw_rate_update_check(skb, sc,
 							    tx_desc->
@@ -1637,7 +1692,7 @@ void ssv6xxx_tx_rate_update(struct sk_buff *skb, void *args)
 				    ssv6xxx_set_frame_duration(info, &ssv_rate,
 							       skb->len +
 							       FCS_LEN, tx_desc,
-							       NULL, NULL);
+							       NULL, sc);
 				if (tx_desc->tx_burst == 0) {
 					if (tx_desc->ack_policy != 0x01)
 						hdr->duration_id = nav;
@@ -1649,12 +1704,87 @@ void ssv6xxx_tx_rate_update(struct sk_buff *skb, void *args)
 	return;
 }
 
+void ssv6xxx_tx_tpl_invalidate(struct ssv_softc *sc)
+{
+	smp_wmb();
+	atomic_inc(&sc->tx_tpl_gen);
+}
+
+/*
+ * A template covers only what is fixed per station (or vif), HW queue
+ * and protection: the fCmd engine chain, wsid and txq_idx. Security is
+ * handled by M_ENG_ENCRYPT in that chain, and the aggregation, HT and
+ * rate fields follow each frame's tx_info and rate-control state, so
+ * they are still filled in per frame by ssv6xxx_update_txinfo().
+ */
+static u64 ssv6xxx_tx_tpl_build(struct ssv_vif_priv_data *vif_priv,
+				struct ssv_sta_priv_data *sta_priv,
+				int hw_txqid, bool unicast, bool protect,
+				bool ampdu)
+{
+	struct ssv_sta_info *sta_info = sta_priv ? sta_priv->sta_info : NULL;
+	u64 wsid = (!sta_info || (sta_info->hw_wsid < 0)) ?
+	    0x0F : sta_info->hw_wsid;
+	u32 fcmd = (hw_txqid + M_ENG_TX_EDCA0);
+#ifdef AMPDU_HAS_LEADING_FRAME
+	if (ampdu)
+		fcmd = (fcmd << 4) | M_ENG_CPU;
+#endif
+	if (protect && ((unicast && sta_priv && sta_priv->has_hw_encrypt)
+			|| (!unicast && vif_priv->has_hw_encrypt))) {
+		if (!unicast && !list_empty(&vif_priv->sta_list)) {
+			struct ssv_sta_priv_data *one_sta_priv;
+			one_sta_priv = list_first_entry(&vif_priv->sta_list,
+							struct
+							ssv_sta_priv_data,
+							list);
+			if (one_sta_priv->sta_info->hw_wsid != (-1))
+				wsid = one_sta_priv->sta_info->hw_wsid;
+		}
+		fcmd = (fcmd << 4) | M_ENG_ENCRYPT;
+	}
+	fcmd = (fcmd << 4) | M_ENG_HWHCI;
+	return fcmd | ((wsid & 0x0F) << SSV_TX_TPL_WSID_SHIFT) |
+	    ((u64)hw_txqid << SSV_TX_TPL_TXQ_SHIFT);
+}
+
+static u64 ssv6xxx_tx_tpl_get(struct ssv_softc *sc,
+			      struct ssv_vif_priv_data *vif_priv,
+			      struct ssv_sta_priv_data *sta_priv,
+			      int hw_txqid, bool unicast, bool protect,
+			      bool ampdu)
+{
+	atomic64_t *slot;
+	u64 tpl, gen;
+#ifdef AMPDU_HAS_LEADING_FRAME
+	if (ampdu)
+		return ssv6xxx_tx_tpl_build(vif_priv, sta_priv, hw_txqid,
+					    unicast, protect, true);
+#endif
+	if (unicast && sta_priv)
+		slot = &sta_priv->tx_tpl[hw_txqid][protect];
+	else if (!unicast && !sta_priv)
+		slot = &vif_priv->tx_tpl[hw_txqid][protect];
+	else
+		return ssv6xxx_tx_tpl_build(vif_priv, sta_priv, hw_txqid,
+					    unicast, protect, ampdu);
+	gen = ((u64)atomic_read(&sc->tx_tpl_gen) << SSV_TX_TPL_GEN_SHIFT) |
+	    SSV_TX_TPL_VALID;
+	smp_rmb();
+	tpl = atomic64_read(slot);
+	if ((tpl & (SSV_TX_TPL_GEN_MASK | SSV_TX_TPL_VALID)) == gen)
+		return tpl;
+	tpl = ssv6xxx_tx_tpl_build(vif_priv, sta_priv, hw_txqid, unicast,
+				   protect, ampdu) | gen;
+	atomic64_set(slot, tpl);
+	return tpl;
+}
+
 void ssv6xxx_update_txinfo(struct ssv_softc *sc, struct sk_buff *skb)
 {
 	struct ieee80211_hdr *hdr;
 	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
 	struct ieee80211_sta *sta;
-	struct ssv_sta_info *sta_info = NULL;
 	struct ssv_sta_priv_data *ssv_sta_priv = NULL;
 	struct ssv_vif_priv_data *vif_priv =
 	    (struct ssv_vif_priv_data *)info->control.vif->drv_priv;
@@ -1663,22 +1793,21 @@ void ssv6xxx_update_txinfo(struct ssv_softc *sc, struct sk_buff *skb)
 	struct ssv_rate_info ssv_rate;
 	int ac, hw_txqid;
 	u32 nav = 0;
+	u64 tpl;
 	if (info->flags & IEEE80211_TX_CTL_AMPDU) {
 		struct ampdu_hdr_st *ampdu_hdr =
 		    (struct ampdu_hdr_st *)skb->head;
 		sta = ampdu_hdr->ampdu_tid->sta;
 		hdr =
-		    (struct ieee80211_hdr *)(skb->data + TXPB_OFFSET +
+		    (struct ieee80211_hdr *)(skb_shinfo(skb)->frag_list->data +
 					     AMPDU_DELIMITER_LEN);
 	} else {
 		struct SKB_info_st *skb_info = (struct SKB_info_st *)skb->head;
 		sta = skb_info->sta;
 		hdr = (struct ieee80211_hdr *)(skb->data + TXPB_OFFSET);
 	}
-	if (sta) {
+	if (sta)
 		ssv_sta_priv = (struct ssv_sta_priv_data *)sta->drv_priv;
-		sta_info = ssv_sta_priv->sta_info;
-	}
 	if ((!sc->bq4_dtim) &&
 	    (ieee80211_is_mgmt(hdr->frame_control) ||
 	     ieee80211_is_nullfunc(hdr->frame_control) ||
@@ -1711,9 +1840,13 @@ void ssv6xxx_update_txinfo(struct ssv_softc *sc, struct sk_buff *skb)
 	tx_desc->frag = (tx_desc->more_data || (hdr->seq_ctrl & 0xf)) ? 1 : 0;
 	tx_desc->unicast = (is_multicast_ether_addr(hdr->addr1)) ? 0 : 1;
 	tx_desc->tx_burst = (tx_desc->frag) ? 1 : 0;
-	tx_desc->wsid = (!sta_info
-			 || (sta_info->hw_wsid < 0)) ? 0x0F : sta_info->hw_wsid;
-	tx_desc->txq_idx = hw_txqid;
+	tpl = ssv6xxx_tx_tpl_get(sc, vif_priv, ssv_sta_priv, hw_txqid,
+				 tx_desc->unicast,
+				 ieee80211_has_protected(hdr->frame_control)
+				 && ieee80211_is_data(hdr->frame_control),
+				 !!(info->flags & IEEE80211_TX_CTL_AMPDU));
+	tx_desc->wsid = (tpl >> SSV_TX_TPL_WSID_SHIFT) & 0x0F;
+	tx_desc->txq_idx = (tpl >> SSV_TX_TPL_TXQ_SHIFT) & 0x07;
 	tx_desc->hdr_offset = TXPB_OFFSET;
 	tx_desc->hdr_len = ssv6xxx_frame_hdrlen(hdr, tx_desc->ht);
 	tx_desc->payload_offset = tx_desc->hdr_offset + tx_desc->hdr_len;
@@ -1736,11 +1869,9 @@ void ssv6xxx_update_txinfo(struct ssv_softc *sc, struct sk_buff *skb)
 		tx_desc->ack_policy = 1;
 	tx_desc->security = 0;
 	tx_desc->fCmdIdx = 0;
-	tx_desc->fCmd = (hw_txqid + M_ENG_TX_EDCA0);
+	tx_desc->fCmd = (u32)tpl;
 	if (info->flags & IEEE80211_TX_CTL_AMPDU) {
-#ifdef AMPDU_HAS_LEADING_FRAME
-		tx_desc->fCmd = (tx_desc->fCmd << 4) | M_ENG_CPU;
-#else
+#ifndef AMPDU_HAS_LEADING_FRAME
 		tx_desc->RSVD_1 = 1;
 #endif
 		tx_desc->aggregation = 1;
@@ -1753,33 +1884,6 @@ void ssv6xxx_update_txinfo(struct ssv_softc *sc, struct sk_buff *skb)
 			tx_desc->do_rts_cts = 1;
 		}
 	}
-	if (ieee80211_has_protected(hdr->frame_control)
-	    && (ieee80211_is_data_qos(hdr->frame_control)
-		|| ieee80211_is_data(hdr->frame_control))) {
-		if ((tx_desc->unicast && ssv_sta_priv
-		     && ssv_sta_priv->has_hw_encrypt)
-		    || (!tx_desc->unicast && vif_priv
-			&& vif_priv->has_hw_encrypt)) {
-			if (!tx_desc->unicast
-			    && !list_empty(&vif_priv->sta_list)) {
-				struct ssv_sta_priv_data *one_sta_priv;
-				int hw_wsid;
-				one_sta_priv =
-				    list_first_entry(&vif_priv->sta_list,
-						     struct ssv_sta_priv_data,
-						     list);
-				hw_wsid = one_sta_priv->sta_info->hw_wsid;
-				if (hw_wsid != (-1)) {
-					tx_desc->wsid = hw_wsid;
-				}
-			}
-			tx_desc->fCmd = (tx_desc->fCmd << 4) | M_ENG_ENCRYPT;
-		} else if (ssv_sta_priv->need_sw_encrypt) {
-		} else {
-		}
-	} else {
-	}
-	tx_desc->fCmd = (tx_desc->fCmd << 4) | M_ENG_HWHCI;
 	if (tx_desc->aggregation == 1) {
 		struct ampdu_hdr_st *ampdu_hdr =
 		    (struct ampdu_hdr_st *)skb->head;
@@ -1821,7 +1925,7 @@ void ssv6xxx_update_txinfo(struct ssv_softc *sc, struct sk_buff *skb)
 		nav =
 		    ssv6xxx_set_frame_duration(info, &ssv_rate,
 					       (skb->len + FCS_LEN), tx_desc,
-					       NULL, NULL);
+					       NULL, sc);
 	}
 	if ((tx_desc->aggregation == 0)) {
 		if (tx_desc->tx_burst == 0) {
@@ -1851,6 +1955,48 @@ int ssv6xxx_get_real_index(struct ssv_softc *sc, struct sk_buff *skb)
 	return ssv_rate.drate_hw_idx;
 }
 
+#ifdef SSV_TXQ_SCHED
+/*
+ * Charge the airtime scheduler for a unicast data frame sent as a single
+ * MPDU. Aggregated frames are charged by ssv6200_ampdu_tx_handler().
+ */
+static void ssv6xxx_tx_register_airtime(struct ssv_softc *sc,
+					struct sk_buff *skb)
+{
+	struct SKB_info_st *skb_info = (struct SKB_info_st *)skb->head;
+	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+	struct ieee80211_tx_rate *tx_drate = &info->control.rates[0];
+	struct ssv6200_tx_desc *tx_desc = (struct ssv6200_tx_desc *)skb->data;
+	struct ieee80211_hdr *hdr;
+	u32 len, airtime;
+	u8 tid = 0;
+	if ((skb_info->sta == NULL) || !tx_desc->unicast)
+		return;
+	hdr = (struct ieee80211_hdr *)(skb->data + sc->sh->tx_desc_len);
+	if (!ieee80211_is_data(hdr->frame_control))
+		return;
+	if (ieee80211_is_data_qos(hdr->frame_control))
+		tid = *ieee80211_get_qos_ctl(hdr) & IEEE80211_QOS_CTL_TID_MASK;
+	len = skb->len - sc->sh->tx_desc_len + FCS_LEN;
+	if (tx_drate->flags & IEEE80211_TX_RC_MCS)
+		airtime = ssv6xxx_ht_txtime(tx_drate->idx, len,
+					    !!(tx_drate->flags &
+					       IEEE80211_TX_RC_40_MHZ_WIDTH),
+					    !!(tx_drate->flags &
+					       IEEE80211_TX_RC_SHORT_GI),
+					    !!(tx_drate->flags &
+					       IEEE80211_TX_RC_GREEN_FIELD));
+	else
+		airtime = ssv6xxx_non_ht_txtime(&sc->rc->txtime[tx_desc->
+								 drate_idx],
+						len,
+						info->control.short_preamble
+						|| (tx_drate->flags &
+						    IEEE80211_TX_RC_USE_SHORT_PREAMBLE));
+	ieee80211_sta_register_airtime(skb_info->sta, tid, airtime, 0);
+}
+#endif
+
 static void _ssv6xxx_tx(struct ieee80211_hw *hw, struct sk_buff *skb)
 {
 	struct ssv_softc *sc = hw->priv;
@@ -1861,6 +2007,7 @@ static void _ssv6xxx_tx(struct ieee80211_hw *hw, struct sk_buff *skb)
 	int ret;
 	unsigned long flags;
 	bool send_hci = false;
+	trace_ssv6xxx_tx_frame(skb, skb_get_queue_mapping(skb));
 	do {
 		if (info->flags & IEEE80211_TX_CTL_ASSIGN_SEQ) {
 			if (info->flags & IEEE80211_TX_CTL_FIRST_FRAGMENT)
@@ -1882,6 +2029,9 @@ static void _ssv6xxx_tx(struct ieee80211_hw *hw, struct sk_buff *skb)
 		}
  tx_mpdu:
 		ssv6xxx_add_txinfo(sc, skb);
+#ifdef SSV_TXQ_SCHED
+		ssv6xxx_tx_register_airtime(sc, skb);
+#endif
 		if (vif &&
 		    vif->type == NL80211_IFTYPE_AP &&
 		    (sc->bq4_dtim) &&
@@ -1934,6 +2084,7 @@ static void ssv6200_tx(struct ieee80211_hw *hw,
 	struct ssv_softc *sc = (struct ssv_softc *)hw->priv;
 	struct SKB_info_st *skb_info = (struct SKB_info_st *)skb->head;
 	skb_info->sta = control ? control->sta : NULL;
+	trace_ssv6xxx_tx_mac80211(skb, skb_get_queue_mapping(skb));
 #ifdef CONFIG_DEBUG_SKB_TIMESTAMP
 	skb_info->timestamp = ktime_get();
 #endif
@@ -1949,25 +2100,76 @@ static void ssv6200_tx(struct ieee80211_hw *hw,
 	} while (0);
 }
 
+#ifdef SSV_TXQ_SCHED
+static void ssv6200_wake_tx_queue(struct ieee80211_hw *hw,
+				  struct ieee80211_txq *txq)
+{
+	struct ssv_softc *sc = (struct ssv_softc *)hw->priv;
+	WRITE_ONCE(sc->tx.txq_scheduled, true);
+	wake_up_interruptible(&sc->tx_wait_q);
+}
+
+/*
+ * Serve the mac80211 TX queues from the TX task, highest AC first. Each
+ * round visits every backlogged station/TID once, in mac80211's
+ * airtime-fair order, and takes at most SSV_TXQ_BURST frames from it.
+ * An AC whose HW queue is flow controlled is skipped until it drains.
+ */
+static void ssv6xxx_tx_schedule(struct ssv_softc *sc)
+{
+	struct ieee80211_hw *hw = sc->hw;
+	int ac;
+	WRITE_ONCE(sc->tx.txq_scheduled, false);
+	for (ac = 0; ac < IEEE80211_NUM_ACS; ac++) {
+		struct ieee80211_txq *txq;
+		if (sc->tx.flow_ctrl_status & BIT(ac))
+			continue;
+		ieee80211_txq_schedule_start(hw, ac);
+		while ((txq = ieee80211_next_txq(hw, ac)) != NULL) {
+			int burst = 0;
+			while ((burst < SSV_TXQ_BURST)
+			       && !(sc->tx.flow_ctrl_status & BIT(ac))) {
+				struct sk_buff *skb;
+				struct SKB_info_st *skb_info;
+				local_bh_disable();
+				skb = ieee80211_tx_dequeue(hw, txq);
+				local_bh_enable();
+				if (skb == NULL)
+					break;
+				skb_info = (struct SKB_info_st *)skb->head;
+				skb_info->sta = txq->sta;
+				trace_ssv6xxx_tx_mac80211(skb,
+							  skb_get_queue_mapping
+							  (skb));
+#ifdef CONFIG_DEBUG_SKB_TIMESTAMP
+				skb_info->timestamp = ktime_get();
+#endif
+				_ssv6xxx_tx(hw, skb);
+				burst++;
+			}
+			ieee80211_return_txq(hw, txq, false);
+			if (sc->tx.flow_ctrl_status & BIT(ac))
+				break;
+		}
+		ieee80211_txq_schedule_end(hw, ac);
+	}
+}
+#endif
+
 int ssv6xxx_tx_task(void *data)
 {
 	struct ssv_softc *sc = (struct ssv_softc *)data;
-	u32 wait_period = SSV_AMPDU_timer_period / 2;
 	dev_info(sc->dev, "TX Task started\n");
 	while (!kthread_should_stop()) {
-		u32 before_timeout = (-1);
 		set_current_state(TASK_INTERRUPTIBLE);
-		before_timeout = wait_event_interruptible_timeout(sc->tx_wait_q,
-								  (skb_queue_len
-								   (&sc->
-								    tx_skb_q)
-								   ||
-								   kthread_should_stop
-								   ()
-								   || sc->
-								   tx_q_empty),
-								  msecs_to_jiffies
-								  (wait_period));
+		wait_event_interruptible(sc->tx_wait_q,
+					 (skb_queue_len(&sc->tx_skb_q)
+					  || kthread_should_stop()
+					  || sc->tx_q_empty
+					  || READ_ONCE(sc->tx.txq_scheduled)
+					  || test_bit(SSV_AMPDU_TIMER_FLUSH,
+						      &sc->tx.
+						      ampdu_timer_flags)));
 		if (kthread_should_stop()) {
 			dev_dbg(sc->dev, "Quit TX task loop...\n");
 			break;
@@ -1979,6 +2181,10 @@ int ssv6xxx_tx_task(void *data)
 				break;
 			_ssv6xxx_tx(sc->hw, tx_skb);
 		} while (1);
+#ifdef SSV_TXQ_SCHED
+		if (READ_ONCE(sc->tx.txq_scheduled))
+			ssv6xxx_tx_schedule(sc);
+#endif
 #ifdef CONFIG_DEBUG_SKB_TIMESTAMP
 		{
 			struct ssv_hw_txq *hw_txq = NULL;
@@ -2016,16 +2222,13 @@ int ssv6xxx_tx_task(void *data)
 			}
 		}
 #endif
-		if (sc->tx_q_empty || (before_timeout == 0)) {
-			u32 flused_ampdu = ssv6xxx_ampdu_flush(sc->hw);
+		if (test_and_clear_bit(SSV_AMPDU_TIMER_FLUSH,
+				       &sc->tx.ampdu_timer_flags))
+			ssv6xxx_ampdu_flush_expired(sc->hw);
+		if (sc->tx_q_empty) {
+			ssv6xxx_ampdu_flush(sc->hw);
 			sc->tx_q_empty = false;
-			if (flused_ampdu == 0 && before_timeout == 0) {
-				wait_period *= 2;
-				if (wait_period > 1000)
-					wait_period = 1000;
-			}
-		} else
-			wait_period = SSV_AMPDU_timer_period / 2;
+		}
 	}
 	return 0;
 }
@@ -2033,37 +2236,24 @@ int ssv6xxx_tx_task(void *data)
 int ssv6xxx_rx_task(void *data)
 {
 	struct ssv_softc *sc = (struct ssv_softc *)data;
-	unsigned long wait_period = msecs_to_jiffies(200);
-	unsigned long last_timeout_check_jiffies = jiffies;
-	unsigned long cur_jiffies;
 	dev_info(sc->dev, "RX Task started\n");
 	while (!kthread_should_stop()) {
-		u32 before_timeout = (-1);
 		set_current_state(TASK_INTERRUPTIBLE);
-		before_timeout = wait_event_interruptible_timeout(sc->rx_wait_q,
-								  (skb_queue_len
-								   (&sc->
-								    rx_skb_q)
-								   ||
-								   skb_queue_len
-								   (&sc->
-								    tx_done_q)
-								   ||
-								   kthread_should_stop
-								   ()),
-								  wait_period);
+		wait_event_interruptible(sc->rx_wait_q,
+					 (skb_queue_len(&sc->rx_skb_q)
+					  || skb_queue_len(&sc->tx_done_q)
+					  || kthread_should_stop()
+					  || test_bit(SSV_AMPDU_TIMER_BA,
+						      &sc->tx.
+						      ampdu_timer_flags)));
 		if (kthread_should_stop()) {
 			dev_dbg(sc->dev, "Quit RX task loop...\n");
 			break;
 		}
 		set_current_state(TASK_RUNNING);
-		cur_jiffies = jiffies;
-		if ((before_timeout == 0)
-		    || time_before((last_timeout_check_jiffies + wait_period),
-				   cur_jiffies)) {
+		if (test_and_clear_bit(SSV_AMPDU_TIMER_BA,
+				       &sc->tx.ampdu_timer_flags))
 			ssv6xxx_ampdu_check_timeout(sc->hw);
-			last_timeout_check_jiffies = cur_jiffies;
-		}
 		if (skb_queue_len(&sc->rx_skb_q))
 			_process_rx_q(sc, &sc->rx_skb_q, NULL);
 		if (skb_queue_len(&sc->tx_done_q))
@@ -2645,6 +2835,7 @@ static void ssv6200_bss_info_changed(struct ieee80211_hw *hw,
 			}
 		}
 	}
+	ssv6xxx_tx_tpl_invalidate(sc);
 	mutex_unlock(&sc->mutex);
 	dev_dbg(sc->dev, "[I] %s(): leave\n", __FUNCTION__);
 }
@@ -2767,6 +2958,8 @@ static int ssv6200_sta_add(struct ieee80211_hw *hw,
 			sta_info->hw_wsid = sta_priv_dat->sta_idx;
 		} else if ((vif_priv->vif_idx == 0)
 			   || sc->sh->cfg.use_wpa2_only) {
+			ssv6xxx_rc_hw_reset(sc, sta_priv_dat->rc_idx,
+					    sta_priv_dat->sta_idx);
 			sta_info->hw_wsid = sta_priv_dat->sta_idx;
 		}
 		if ((sta_priv_dat->has_hw_encrypt
@@ -2809,6 +3002,7 @@ static int ssv6200_sta_add(struct ieee80211_hw *hw,
 		     sta->addr[4], sta->addr[5], vif_priv->vif_idx,
 		     sta_priv_dat->sta_idx, sta_info->hw_wsid);
 	} while (0);
+	ssv6xxx_tx_tpl_invalidate(sc);
 	return ret;
 }
 
@@ -2883,6 +3077,7 @@ static int ssv6200_sta_remove(struct ieee80211_hw *hw,
 		priv_vif->group_cipher = 0;
 	}
 	spin_unlock_irqrestore(&sc->ps_state_lock, flags);
+	ssv6xxx_tx_tpl_invalidate(sc);
 	if ((hw_wsid != -1) && (hw_wsid < SSV_NUM_HW_STA))
 		SMAC_REG_WRITE(sc->sh, reg_wsid[hw_wsid], 0x00);
 	return 0;
@@ -3180,6 +3375,9 @@ struct ieee80211_ops ssv6200_ops = {
 	.set_tim = ssv6200_set_tim,
 	.conf_tx = ssv6200_conf_tx,
 	.ampdu_action = ssv6200_ampdu_action,
+#ifdef SSV_TXQ_SCHED
+	.wake_tx_queue = ssv6200_wake_tx_queue,
+#endif
 #ifdef CONFIG_PM
 	.suspend = ssv6xxx_suspend,
 	.resume = ssv6xxx_resume,
@@ -3198,6 +3396,10 @@ int ssv6200_tx_flow_control(void *dev, int hw_txqid, bool fc_en, int debug)
 		if (sc->tx.flow_ctrl_status & (1 << ac)) {
 			ieee80211_wake_queue(sc->hw, ac);
 			sc->tx.flow_ctrl_status &= ~(1 << ac);
+#ifdef SSV_TXQ_SCHED
+			WRITE_ONCE(sc->tx.txq_scheduled, true);
+			wake_up_interruptible(&sc->tx_wait_q);
+#endif
 		} else {
 		}
 	} else {
@@ -3617,6 +3819,7 @@ static void _proc_data_rx_skb(struct ssv_softc *sc, struct sk_buff *rx_skb)
 		    frame_control & ~(cpu_to_le16(IEEE80211_FCTL_PROTECTED));
 		rxs->flag |= (RX_FLAG_DECRYPTED | RX_FLAG_IV_STRIPPED);
 	}
+	HCI_BENCH_RX_DONE(sc->sh, rx_skb);
 #if defined(USE_THREAD_RX) && !defined(IRQ_PROC_RX_DATA)
 	local_bh_disable();
 	ieee80211_rx(sc->hw, rx_skb);
@@ -3654,6 +3857,9 @@ void _process_rx_q(struct ssv_softc *sc, struct sk_buff_head *rx_q,
 	bool has_ba_processed = false;
 #endif
 	while (1) {
+		if ((sc->rc_report_head - sc->rc_report_tail) >=
+		    (SSV_RC_REPORT_RING_SIZE / 2))
+			ssv6xxx_rc_report_drain(sc);
 		if (rx_q_lock != NULL) {
 			spin_lock_irqsave(rx_q_lock, flags);
 			skb = __skb_dequeue(rx_q);
@@ -3677,11 +3883,13 @@ void _process_rx_q(struct ssv_softc *sc, struct sk_buff_head *rx_q,
 				has_ba_processed = true;
 #endif
 			} else if (h_evt->h_event == SOC_EVT_RC_MPDU_REPORT) {
-				skb_queue_tail(&sc->rc_report_queue, skb);
-				if (sc->rc_sample_sechedule == 0)
-					queue_work(sc->rc_sample_workqueue,
-						   &sc->rc_sample_work);
+				ssv6xxx_rc_report_put(sc, h_evt->h_event,
+						      (struct
+						       firmware_rate_control_report_data
+						       *)&h_evt->dat[0]);
+				dev_kfree_skb_any(skb);
 			} else if (h_evt->h_event == SOC_EVT_SDIO_TEST_COMMAND) {
+				HCI_BENCH_RX_DONE(sc->sh, skb);
 				if (h_evt->evt_seq_no == 0) {
 					dev_dbg(sc->dev, "SOC_EVT_SDIO_TEST_COMMAND\n");
 					sc->sdio_rx_evt_size = h_evt->len;
@@ -3761,6 +3969,7 @@ void _process_rx_q(struct ssv_softc *sc, struct sk_buff_head *rx_q,
 		ssv6xxx_ampdu_postprocess_BA(sc->hw);
 	}
 #endif
+	ssv6xxx_rc_report_drain(sc);
 }
 
 #if !defined(USE_THREAD_RX) || defined(USE_BATCH_RX)
@@ -26,6 +26,10 @@
 #include "sec.h"
 #include "p2p.h"
 #include <linux/kthread.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,10,0)
+#define SSV_TXQ_SCHED
+#endif
+#define SSV_TXQ_BURST (8)
 #define SSV6200_MAX_HW_MAC_ADDR 2
 #define SSV6200_MAX_VIF 2
 #define SSV6200_RX_BA_MAX_SESSIONS 1
@@ -83,8 +87,12 @@ extern u16 generic_deci_tbl[];
 #define IS_SSV_SHORT_PRE(dsc) ((dsc)->rate_idx>=4 && (dsc)->rate_idx<=14)
 #define SMAC_REG_WRITE(_s,_r,_v) \
         (_s)->hci.hci_ops->hci_write_word(_r,_v)
+#define SMAC_REG_WRITE_BATCH(_s,_regs,_n) \
+        (_s)->hci.hci_ops->hci_write_word_batch(_regs,_n)
 #define SMAC_REG_READ(_s,_r,_v) \
         (_s)->hci.hci_ops->hci_read_word(_r, _v)
+#define SMAC_REG_SHADOW_INVALIDATE(_s) \
+        (_s)->hci.hci_ops->hci_reg_shadow_invalidate()
 #define SMAC_LOAD_FW(_s,_r,_v) \
         (_s)->hci.hci_ops->hci_load_fw(_r, _v)
 #define SMAC_IFC_RESET(_s) (_s)->hci.hci_ops->hci_interface_reset()
@@ -131,15 +139,14 @@ extern u16 generic_deci_tbl[];
     (_sh)->hci.hci_ops->hci_pmu_wakeup()
 #define HCI_SEND_CMD(_sh,_sk) \
         (_sh)->hci.hci_ops->hci_send_cmd(_sk)
+#define HCI_BENCH_RX_DONE(_sh,_sk) \
+        (_sh)->hci.hci_ops->hci_bench_rx_done(_sk)
 #define SSV6XXX_SET_HW_TABLE(sh_,tbl_) \
 ({ \
-    int ret = 0; \
-    u32 i=0; \
-    for(; i<sizeof(tbl_)/sizeof(struct ssv6xxx_dev_table); i++) { \
-        ret = SMAC_REG_WRITE(sh_, tbl_[i].address, tbl_[i].data); \
-        if (ret) break; \
-    } \
-    ret; \
+    BUILD_BUG_ON(sizeof(struct ssv6xxx_dev_table) != \
+                 sizeof(struct ssv6xxx_reg_batch)); \
+    SMAC_REG_WRITE_BATCH(sh_, (const struct ssv6xxx_reg_batch *)(tbl_), \
+                         sizeof(tbl_)/sizeof(struct ssv6xxx_dev_table)); \
 })
 #define SSV6XXX_USE_HW_DECRYPT(_priv) (_priv->has_hw_decrypt)
 #define SSV6XXX_USE_SW_DECRYPT(_priv) (SSV6XXX_USE_LOCAL_SW_DECRYPT(_priv) || SSV6XXX_USE_MAC80211_DECRYPT(_priv))
@@ -196,6 +203,9 @@ struct ssv_tx {
 	struct list_head ampdu_tx_que;
 	spinlock_t ampdu_tx_que_lock;
 	u16 ampdu_tx_group_id;
+	struct ssv_ampdu_pool ampdu_pool;
+	unsigned long ampdu_timer_flags;
+	bool txq_scheduled;
 };
 struct ssv_rx {
 	struct sk_buff *rx_buf;
@@ -230,6 +240,12 @@ struct ssv_vif_info {
 	struct dentry *debugfs_dir;
 #endif
 };
+#define SSV_TX_TPL_NUM_TXQ 5
+#define SSV_TX_TPL_WSID_SHIFT 32
+#define SSV_TX_TPL_TXQ_SHIFT 36
+#define SSV_TX_TPL_VALID (1ULL << 39)
+#define SSV_TX_TPL_GEN_SHIFT 40
+#define SSV_TX_TPL_GEN_MASK (~0ULL << SSV_TX_TPL_GEN_SHIFT)
 struct ssv_sta_priv_data {
 	int sta_idx;
 	int rc_idx;
@@ -245,6 +261,7 @@ struct ssv_sta_priv_data {
 	bool use_mac80211_decrypt;
 	u8 group_key_idx;
 	u32 beacon_rssi;
+	atomic64_t tx_tpl[SSV_TX_TPL_NUM_TXQ][2];
 };
 struct ssv_vif_priv_data {
 	int vif_idx;
@@ -260,6 +277,7 @@ struct ssv_vif_priv_data {
 	bool use_mac80211_decrypt;
 	bool force_sw_encrypt;
 	u8 group_key_idx;
+	atomic64_t tx_tpl[SSV_TX_TPL_NUM_TXQ][2];
 };
 #define SC_OP_INVALID 0x00000001
 #define SC_OP_HW_RESET 0x00000002
@@ -282,6 +300,7 @@ struct ssv6xxx_bcast_txq {
 typedef struct AMPDU_TID_st AMPDU_TID;
 #define MAX_TID (24)
 #endif
+#define SSV_RC_REPORT_RING_SIZE 128
 struct ssv_softc {
 	struct ieee80211_hw *hw;
 	struct device *dev;
@@ -307,13 +326,14 @@ struct ssv_softc {
 	u32 sc_flags;
 	void *rc;
 	int max_rate_idx;
-	struct workqueue_struct *rc_sample_workqueue;
-	struct sk_buff_head rc_report_queue;
-	struct work_struct rc_sample_work;
+	struct ssv_rc_report rc_report_ring[SSV_RC_REPORT_RING_SIZE];
+	u32 rc_report_head;
+	u32 rc_report_tail;
+	u32 rc_report_drop;
+	atomic_t tx_tpl_gen;
 #ifdef DEBUG_AMPDU_FLUSH
 	struct AMPDU_TID_st *tid[MAX_TID];
 #endif
-	u16 rc_sample_sechedule;
 	u16 *mac_deci_tbl;
 	struct workqueue_struct *config_wq;
 	bool bq4_dtim;
@@ -414,6 +434,9 @@ u32 ssv6xxx_pbuf_alloc(struct ssv_softc *sc, int size, int type);
 bool ssv6xxx_pbuf_free(struct ssv_softc *sc, u32 pbuf_addr);
 void ssv6xxx_add_txinfo(struct ssv_softc *sc, struct sk_buff *skb);
 void ssv6xxx_update_txinfo(struct ssv_softc *sc, struct sk_buff *skb);
+void ssv6xxx_tx_tpl_invalidate(struct ssv_softc *sc);
+void ssv6xxx_rate_txtime_init(struct ssv_rate_txtime *txtime,
+			      const struct ssv_rc_rate *rc_table, int n_rates);
 int ssv6xxx_update_decision_table(struct ssv_softc *sc);
 void ssv6xxx_ps_callback_func(unsigned long data);
 void ssv6xxx_enable_ps(struct ssv_softc *sc);
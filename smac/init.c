@@ -172,6 +172,7 @@ int ssv6xxx_do_iq_calib(struct ssv_hw *sh, struct ssv6xxx_iqk_cfg *p_cfg)
 							   msecs_to_jiffies
 							   (500));
 		set_current_state(TASK_RUNNING);
+		SMAC_REG_SHADOW_INVALIDATE(sh);
 		if (timeout == 0)
 			return -ETIME;
 		if (sh->sc->iq_cali_done != IQ_CALI_OK)
@@ -268,6 +269,9 @@ static void ssv6xxx_set_80211_hw_capab(struct ssv_softc *sc)
 		hw->max_rx_aggregation_subframes = 12;
 	hw->max_tx_aggregation_subframes = 64;
 	hw->sta_data_size = sizeof(struct ssv_sta_priv_data);
+#ifdef SSV_TXQ_SCHED
+	wiphy_ext_feature_set(hw->wiphy, NL80211_EXT_FEATURE_AIRTIME_FAIRNESS);
+#endif
 	hw->vif_data_size = sizeof(struct ssv_vif_priv_data);
 	memcpy(sh->maddr[0].addr, &sh->cfg.maddr[0][0], ETH_ALEN);
 	hw->wiphy->addresses = sh->maddr;
@@ -381,6 +385,7 @@ static int ssv6xxx_init_softc(struct ssv_softc *sc)
 	sc->tx.ac_txqid[0] = WMM_AC_BK;
 	INIT_LIST_HEAD(&sc->tx.ampdu_tx_que);
 	spin_lock_init(&sc->tx.ampdu_tx_que_lock);
+	skb_queue_head_init(&sc->tx.ampdu_pool.free_q);
 	memset((void *)&sc->rx, 0, sizeof(struct ssv_rx));
 	spin_lock_init(&sc->rx.rxq_lock);
 	skb_queue_head_init(&sc->rx.rxq_head);
@@ -486,6 +491,7 @@ static int ssv6xxx_deinit_softc(struct ssv_softc *sc)
 		dev_dbg(sc->dev, "Stopped RX task.\n");
 	}
 	destroy_workqueue(sc->config_wq);
+	ssv6xxx_ampdu_pool_purge(sc);
 	return 0;
 }
 
@@ -635,9 +641,16 @@ int ssv6xxx_init_mac(struct ssv_hw *sh)
 	for (i = 0; i < SSV_RC_MAX_STA; i++)
 		sh->hw_sec_key[i] = sh->hw_buf_ptr[i];
 	for (i = 0; i < SSV_RC_MAX_STA; i++) {
-		int x;
+		struct ssv6xxx_reg_batch regs[16];
+		int x, n = 0;
 		for (x = 0; x < sizeof(struct ssv6xxx_hw_sec); x += 4) {
-			SMAC_REG_WRITE(sh, sh->hw_sec_key[i] + x, 0);
+			regs[n].addr = sh->hw_sec_key[i] + x;
+			regs[n].value = 0;
+			if ((++n < ARRAY_SIZE(regs))
+			    && ((x + 4) < sizeof(struct ssv6xxx_hw_sec)))
+				continue;
+			SMAC_REG_WRITE_BATCH(sh, regs, n);
+			n = 0;
 		}
 	}
 	SMAC_REG_READ(sh, ADR_SCRT_SET, &regval);
@@ -762,6 +775,7 @@ void ssv6xxx_restart_hw(struct ssv_softc *sc)
 	sc->force_triger_reset = true;
 	HCI_STOP(sc->sh);
 	SMAC_REG_WRITE(sc->sh, 0xce000004, 0x0);
+	SMAC_REG_SHADOW_INVALIDATE(sc->sh);
 	sc->beacon_info[0].pubf_addr = 0x00;
 	sc->beacon_info[1].pubf_addr = 0x00;
 	ieee80211_restart_hw(sc->hw);
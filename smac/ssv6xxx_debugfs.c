@@ -53,6 +53,24 @@ static const struct file_operations queue_status_fops
     = {.read = queue_status_read,
 	.open = queue_status_open
 };
+
+static ssize_t ampdu_pool_read(struct file *file,
+			       char __user * user_buf, size_t count,
+			       loff_t * ppos)
+{
+	struct ssv_softc *sc = (struct ssv_softc *)file->private_data;
+	char status_buf[128];
+	ssize_t status_size;
+	status_size = ssv6xxx_ampdu_pool_dump(sc, status_buf,
+					      sizeof(status_buf));
+	return simple_read_from_buffer(user_buf, count, ppos, status_buf,
+				       status_size);
+}
+
+static const struct file_operations ampdu_pool_fops
+    = {.read = ampdu_pool_read,
+	.open = queue_status_open
+};
 #endif
 int ssv6xxx_init_debugfs(struct ssv_softc *sc, const char *name)
 {
@@ -69,6 +87,10 @@ int ssv6xxx_init_debugfs(struct ssv_softc *sc, const char *name)
 	sc->sh->hci.hci_ops->hci_init_debugfs(sc->debugfs_dir);
 	debugfs_create_file("queue_status", 00444, drv_debugfs_dir,
 			    sc, &queue_status_fops);
+	debugfs_create_file("ampdu_pool", 00444, drv_debugfs_dir,
+			    sc, &ampdu_pool_fops);
+	debugfs_create_u32("rc_report_drop", 00444, drv_debugfs_dir,
+			   &sc->rc_report_drop);
 #endif
 	return 0;
 }
@@ -14,17 +14,18 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <linux/version.h>
-#include <ssv6200.h>
-#include "dev.h"
+#include "ssv_rc_shim.h"
+#include <ssv6200_common.h>
 #include "ssv_ht_rc.h"
-#include "ssv_rc.h"
+#include "ssv_pid_rc.h"
 #define SAMPLE_COUNT 4
 #define HT_CW_MIN 15
 #define HT_SEGMENT_SIZE 6000
 #define AVG_PKT_SIZE 12000
 #define SAMPLE_COLUMNS 10
+#ifndef EWMA_LEVEL
 #define EWMA_LEVEL 75
+#endif
 #define MCS_NBITS (AVG_PKT_SIZE << 3)
 #define MCS_NSYMS(bps) ((MCS_NBITS + (bps) - 1) / (bps))
 #define MCS_SYMBOL_TIME(sgi,syms) \
@@ -58,6 +59,14 @@ const u16 ampdu_max_transmit_length[RATE_TABLE_SIZE] = {
 	4600, 9200, 13800, 18500, 27700, 37000, 41600, 46200
 };
 
+const u32 ampdu_rate_kbps[RATE_TABLE_SIZE] = {
+	0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	6500, 13000, 19500, 26000, 39000, 52000, 58500, 65000,
+	7200, 14400, 21700, 28900, 43300, 57800, 65000, 72200,
+	6500, 13000, 19500, 26000, 39000, 52000, 58500, 65000
+};
+
 static u8 sample_table[SAMPLE_COLUMNS][MCS_GROUP_RATES];
 static int minstrel_ewma(int old, int new, int weight)
 {
@@ -215,18 +224,6 @@ static void rate_control_ht_sample(struct ssv62xx_ht *mi,
 	mi->stats_update = jiffies;
 }
 
-static void minstrel_ht_set_rate(struct ssv62xx_ht *mi,
-				 struct fw_rc_retry_params *rate, int index,
-				 bool sample, bool rtscts,
-				 struct ssv_sta_rc_info *rc_sta,
-				 struct ssv_rate_ctrl *ssv_rc)
-{
-	struct minstrel_rate_stats *mr;
-	mr = minstrel_get_ratestats(mi, index);
-	rate->drate = ssv_rc->rc_table[mr->rc_index].hw_rate_idx;
-	rate->crate = ssv_rc->rc_table[mr->rc_index].ctrl_rate_idx;
-}
-
 static inline int minstrel_get_duration(int index,
 					struct ssv_sta_rc_info *rc_sta)
 {
@@ -254,8 +251,8 @@ static void minstrel_next_sample_idx(struct ssv62xx_ht *mi)
 	}
 }
 
-static int minstrel_get_sample_rate(struct ssv62xx_ht *mi,
-				    struct ssv_sta_rc_info *rc_sta)
+int ssv62xx_ht_get_sample_rate(struct ssv62xx_ht *mi,
+			       struct ssv_sta_rc_info *rc_sta)
 {
 	struct minstrel_rate_stats *mr;
 	struct minstrel_mcs_group_data *mg;
@@ -283,133 +280,6 @@ static int minstrel_get_sample_rate(struct ssv62xx_ht *mi,
 	return sample_idx;
 }
 
-static void _fill_txinfo_rates(struct ssv_rate_ctrl *ssv_rc,
-			       struct sk_buff *skb,
-			       struct fw_rc_retry_params *ar)
-{
-	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
-	info->control.rates[0].idx =
-	    ssv_rc->rc_table[ar[0].drate].dot11_rate_idx;
-	info->control.rates[0].count = 1;
-	info->control.rates[SSV_DRATE_IDX].count = ar[0].drate;
-	info->control.rates[SSV_CRATE_IDX].count = ar[0].crate;
-}
-
-extern const u16 ssv6xxx_rc_rate_set[RC_TYPE_MAX][13];
-s32 ssv62xx_ht_rate_update(struct sk_buff *skb, struct ssv_softc *sc,
-			   struct fw_rc_retry_params *ar)
-{
-	struct ssv_rate_ctrl *ssv_rc = sc->rc;
-	struct SKB_info_st *skb_info = (struct SKB_info_st *)skb->head;
-	struct ieee80211_sta *sta = skb_info->sta;
-	struct ssv62xx_ht *mi = NULL;
-	int sample_idx;
-	bool sample = false;
-	struct ssv_sta_rc_info *rc_sta;
-	struct ssv_sta_priv_data *sta_priv;
-	struct rc_pid_sta_info *spinfo;
-	int ret = 0;
-	if (sc->sc_flags & SC_OP_FIXED_RATE) {
-		ar[0].count = 3;
-		ar[0].drate = ssv_rc->rc_table[sc->max_rate_idx].hw_rate_idx;
-		ar[0].crate = ssv_rc->rc_table[sc->max_rate_idx].ctrl_rate_idx;
-		ar[1].count = 2;
-		ar[1].drate = ssv_rc->rc_table[sc->max_rate_idx].hw_rate_idx;
-		ar[1].crate = ssv_rc->rc_table[sc->max_rate_idx].ctrl_rate_idx;
-		ar[2].count = 2;
-		ar[2].drate = ssv_rc->rc_table[sc->max_rate_idx].hw_rate_idx;
-		ar[2].crate = ssv_rc->rc_table[sc->max_rate_idx].ctrl_rate_idx;
-		_fill_txinfo_rates(ssv_rc, skb, ar);
-		return ssv_rc->rc_table[sc->max_rate_idx].hw_rate_idx;
-	}
-	if (sta == NULL) {
-		dev_err(sc->dev, "Station NULL\n");
-		BUG_ON(1);
-	}
-	sta_priv = (struct ssv_sta_priv_data *)sta->drv_priv;
-	rc_sta = &ssv_rc->sta_rc_info[sta_priv->rc_idx];
-	spinfo = &rc_sta->spinfo;
-	if ((rc_sta->rc_wsid >= SSV_RC_MAX_HARDWARE_SUPPORT)
-	    || (rc_sta->rc_wsid < 0)) {
-		struct ssv_sta_priv_data *ssv_sta_priv;
-		int rateidx = 99;
-		ssv_sta_priv = (struct ssv_sta_priv_data *)sta->drv_priv;
-		{
-			if ((rc_sta->ht_rc_type >= RC_TYPE_HT_SGI_20) &&
-			    (ssv_sta_priv->rx_data_rate <
-			     SSV62XX_RATE_MCS_INDEX)) {
-				if (ssv6xxx_rc_rate_set[rc_sta->ht_rc_type][0]
-				    == 12)
-					rateidx =
-					    (int)rc_sta->pinfo.rinfo[4].
-					    rc_index;
-				else
-					rateidx =
-					    (int)rc_sta->pinfo.rinfo[0].
-					    rc_index;
-			} else {
-				rateidx = (int)ssv_sta_priv->rx_data_rate;
-				rateidx -= SSV62XX_RATE_MCS_INDEX;
-				rateidx %= 8;
-				if (rc_sta->ht_rc_type == RC_TYPE_HT_SGI_20)
-					rateidx += SSV62XX_RATE_MCS_SGI_INDEX;
-				else if (rc_sta->ht_rc_type ==
-					 RC_TYPE_HT_LGI_20)
-					rateidx += SSV62XX_RATE_MCS_LGI_INDEX;
-				else
-					rateidx +=
-					    SSV62XX_RATE_MCS_GREENFIELD_INDEX;
-			}
-		}
-		ar[0].count = 3;
-		ar[2].drate = ar[1].drate = ar[0].drate =
-		    ssv_rc->rc_table[rateidx].hw_rate_idx;
-		ar[2].crate = ar[1].crate = ar[0].crate =
-		    ssv_rc->rc_table[rateidx].ctrl_rate_idx;
-		ar[1].count = 2;
-		ar[2].count = 2;
-		_fill_txinfo_rates(ssv_rc, skb, ar);
-		return rateidx;
-	}
-	mi = &rc_sta->ht;
-	sample_idx = minstrel_get_sample_rate(mi, rc_sta);
-	if (sample_idx >= 0) {
-		sample = true;
-		minstrel_ht_set_rate(mi, &ar[0], sample_idx,
-				     true, false, rc_sta, ssv_rc);
-	} else {
-		minstrel_ht_set_rate(mi, &ar[0], mi->max_tp_rate,
-				     false, false, rc_sta, ssv_rc);
-	}
-	ar[0].count = mi->first_try_count;
-	ret = ar[0].drate;
-	{
-		if (sample_idx >= 0)
-			minstrel_ht_set_rate(mi, &ar[1], mi->max_tp_rate,
-					     false, false, rc_sta, ssv_rc);
-		else
-			minstrel_ht_set_rate(mi, &ar[1], mi->max_tp_rate2,
-					     false, true, rc_sta, ssv_rc);
-		ar[1].count = mi->second_try_count;
-		if (ret > ar[1].drate)
-			ret = ar[1].drate;
-		minstrel_ht_set_rate(mi, &ar[2], mi->max_prob_rate,
-				     false, !sample, rc_sta, ssv_rc);
-		ar[2].count = mi->other_try_count;
-		if (ret > ar[2].drate)
-			ret = ar[2].drate;
-	}
-	mi->total_packets++;
-	if (mi->total_packets == ~0) {
-		mi->total_packets = 0;
-		mi->sample_packets = 0;
-	}
-	if (spinfo->real_hw_index < SSV62XX_RATE_MCS_INDEX)
-		return spinfo->real_hw_index;
-	_fill_txinfo_rates(ssv_rc, skb, ar);
-	return ret;
-}
-
 static void init_sample_table(void)
 {
 	int col, i, new_idx;
@@ -484,27 +354,21 @@ static bool minstrel_ht_txstat_valid(struct ssv62xx_tx_rate *rate)
 	return true;
 }
 
-void ssv6xxx_ht_report_handler(struct ssv_softc *sc, struct sk_buff *skb,
+void ssv6xxx_ht_report_handler(struct ssv_rc_report *report_data,
 			       struct ssv_sta_rc_info *rc_sta)
 {
-	struct cfg_host_event *host_event;
-	struct firmware_rate_control_report_data *report_data;
 	struct ssv62xx_ht *mi;
 	struct minstrel_rate_stats *rate;
 	bool last = false;
 	int i = 0;
 	u16 report_ampdu_packets = 0;
 	unsigned long period;
-	host_event = (struct cfg_host_event *)skb->data;
-	report_data =
-	    (struct firmware_rate_control_report_data *)&host_event->dat[0];
-	if (host_event->h_event == SOC_EVT_RC_AMPDU_REPORT) {
+	if (report_data->h_event == SOC_EVT_RC_AMPDU_REPORT) {
 		report_ampdu_packets = 1;
-	} else if (host_event->h_event == SOC_EVT_RC_MPDU_REPORT) {
+	} else if (report_data->h_event == SOC_EVT_RC_MPDU_REPORT) {
 		report_data->ampdu_len = 1;
 		report_ampdu_packets = report_data->ampdu_len;
 	} else {
-		dev_warn(sc->dev, "rate control report handler got garbage\n");
 		return;
 	}
 	mi = &rc_sta->ht;
@@ -524,8 +388,7 @@ void ssv6xxx_ht_report_handler(struct ssv_softc *sc, struct sk_buff *skb,
 		if ((report_data->rates[i].data_rate < SSV62XX_RATE_MCS_INDEX)
 		    || (report_data->rates[i].data_rate >=
 			SSV62XX_RATE_MCS_GREENFIELD_INDEX)) {
-			dev_dbg
-			    (sc->dev, "[RC]ssv6xxx_ht_report_handler get error report rate[%d]\n",
+			pr_debug("[RC]ssv6xxx_ht_report_handler get error report rate[%d]\n",
 			     report_data->rates[i].data_rate);
 			break;
 		}
@@ -20,12 +20,15 @@
 #define MINSTREL_SCALE 16
 #define MINSTREL_FRAC(val,div) (((val) << MINSTREL_SCALE) / div)
 #define MINSTREL_TRUNC(val) ((val) >> MINSTREL_SCALE)
+#ifndef SSV_RC_HT_INTERVAL
 #define SSV_RC_HT_INTERVAL 100
+#endif
 extern const u16 ampdu_max_transmit_length[];
-s32 ssv62xx_ht_rate_update(struct sk_buff *skb, struct ssv_softc *sc,
-			   struct fw_rc_retry_params *ar);
+extern const u32 ampdu_rate_kbps[];
 void ssv62xx_ht_rc_caps(const u16 ssv6xxx_rc_rate_set[RC_TYPE_MAX][13],
 			struct ssv_sta_rc_info *rc_sta);
-void ssv6xxx_ht_report_handler(struct ssv_softc *sc, struct sk_buff *skb,
+int ssv62xx_ht_get_sample_rate(struct ssv62xx_ht *mi,
+			       struct ssv_sta_rc_info *rc_sta);
+void ssv6xxx_ht_report_handler(struct ssv_rc_report *report,
 			       struct ssv_sta_rc_info *rc_sta);
 #endif
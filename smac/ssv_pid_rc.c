@@ -0,0 +1,907 @@
+/*
+ * Copyright (c) 2015 South Silicon Valley Microelectronics Inc.
+ * Copyright (c) 2015 iComm Corporation
+ *
+ * This program is free software: you can redistribute it and/or modify 
+ * it under the terms of the GNU General Public License as published by 
+ * the Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ssv_rc_shim.h"
+#include <ssv6200_common.h>
+#include "ssv_pid_rc.h"
+struct ssv_rc_rate ssv_11bgn_rate_table[RATE_TABLE_SIZE] = {
+	[0] = {.rc_flags = RC_FLAG_LEGACY,
+	       .phy_type = WLAN_RC_PHY_CCK,
+	       .rate_kbps = 1000,
+	       .dot11_rate_idx = 0,
+	       .ctrl_rate_idx = 0,
+	       .hw_rate_idx = 0,
+	       .arith_shift = 8,
+	       .target_pf = 26,
+	       },
+	[1] = {.rc_flags = RC_FLAG_LEGACY,
+	       .phy_type = WLAN_RC_PHY_CCK,
+	       .rate_kbps = 2000,
+	       .dot11_rate_idx = 1,
+	       .ctrl_rate_idx = 1,
+	       .hw_rate_idx = 1,
+	       .arith_shift = 8,
+	       .target_pf = 26,
+	       },
+	[2] = {.rc_flags = RC_FLAG_LEGACY,
+	       .phy_type = WLAN_RC_PHY_CCK,
+	       .rate_kbps = 5500,
+	       .dot11_rate_idx = 2,
+	       .ctrl_rate_idx = 1,
+	       .hw_rate_idx = 2,
+	       .arith_shift = 8,
+	       .target_pf = 26,
+	       },
+	[3] = {.rc_flags = RC_FLAG_LEGACY,
+	       .phy_type = WLAN_RC_PHY_CCK,
+	       .rate_kbps = 11000,
+	       .dot11_rate_idx = 3,
+	       .ctrl_rate_idx = 1,
+	       .hw_rate_idx = 3,
+	       .arith_shift = 8,
+	       .target_pf = 26,
+	       },
+	[4] = {.rc_flags = RC_FLAG_LEGACY | RC_FLAG_SHORT_PREAMBLE,
+	       .phy_type = WLAN_RC_PHY_CCK,
+	       .rate_kbps = 2000,
+	       .dot11_rate_idx = 1,
+	       .ctrl_rate_idx = 4,
+	       .hw_rate_idx = 4,
+	       .arith_shift = 8,
+	       .target_pf = 26,
+	       },
+	[5] = {.rc_flags = RC_FLAG_LEGACY | RC_FLAG_SHORT_PREAMBLE,
+	       .phy_type = WLAN_RC_PHY_CCK,
+	       .rate_kbps = 5500,
+	       .dot11_rate_idx = 2,
+	       .ctrl_rate_idx = 4,
+	       .hw_rate_idx = 5,
+	       .arith_shift = 8,
+	       .target_pf = 26,
+	       },
+	[6] = {.rc_flags = RC_FLAG_LEGACY | RC_FLAG_SHORT_PREAMBLE,
+	       .phy_type = WLAN_RC_PHY_CCK,
+	       .rate_kbps = 11000,
+	       .dot11_rate_idx = 3,
+	       .ctrl_rate_idx = 4,
+	       .hw_rate_idx = 6,
+	       .arith_shift = 8,
+	       .target_pf = 26,
+	       },
+	[7] = {.rc_flags = RC_FLAG_LEGACY,
+	       .phy_type = WLAN_RC_PHY_OFDM,
+	       .rate_kbps = 6000,
+	       .dot11_rate_idx = 4,
+	       .ctrl_rate_idx = 7,
+	       .hw_rate_idx = 7,
+	       .arith_shift = 8,
+	       .target_pf = 26,
+	       },
+	[8] = {.rc_flags = RC_FLAG_LEGACY,
+	       .phy_type = WLAN_RC_PHY_OFDM,
+	       .rate_kbps = 9000,
+	       .dot11_rate_idx = 5,
+	       .ctrl_rate_idx = 7,
+	       .hw_rate_idx = 8,
+	       .arith_shift = 8,
+	       .target_pf = 26,
+	       },
+	[9] = {.rc_flags = RC_FLAG_LEGACY,
+	       .phy_type = WLAN_RC_PHY_OFDM,
+	       .rate_kbps = 12000,
+	       .dot11_rate_idx = 6,
+	       .ctrl_rate_idx = 9,
+	       .hw_rate_idx = 9,
+	       .arith_shift = 8,
+	       .target_pf = 26,
+	       },
+	[10] = {.rc_flags = RC_FLAG_LEGACY,
+		.phy_type = WLAN_RC_PHY_OFDM,
+		.rate_kbps = 18000,
+		.dot11_rate_idx = 7,
+		.ctrl_rate_idx = 9,
+		.hw_rate_idx = 10,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[11] = {.rc_flags = RC_FLAG_LEGACY,
+		.phy_type = WLAN_RC_PHY_OFDM,
+		.rate_kbps = 24000,
+		.dot11_rate_idx = 8,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 11,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[12] = {.rc_flags = RC_FLAG_LEGACY,
+		.phy_type = WLAN_RC_PHY_OFDM,
+		.rate_kbps = 36000,
+		.dot11_rate_idx = 9,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 12,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[13] = {.rc_flags = RC_FLAG_LEGACY,
+		.phy_type = WLAN_RC_PHY_OFDM,
+		.rate_kbps = 48000,
+		.dot11_rate_idx = 10,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 13,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[14] = {.rc_flags = RC_FLAG_LEGACY,
+		.phy_type = WLAN_RC_PHY_OFDM,
+		.rate_kbps = 54000,
+		.dot11_rate_idx = 11,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 14,
+		.arith_shift = 8,
+		.target_pf = 8},
+	[15] = {.rc_flags = RC_FLAG_HT,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
+		.rate_kbps = 6500,
+		.dot11_rate_idx = 0,
+		.ctrl_rate_idx = 7,
+		.hw_rate_idx = 15,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[16] = {.rc_flags = RC_FLAG_HT,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
+		.rate_kbps = 13000,
+		.dot11_rate_idx = 1,
+		.ctrl_rate_idx = 9,
+		.hw_rate_idx = 16,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[17] = {.rc_flags = RC_FLAG_HT,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
+		.rate_kbps = 19500,
+		.dot11_rate_idx = 2,
+		.ctrl_rate_idx = 9,
+		.hw_rate_idx = 17,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[18] = {.rc_flags = RC_FLAG_HT,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
+		.rate_kbps = 26000,
+		.dot11_rate_idx = 3,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 18,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[19] = {.rc_flags = RC_FLAG_HT,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
+		.rate_kbps = 39000,
+		.dot11_rate_idx = 4,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 19,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[20] = {.rc_flags = RC_FLAG_HT,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
+		.rate_kbps = 52000,
+		.dot11_rate_idx = 5,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 20,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[21] = {.rc_flags = RC_FLAG_HT,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
+		.rate_kbps = 58500,
+		.dot11_rate_idx = 6,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 21,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[22] = {.rc_flags = RC_FLAG_HT,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
+		.rate_kbps = 65000,
+		.dot11_rate_idx = 7,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 22,
+		.arith_shift = 8,
+		.target_pf = 8},
+	[23] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
+		.rate_kbps = 7200,
+		.dot11_rate_idx = 0,
+		.ctrl_rate_idx = 7,
+		.hw_rate_idx = 23,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[24] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
+		.rate_kbps = 14400,
+		.dot11_rate_idx = 1,
+		.ctrl_rate_idx = 9,
+		.hw_rate_idx = 24,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[25] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
+		.rate_kbps = 21700,
+		.dot11_rate_idx = 2,
+		.ctrl_rate_idx = 9,
+		.hw_rate_idx = 25,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[26] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
+		.rate_kbps = 28900,
+		.dot11_rate_idx = 3,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 26,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[27] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
+		.rate_kbps = 43300,
+		.dot11_rate_idx = 4,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 27,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[28] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
+		.rate_kbps = 57800,
+		.dot11_rate_idx = 5,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 28,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[29] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
+		.rate_kbps = 65000,
+		.dot11_rate_idx = 6,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 29,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[30] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
+		.rate_kbps = 72200,
+		.dot11_rate_idx = 7,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 30,
+		.arith_shift = 8,
+		.target_pf = 8},
+	[31] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
+		.rate_kbps = 6500,
+		.dot11_rate_idx = 0,
+		.ctrl_rate_idx = 7,
+		.hw_rate_idx = 31,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[32] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
+		.rate_kbps = 13000,
+		.dot11_rate_idx = 1,
+		.ctrl_rate_idx = 9,
+		.hw_rate_idx = 32,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[33] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
+		.rate_kbps = 19500,
+		.dot11_rate_idx = 2,
+		.ctrl_rate_idx = 9,
+		.hw_rate_idx = 33,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[34] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
+		.rate_kbps = 26000,
+		.dot11_rate_idx = 3,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 34,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[35] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
+		.rate_kbps = 39000,
+		.dot11_rate_idx = 4,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 35,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[36] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
+		.rate_kbps = 52000,
+		.dot11_rate_idx = 5,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 36,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[37] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
+		.rate_kbps = 58500,
+		.dot11_rate_idx = 6,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 37,
+		.arith_shift = 8,
+		.target_pf = 26,
+		},
+	[38] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
+		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
+		.rate_kbps = 65000,
+		.dot11_rate_idx = 7,
+		.ctrl_rate_idx = 11,
+		.hw_rate_idx = 38,
+		.arith_shift = 8,
+		.target_pf = 8},
+};
+
+const u16 ssv6xxx_rc_rate_set[RC_TYPE_MAX][13] = {
+	[RC_TYPE_B_ONLY] = {4, 0, 1, 2, 3},
+	[RC_TYPE_LEGACY_GB] = {12, 0, 1, 2, 7, 8, 3, 9, 10, 11, 12, 13, 14},
+	[RC_TYPE_SGI_20] = {8, 23, 24, 25, 26, 27, 28, 29, 30},
+	[RC_TYPE_LGI_20] = {8, 15, 16, 17, 18, 19, 20, 21, 22},
+	[RC_TYPE_HT_SGI_20] = {8, 23, 24, 25, 26, 27, 28, 29, 30},
+	[RC_TYPE_HT_LGI_20] = {8, 15, 16, 17, 18, 19, 20, 21, 22},
+	[RC_TYPE_HT_GF] = {8, 31, 32, 33, 34, 35, 36, 37, 38},
+};
+
+static u32 ssv6xxx_rate_supported(struct ssv_sta_rc_info *rc_sta, u32 index)
+{
+	return (rc_sta->rc_supp_rates & BIT(index));
+}
+
+static u8 ssv6xxx_rate_lowest_index(struct ssv_sta_rc_info *rc_sta)
+{
+	int i;
+	for (i = 0; i < rc_sta->rc_num_rate; i++)
+		if (ssv6xxx_rate_supported(rc_sta, i))
+			return i;
+	return 0;
+}
+
+#ifdef DISABLE_RATE_CONTROL_SAMPLE
+static u8 ssv6xxx_rate_highest_index(struct ssv_sta_rc_info *rc_sta)
+{
+	int i;
+	for (i = rc_sta->rc_num_rate - 1; i >= 0; i--)
+		if (ssv6xxx_rate_supported(rc_sta, i))
+			return i;
+	return 0;
+}
+#endif
+static void rate_control_pid_adjust_rate(struct ssv_sta_rc_info *rc_sta,
+					 struct rc_pid_sta_info *spinfo,
+					 int adj, struct rc_pid_rateinfo *rinfo)
+{
+	int cur_sorted, new_sorted, probe, tmp, n_bitrates;
+	int cur = spinfo->txrate_idx;
+	n_bitrates = rc_sta->rc_num_rate;
+	cur_sorted = rinfo[cur].index;
+	new_sorted = cur_sorted + adj;
+	if (new_sorted < 0)
+		new_sorted = rinfo[0].index;
+	else if (new_sorted >= n_bitrates)
+		new_sorted = rinfo[n_bitrates - 1].index;
+	tmp = new_sorted;
+	if (adj < 0) {
+		for (probe = cur_sorted; probe >= new_sorted; probe--)
+			if (rinfo[probe].diff <= rinfo[cur_sorted].diff &&
+			    ssv6xxx_rate_supported(rc_sta, rinfo[probe].index))
+				tmp = probe;
+	} else {
+		for (probe = new_sorted + 1; probe < n_bitrates; probe++)
+			if (rinfo[probe].diff <= rinfo[new_sorted].diff &&
+			    ssv6xxx_rate_supported(rc_sta, rinfo[probe].index))
+				tmp = probe;
+	}
+	BUG_ON(tmp < 0 || tmp >= n_bitrates);
+	do {
+		if (ssv6xxx_rate_supported(rc_sta, rinfo[tmp].index)) {
+			spinfo->tmp_rate_idx = rinfo[tmp].index;
+			break;
+		}
+		if (adj < 0)
+			tmp--;
+		else
+			tmp++;
+	} while (tmp < n_bitrates && tmp >= 0);
+	spinfo->oldrate = spinfo->txrate_idx;
+	if (spinfo->tmp_rate_idx != spinfo->txrate_idx) {
+		spinfo->monitoring = 1;
+#ifdef RATE_CONTROL_PARAMETER_DEBUG
+		pr_debug("Trigger monitor tmp_rate_idx=[%d]\n",
+		       spinfo->tmp_rate_idx);
+#endif
+		spinfo->probe_cnt = MAXPROBES;
+	}
+}
+
+static void rate_control_pid_normalize(struct rc_pid_info *pinfo, int l)
+{
+	int i, norm_offset = RC_PID_NORM_OFFSET;
+	struct rc_pid_rateinfo *r = pinfo->rinfo;
+	if (r[0].diff > norm_offset)
+		r[0].diff -= norm_offset;
+	else if (r[0].diff < -norm_offset)
+		r[0].diff += norm_offset;
+	for (i = 0; i < l - 1; i++)
+		if (r[i + 1].diff > r[i].diff + norm_offset)
+			r[i + 1].diff -= norm_offset;
+		else if (r[i + 1].diff <= r[i].diff)
+			r[i + 1].diff += norm_offset;
+}
+
+#ifdef RATE_CONTROL_DEBUG
+unsigned int txrate_dlr = 0;
+#endif
+static void rate_control_pid_sample(struct ssv_rc_rate *rc_tbl,
+				    struct rc_pid_info *pinfo,
+				    struct ssv_sta_rc_info *rc_sta,
+				    struct rc_pid_sta_info *spinfo)
+{
+	struct rc_pid_rateinfo *rinfo = pinfo->rinfo;
+	u8 pf;
+	s32 err_avg;
+	s32 err_prop;
+	s32 err_int;
+	s32 err_der;
+	int adj, i, j, tmp;
+	struct ssv_rc_rate *rc_table;
+	unsigned int dlr;
+	unsigned int perfect_time = 0;
+	unsigned int this_thp, ewma_thp;
+	struct rc_pid_rateinfo *rate;
+	if (!spinfo->monitoring) {
+		if (spinfo->tx_num_xmit == 0)
+			return;
+		spinfo->last_sample = jiffies;
+		pf = spinfo->tx_num_failed * 100 / spinfo->tx_num_xmit;
+		if (pinfo->rinfo[spinfo->txrate_idx].this_attempt > 0) {
+			rate = &pinfo->rinfo[spinfo->txrate_idx];
+			rc_table = &rc_tbl[spinfo->txrate_idx];
+			dlr = 100 - rate->this_fail * 100 / rate->this_attempt;
+			perfect_time = rate->perfect_tx_time;
+			if (!perfect_time)
+				perfect_time = 1000000;
+			this_thp = dlr * (1000000 / perfect_time);
+			ewma_thp = rate->throughput;
+			if (ewma_thp == 0)
+				rate->throughput = this_thp;
+			else
+				rate->throughput = (ewma_thp + this_thp) >> 1;
+			rate->attempt += rate->this_attempt;
+			rate->success += rate->this_success;
+			rate->fail += rate->this_fail;
+			spinfo->tx_num_xmit = 0;
+			spinfo->tx_num_failed = 0;
+			rate->this_fail = 0;
+			rate->this_success = 0;
+			rate->this_attempt = 0;
+			if (pinfo->oldrate < 0
+			    || pinfo->oldrate >= rc_sta->rc_num_rate) {
+				WARN_ON(1);
+			}
+			if (spinfo->txrate_idx < 0
+			    || spinfo->txrate_idx >= rc_sta->rc_num_rate) {
+				WARN_ON(1);
+			}
+			if (pinfo->oldrate != spinfo->txrate_idx) {
+				i = rinfo[pinfo->oldrate].index;
+				j = rinfo[spinfo->txrate_idx].index;
+				tmp = (pf - spinfo->last_pf);
+				tmp =
+				    RC_PID_DO_ARITH_RIGHT_SHIFT(tmp,
+								rc_table->arith_shift);
+				rinfo[j].diff = rinfo[i].diff + tmp;
+				pinfo->oldrate = spinfo->txrate_idx;
+			}
+			rate_control_pid_normalize(pinfo, rc_sta->rc_num_rate);
+			err_prop =
+			    (rc_table->target_pf - pf) << rc_table->arith_shift;
+			err_avg = spinfo->err_avg_sc >> RC_PID_SMOOTHING_SHIFT;
+			spinfo->err_avg_sc =
+			    spinfo->err_avg_sc - err_avg + err_prop;
+			err_int = spinfo->err_avg_sc >> RC_PID_SMOOTHING_SHIFT;
+			err_der = pf - spinfo->last_pf;
+			spinfo->last_pf = pf;
+			spinfo->last_dlr = dlr;
+			spinfo->oldrate = spinfo->txrate_idx;
+			adj =
+			    (err_prop * RC_PID_COEFF_P +
+			     err_int * RC_PID_COEFF_I +
+			     err_der * RC_PID_COEFF_D);
+			adj =
+			    RC_PID_DO_ARITH_RIGHT_SHIFT(adj,
+							rc_table->arith_shift <<
+							1);
+			if (adj) {
+#ifdef RATE_CONTROL_PARAMETER_DEBUG
+				if ((spinfo->txrate_idx != 11)
+				    || ((spinfo->txrate_idx == 11)
+					&& (adj < 0)))
+					pr_debug
+					    ("[RC]Probe adjust[%d] dlr[%d%%] this_thp[%d] ewma_thp[%d] index[%d]\n",
+					     adj, dlr, this_thp, ewma_thp,
+					     spinfo->txrate_idx);
+#endif
+				rate_control_pid_adjust_rate(rc_sta, spinfo,
+							     adj, rinfo);
+			}
+		}
+	} else {
+		if ((spinfo->feedback_probes >= MAXPROBES)
+		    || (spinfo->feedback_probes && spinfo->probe_cnt)) {
+			rate = &pinfo->rinfo[spinfo->txrate_idx];
+			spinfo->last_sample = jiffies;
+			if (rate->this_attempt > 0) {
+				dlr =
+				    100 -
+				    rate->this_fail * 100 / rate->this_attempt;
+#ifdef RATE_CONTROL_DEBUG
+#ifdef PROBE
+				txrate_dlr = dlr;
+#endif
+#endif
+				spinfo->last_dlr = dlr;
+				perfect_time = rate->perfect_tx_time;
+				if (!perfect_time)
+					perfect_time = 1000000;
+				this_thp = dlr * (1000000 / perfect_time);
+				ewma_thp = rate->throughput;
+				if (ewma_thp == 0)
+					rate->throughput = this_thp;
+				else
+					rate->throughput =
+					    (ewma_thp + this_thp) >> 1;
+				rate->attempt += rate->this_attempt;
+				rate->success += rate->this_success;
+				rinfo[spinfo->txrate_idx].fail +=
+				    rate->this_fail;
+				rate->this_fail = 0;
+				rate->this_success = 0;
+				rate->this_attempt = 0;
+			} else {
+#ifdef RATE_CONTROL_DEBUG
+#ifdef PROBE
+				txrate_dlr = 0;
+#endif
+#endif
+			}
+			rate = &pinfo->rinfo[spinfo->tmp_rate_idx];
+			if (rate->this_attempt > 0) {
+				dlr =
+				    100 -
+				    ((rate->this_fail * 100) /
+				     rate->this_attempt);
+				{
+					perfect_time = rate->perfect_tx_time;
+					if (!perfect_time)
+						perfect_time = 1000000;
+					if (dlr)
+						this_thp =
+						    dlr * (1000000 /
+							   perfect_time);
+					else
+						this_thp = 0;
+					ewma_thp = rate->throughput;
+					if (ewma_thp == 0)
+						rate->throughput = this_thp;
+					else
+						rate->throughput =
+						    (ewma_thp + this_thp) >> 1;
+					if (rate->throughput >
+					    pinfo->rinfo[spinfo->
+							 txrate_idx].throughput)
+					{
+#ifdef RATE_CONTROL_PARAMETER_DEBUG
+						pr_debug
+						    ("[RC]UPDATE probe rate idx[%d] [%d][%d%%] Old idx[%d] [%d][%d%%] feedback[%d] \n",
+						     spinfo->tmp_rate_idx,
+						     rate->throughput, dlr,
+						     spinfo->txrate_idx,
+						     pinfo->
+						     rinfo
+						     [spinfo->txrate_idx].throughput,
+						     txrate_dlr,
+						     spinfo->feedback_probes);
+#endif
+						spinfo->txrate_idx =
+						    spinfo->tmp_rate_idx;
+					} else {
+#ifdef RATE_CONTROL_PARAMETER_DEBUG
+						pr_debug
+						    ("[RC]Fail probe rate idx[%d] [%d][%d%%] Old idx[%d] [%d][%d%%] feedback[%d] \n",
+						     spinfo->tmp_rate_idx,
+						     rate->throughput, dlr,
+						     spinfo->txrate_idx,
+						     pinfo->
+						     rinfo
+						     [spinfo->txrate_idx].throughput,
+						     txrate_dlr,
+						     spinfo->feedback_probes);
+#endif
+						;
+					}
+					rate->attempt += rate->this_attempt;
+					rate->success += rate->this_success;
+					rate->fail += rate->this_fail;
+					rate->this_fail = 0;
+					rate->this_success = 0;
+					rate->this_attempt = 0;
+					spinfo->oldrate = spinfo->txrate_idx;
+				}
+			}
+#ifdef RATE_CONTROL_DEBUG
+			else
+				pr_err("Unexpected error\n");
+#endif
+			spinfo->feedback_probes = 0;
+			spinfo->tx_num_xmit = 0;
+			spinfo->tx_num_failed = 0;
+			spinfo->monitoring = 0;
+#ifdef RATE_CONTROL_PARAMETER_DEBUG
+			pr_debug("Disable monitor\n");
+#endif
+			spinfo->probe_report_flag = 0;
+			spinfo->probe_wating_times = 0;
+		} else {
+			spinfo->probe_wating_times++;
+#ifdef RATE_CONTROL_DEBUG
+			if (spinfo->probe_wating_times > 3) {
+				pr_debug
+				    ("[RC]@@@@@ PROBE LOSE @@@@@ feedback=[%d] need=[%d] probe_cnt=[%d] wating times[%d]\n",
+				     spinfo->feedback_probes, MAXPROBES,
+				     spinfo->probe_cnt,
+				     spinfo->probe_wating_times);
+				spinfo->feedback_probes = 0;
+				spinfo->tx_num_xmit = 0;
+				spinfo->tx_num_failed = 0;
+				spinfo->monitoring = 0;
+				spinfo->probe_report_flag = 0;
+				spinfo->probe_wating_times = 0;
+			}
+#else
+			if (spinfo->probe_wating_times > 3) {
+				spinfo->feedback_probes = 0;
+				spinfo->tx_num_xmit = 0;
+				spinfo->tx_num_failed = 0;
+				spinfo->monitoring = 0;
+				spinfo->probe_report_flag = 0;
+				spinfo->probe_wating_times = 0;
+			}
+#endif
+		}
+	}
+}
+
+#ifdef RATE_CONTROL_PERCENTAGE_TRACE
+int percentage = 0;
+int percentageCounter = 0;
+#endif
+void ssv6xxx_pid_report_handler(struct ssv_sta_rc_info *rc_sta,
+				struct ssv_rc_report *report_data)
+{
+	struct ssv_rc_rate *rc_table = ssv_11bgn_rate_table;
+	struct rc_pid_info *pinfo;
+	struct rc_pid_sta_info *spinfo;
+	struct rc_pid_rateinfo *pidrate;
+	struct rc_pid_rateinfo *rate;
+	s32 report_data_index = 0;
+	unsigned long period;
+	pinfo = &rc_sta->pinfo;
+	spinfo = &rc_sta->spinfo;
+	pidrate = rc_sta->pinfo.rinfo;
+	if (report_data->h_event == SOC_EVT_RC_AMPDU_REPORT) {
+		period = msecs_to_jiffies(HT_RC_UPDATE_INTERVAL);
+		if (time_after(jiffies, spinfo->last_sample + period)) {
+			if (rc_sta->rc_num_rate == 12)
+				spinfo->txrate_idx = rc_sta->ht.max_tp_rate + 4;
+			else
+				spinfo->txrate_idx = rc_sta->ht.max_tp_rate;
+#ifdef RATE_CONTROL_DEBUG
+			pr_debug("MPDU rate update time txrate_idx[%d]!!\n",
+			       spinfo->txrate_idx);
+#endif
+			spinfo->last_sample = jiffies;
+		}
+		return;
+	} else if (report_data->h_event != SOC_EVT_RC_MPDU_REPORT) {
+		return;
+	}
+	if (report_data->rates[0].data_rate < 7) {
+		if (report_data->rates[0].data_rate > 3) {
+			report_data->rates[0].data_rate -= 3;
+		}
+	}
+	if (rc_table[rc_sta->pinfo.rinfo[spinfo->txrate_idx].
+		     rc_index].hw_rate_idx == report_data->rates[0].data_rate) {
+		report_data_index =
+		    rc_sta->pinfo.rinfo[spinfo->txrate_idx].index;
+	} else
+	    if (rc_table
+		[rc_sta->pinfo.rinfo[spinfo->tmp_rate_idx].
+		 rc_index].hw_rate_idx == report_data->rates[0].data_rate) {
+		report_data_index =
+		    rc_sta->pinfo.rinfo[spinfo->tmp_rate_idx].index;
+	}
+	if ((report_data_index != spinfo->tmp_rate_idx)
+	    && (report_data_index != spinfo->txrate_idx)) {
+#ifdef RATE_CONTROL_DEBUG
+		pr_debug("Rate control report mismatch report_rate_idx[%d] tmp_rate_idx[%d]rate[%d] txrate_idx[%d]rate[%d]!!\n",
+		     report_data->rates[0].data_rate, spinfo->tmp_rate_idx,
+		     rc_table[rc_sta->pinfo.
+				      rinfo[spinfo->tmp_rate_idx].rc_index].
+		     hw_rate_idx, spinfo->txrate_idx,
+		     rc_table[rc_sta->pinfo.
+				      rinfo[spinfo->txrate_idx].rc_index].
+		     hw_rate_idx);
+#endif
+		return;
+	}
+	if (report_data_index == spinfo->txrate_idx) {
+		spinfo->tx_num_xmit += report_data->rates[0].count;
+		spinfo->tx_num_failed +=
+		    (report_data->rates[0].count - report_data->ampdu_ack_len);
+		rate = &pidrate[spinfo->txrate_idx];
+		rate->this_fail +=
+		    (report_data->rates[0].count - report_data->ampdu_ack_len);
+		rate->this_attempt += report_data->rates[0].count;
+		rate->this_success += report_data->ampdu_ack_len;
+	}
+	if (report_data_index != spinfo->txrate_idx
+	    && report_data_index == spinfo->tmp_rate_idx) {
+		spinfo->feedback_probes += report_data->ampdu_len;
+		rate = &pidrate[spinfo->tmp_rate_idx];
+		rate->this_fail +=
+		    (report_data->rates[0].count - report_data->ampdu_ack_len);
+		rate->this_attempt += report_data->rates[0].count;
+		rate->this_success += report_data->ampdu_ack_len;
+	}
+	period = msecs_to_jiffies(RC_PID_INTERVAL);
+	if (time_after(jiffies, spinfo->last_sample + period)) {
+#ifdef RATE_CONTROL_PERCENTAGE_TRACE
+		rate = &pidrate[spinfo->txrate_idx];
+		if (rate->this_success > rate->this_attempt) {
+			pr_debug("this_success[%ld] this_attempt[%ld]\n",
+			       rate->this_success, rate->this_attempt);
+		} else {
+			if (percentage == 0)
+				percentage =
+				    (int)((rate->this_success * 100) /
+					  rate->this_attempt);
+			else
+				percentage =
+				    (percentage +
+				     (int)((rate->this_success * 100) /
+					   rate->this_attempt)) / 2;
+			pr_debug("Percentage[%d]\n", percentage);
+			if ((percentageCounter % 16) == 1)
+				percentage = 0;
+		}
+#endif
+#ifdef RATE_CONTROL_STUPID_DEBUG
+		if (spinfo->txrate_idx != spinfo->tmp_rate_idx) {
+			rate = &pidrate[spinfo->tmp_rate_idx];
+			if (spinfo->monitoring && ((rate->this_attempt == 0)
+						   || (rate->this_attempt !=
+						       MAXPROBES))) {
+				pr_debug("Probe result a[%ld]s[%ld]f[%ld]",
+				       rate->this_attempt, rate->this_success,
+				       rate->this_fail);
+			}
+			rate = &pidrate[spinfo->txrate_idx];
+			pr_debug("New a[%ld]s[%ld]f[%ld] \n", rate->this_attempt,
+			       rate->this_success, rate->this_fail);
+		} else {
+			rate = &pidrate[spinfo->txrate_idx];
+			pr_debug("New a[%ld]s[%ld]f[%ld] \n", rate->this_attempt,
+			       rate->this_success, rate->this_fail);
+		}
+		pr_debug("w[%d]x%03d-f%03d\n", rc_sta->rc_wsid,
+		       spinfo->tx_num_xmit, spinfo->tx_num_failed);
+#endif
+		rate_control_pid_sample(rc_table, pinfo, rc_sta, spinfo);
+	}
+}
+
+int pide_frame_duration(size_t len, int rate, int short_preamble, int flags)
+{
+	int dur = 0;
+	if (flags == WLAN_RC_PHY_CCK) {
+		dur = 10;
+		dur += short_preamble ? (72 + 24) : (144 + 48);
+		dur += DIV_ROUND_UP(8 * (len + 4) * 10, rate);
+	} else {
+		dur = 16;
+		dur += 16;
+		dur += 4;
+		dur += 4 * DIV_ROUND_UP((16 + 8 * (len + 4) + 6) * 10,
+					4 * rate);
+	}
+	return dur;
+}
+
+void ssv62xx_pid_rc_caps(struct ssv_sta_rc_info *rc_sta)
+{
+	struct rc_pid_sta_info *spinfo;
+	struct rc_pid_info *pinfo;
+	struct rc_pid_rateinfo *rinfo;
+	int i;
+	spinfo = &rc_sta->spinfo;
+	pinfo = &rc_sta->pinfo;
+	memset(spinfo, 0, sizeof(struct rc_pid_sta_info));
+	memset(pinfo, 0, sizeof(struct rc_pid_info));
+	rinfo = rc_sta->pinfo.rinfo;
+	for (i = 0; i < rc_sta->rc_num_rate; i++) {
+		rinfo[i].rc_index = ssv6xxx_rc_rate_set[rc_sta->rc_type][i + 1];
+		rinfo[i].diff = i * RC_PID_NORM_OFFSET;
+		rinfo[i].index = (u16) i;
+		rinfo[i].perfect_tx_time =
+		    TDIFS + (TSLOT * 15 >> 1) + pide_frame_duration(1530,
+								    ssv_11bgn_rate_table
+								    [rinfo
+								     [i].rc_index].rate_kbps
+								    / 100, 1,
+								    ssv_11bgn_rate_table
+								    [rinfo
+								     [i].rc_index].phy_type)
+		    + pide_frame_duration(10,
+					  ssv_11bgn_rate_table[rinfo[i].
+							       rc_index].rate_kbps
+					  / 100, 1,
+					  ssv_11bgn_rate_table[rinfo[i].
+							       rc_index].phy_type);
+		pr_debug("[RC]Init perfect_tx_time[%d][%d]\n", i,
+		       rinfo[i].perfect_tx_time);
+		rinfo[i].throughput = 0;
+	}
+	if (rc_sta->is_ht) {
+		if (ssv6xxx_rc_rate_set[rc_sta->ht_rc_type][0] == 12)
+			spinfo->txrate_idx = 4;
+		else
+			spinfo->txrate_idx = 0;
+	} else {
+		spinfo->txrate_idx = ssv6xxx_rate_lowest_index(rc_sta);
+#ifdef DISABLE_RATE_CONTROL_SAMPLE
+		spinfo->txrate_idx = ssv6xxx_rate_highest_index(rc_sta);
+#endif
+	}
+	spinfo->real_hw_index = 0;
+	spinfo->probe_cnt = MAXPROBES;
+	spinfo->tmp_rate_idx = spinfo->txrate_idx;
+	spinfo->oldrate = spinfo->txrate_idx;
+	spinfo->last_sample = jiffies;
+	spinfo->last_report = jiffies;
+}
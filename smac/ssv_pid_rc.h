@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2015 South Silicon Valley Microelectronics Inc.
+ * Copyright (c) 2015 iComm Corporation
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SSV_PID_RC_H_
+#define _SSV_PID_RC_H_
+#include "ssv_rc_common.h"
+#define RC_PID_REPORT_INTERVAL 40
+#ifndef RC_PID_INTERVAL
+#define RC_PID_INTERVAL 125
+#endif
+#define RC_PID_DO_ARITH_RIGHT_SHIFT(x,y) \
+ ((x) < 0 ? -((-(x)) >> (y)) : (x) >> (y))
+#define RC_PID_NORM_OFFSET 3
+#define RC_PID_SMOOTHING_SHIFT 1
+#define RC_PID_SMOOTHING (1 << RC_PID_SMOOTHING_SHIFT)
+#ifndef RC_PID_COEFF_P
+#define RC_PID_COEFF_P 15
+#endif
+#ifndef RC_PID_COEFF_I
+#define RC_PID_COEFF_I 15
+#endif
+#ifndef RC_PID_COEFF_D
+#define RC_PID_COEFF_D 5
+#endif
+#define MAXPROBES 3
+extern struct ssv_rc_rate ssv_11bgn_rate_table[RATE_TABLE_SIZE];
+extern const u16 ssv6xxx_rc_rate_set[RC_TYPE_MAX][13];
+int pide_frame_duration(size_t len, int rate, int short_preamble, int flags);
+void ssv62xx_pid_rc_caps(struct ssv_sta_rc_info *rc_sta);
+void ssv6xxx_pid_report_handler(struct ssv_sta_rc_info *rc_sta,
+				struct ssv_rc_report *report_data);
+#endif
@@ -20,916 +20,103 @@
 #include "ssv_ht_rc.h"
 #include "ssv_rc.h"
 #include "ssv_rc_common.h"
-static struct ssv_rc_rate ssv_11bgn_rate_table[] = {
-	[0] = {.rc_flags = RC_FLAG_LEGACY,
-	       .phy_type = WLAN_RC_PHY_CCK,
-	       .rate_kbps = 1000,
-	       .dot11_rate_idx = 0,
-	       .ctrl_rate_idx = 0,
-	       .hw_rate_idx = 0,
-	       .arith_shift = 8,
-	       .target_pf = 26,
-	       },
-	[1] = {.rc_flags = RC_FLAG_LEGACY,
-	       .phy_type = WLAN_RC_PHY_CCK,
-	       .rate_kbps = 2000,
-	       .dot11_rate_idx = 1,
-	       .ctrl_rate_idx = 1,
-	       .hw_rate_idx = 1,
-	       .arith_shift = 8,
-	       .target_pf = 26,
-	       },
-	[2] = {.rc_flags = RC_FLAG_LEGACY,
-	       .phy_type = WLAN_RC_PHY_CCK,
-	       .rate_kbps = 5500,
-	       .dot11_rate_idx = 2,
-	       .ctrl_rate_idx = 1,
-	       .hw_rate_idx = 2,
-	       .arith_shift = 8,
-	       .target_pf = 26,
-	       },
-	[3] = {.rc_flags = RC_FLAG_LEGACY,
-	       .phy_type = WLAN_RC_PHY_CCK,
-	       .rate_kbps = 11000,
-	       .dot11_rate_idx = 3,
-	       .ctrl_rate_idx = 1,
-	       .hw_rate_idx = 3,
-	       .arith_shift = 8,
-	       .target_pf = 26,
-	       },
-	[4] = {.rc_flags = RC_FLAG_LEGACY | RC_FLAG_SHORT_PREAMBLE,
-	       .phy_type = WLAN_RC_PHY_CCK,
-	       .rate_kbps = 2000,
-	       .dot11_rate_idx = 1,
-	       .ctrl_rate_idx = 4,
-	       .hw_rate_idx = 4,
-	       .arith_shift = 8,
-	       .target_pf = 26,
-	       },
-	[5] = {.rc_flags = RC_FLAG_LEGACY | RC_FLAG_SHORT_PREAMBLE,
-	       .phy_type = WLAN_RC_PHY_CCK,
-	       .rate_kbps = 5500,
-	       .dot11_rate_idx = 2,
-	       .ctrl_rate_idx = 4,
-	       .hw_rate_idx = 5,
-	       .arith_shift = 8,
-	       .target_pf = 26,
-	       },
-	[6] = {.rc_flags = RC_FLAG_LEGACY | RC_FLAG_SHORT_PREAMBLE,
-	       .phy_type = WLAN_RC_PHY_CCK,
-	       .rate_kbps = 11000,
-	       .dot11_rate_idx = 3,
-	       .ctrl_rate_idx = 4,
-	       .hw_rate_idx = 6,
-	       .arith_shift = 8,
-	       .target_pf = 26,
-	       },
-	[7] = {.rc_flags = RC_FLAG_LEGACY,
-	       .phy_type = WLAN_RC_PHY_OFDM,
-	       .rate_kbps = 6000,
-	       .dot11_rate_idx = 4,
-	       .ctrl_rate_idx = 7,
-	       .hw_rate_idx = 7,
-	       .arith_shift = 8,
-	       .target_pf = 26,
-	       },
-	[8] = {.rc_flags = RC_FLAG_LEGACY,
-	       .phy_type = WLAN_RC_PHY_OFDM,
-	       .rate_kbps = 9000,
-	       .dot11_rate_idx = 5,
-	       .ctrl_rate_idx = 7,
-	       .hw_rate_idx = 8,
-	       .arith_shift = 8,
-	       .target_pf = 26,
-	       },
-	[9] = {.rc_flags = RC_FLAG_LEGACY,
-	       .phy_type = WLAN_RC_PHY_OFDM,
-	       .rate_kbps = 12000,
-	       .dot11_rate_idx = 6,
-	       .ctrl_rate_idx = 9,
-	       .hw_rate_idx = 9,
-	       .arith_shift = 8,
-	       .target_pf = 26,
-	       },
-	[10] = {.rc_flags = RC_FLAG_LEGACY,
-		.phy_type = WLAN_RC_PHY_OFDM,
-		.rate_kbps = 18000,
-		.dot11_rate_idx = 7,
-		.ctrl_rate_idx = 9,
-		.hw_rate_idx = 10,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[11] = {.rc_flags = RC_FLAG_LEGACY,
-		.phy_type = WLAN_RC_PHY_OFDM,
-		.rate_kbps = 24000,
-		.dot11_rate_idx = 8,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 11,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[12] = {.rc_flags = RC_FLAG_LEGACY,
-		.phy_type = WLAN_RC_PHY_OFDM,
-		.rate_kbps = 36000,
-		.dot11_rate_idx = 9,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 12,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[13] = {.rc_flags = RC_FLAG_LEGACY,
-		.phy_type = WLAN_RC_PHY_OFDM,
-		.rate_kbps = 48000,
-		.dot11_rate_idx = 10,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 13,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[14] = {.rc_flags = RC_FLAG_LEGACY,
-		.phy_type = WLAN_RC_PHY_OFDM,
-		.rate_kbps = 54000,
-		.dot11_rate_idx = 11,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 14,
-		.arith_shift = 8,
-		.target_pf = 8},
-	[15] = {.rc_flags = RC_FLAG_HT,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
-		.rate_kbps = 6500,
-		.dot11_rate_idx = 0,
-		.ctrl_rate_idx = 7,
-		.hw_rate_idx = 15,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[16] = {.rc_flags = RC_FLAG_HT,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
-		.rate_kbps = 13000,
-		.dot11_rate_idx = 1,
-		.ctrl_rate_idx = 9,
-		.hw_rate_idx = 16,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[17] = {.rc_flags = RC_FLAG_HT,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
-		.rate_kbps = 19500,
-		.dot11_rate_idx = 2,
-		.ctrl_rate_idx = 9,
-		.hw_rate_idx = 17,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[18] = {.rc_flags = RC_FLAG_HT,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
-		.rate_kbps = 26000,
-		.dot11_rate_idx = 3,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 18,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[19] = {.rc_flags = RC_FLAG_HT,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
-		.rate_kbps = 39000,
-		.dot11_rate_idx = 4,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 19,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[20] = {.rc_flags = RC_FLAG_HT,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
-		.rate_kbps = 52000,
-		.dot11_rate_idx = 5,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 20,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[21] = {.rc_flags = RC_FLAG_HT,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
-		.rate_kbps = 58500,
-		.dot11_rate_idx = 6,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 21,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[22] = {.rc_flags = RC_FLAG_HT,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_LGI,
-		.rate_kbps = 65000,
-		.dot11_rate_idx = 7,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 22,
-		.arith_shift = 8,
-		.target_pf = 8},
-	[23] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
-		.rate_kbps = 7200,
-		.dot11_rate_idx = 0,
-		.ctrl_rate_idx = 7,
-		.hw_rate_idx = 23,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[24] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
-		.rate_kbps = 14400,
-		.dot11_rate_idx = 1,
-		.ctrl_rate_idx = 9,
-		.hw_rate_idx = 24,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[25] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
-		.rate_kbps = 21700,
-		.dot11_rate_idx = 2,
-		.ctrl_rate_idx = 9,
-		.hw_rate_idx = 25,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[26] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
-		.rate_kbps = 28900,
-		.dot11_rate_idx = 3,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 26,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[27] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
-		.rate_kbps = 43300,
-		.dot11_rate_idx = 4,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 27,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[28] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
-		.rate_kbps = 57800,
-		.dot11_rate_idx = 5,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 28,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[29] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
-		.rate_kbps = 65000,
-		.dot11_rate_idx = 6,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 29,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[30] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_SGI,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_SGI,
-		.rate_kbps = 72200,
-		.dot11_rate_idx = 7,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 30,
-		.arith_shift = 8,
-		.target_pf = 8},
-	[31] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
-		.rate_kbps = 6500,
-		.dot11_rate_idx = 0,
-		.ctrl_rate_idx = 7,
-		.hw_rate_idx = 31,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[32] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
-		.rate_kbps = 13000,
-		.dot11_rate_idx = 1,
-		.ctrl_rate_idx = 9,
-		.hw_rate_idx = 32,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[33] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
-		.rate_kbps = 19500,
-		.dot11_rate_idx = 2,
-		.ctrl_rate_idx = 9,
-		.hw_rate_idx = 33,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[34] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
-		.rate_kbps = 26000,
-		.dot11_rate_idx = 3,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 34,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[35] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
-		.rate_kbps = 39000,
-		.dot11_rate_idx = 4,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 35,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[36] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
-		.rate_kbps = 52000,
-		.dot11_rate_idx = 5,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 36,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[37] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
-		.rate_kbps = 58500,
-		.dot11_rate_idx = 6,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 37,
-		.arith_shift = 8,
-		.target_pf = 26,
-		},
-	[38] = {.rc_flags = RC_FLAG_HT | RC_FLAG_HT_GF,
-		.phy_type = WLAN_RC_PHY_HT_20_SS_GF,
-		.rate_kbps = 65000,
-		.dot11_rate_idx = 7,
-		.ctrl_rate_idx = 11,
-		.hw_rate_idx = 38,
-		.arith_shift = 8,
-		.target_pf = 8},
-};
-
-const u16 ssv6xxx_rc_rate_set[RC_TYPE_MAX][13] = {
-	[RC_TYPE_B_ONLY] = {4, 0, 1, 2, 3},
-	[RC_TYPE_LEGACY_GB] = {12, 0, 1, 2, 7, 8, 3, 9, 10, 11, 12, 13, 14},
-	[RC_TYPE_SGI_20] = {8, 23, 24, 25, 26, 27, 28, 29, 30},
-	[RC_TYPE_LGI_20] = {8, 15, 16, 17, 18, 19, 20, 21, 22},
-	[RC_TYPE_HT_SGI_20] = {8, 23, 24, 25, 26, 27, 28, 29, 30},
-	[RC_TYPE_HT_LGI_20] = {8, 15, 16, 17, 18, 19, 20, 21, 22},
-	[RC_TYPE_HT_GF] = {8, 31, 32, 33, 34, 35, 36, 37, 38},
-};
-
-static u32 ssv6xxx_rate_supported(struct ssv_sta_rc_info *rc_sta, u32 index)
-{
-	return (rc_sta->rc_supp_rates & BIT(index));
-}
-
-static u8 ssv6xxx_rate_lowest_index(struct ssv_sta_rc_info *rc_sta)
-{
-	int i;
-	for (i = 0; i < rc_sta->rc_num_rate; i++)
-		if (ssv6xxx_rate_supported(rc_sta, i))
-			return i;
-	return 0;
-}
-
-#ifdef DISABLE_RATE_CONTROL_SAMPLE
-static u8 ssv6xxx_rate_highest_index(struct ssv_sta_rc_info *rc_sta)
-{
-	int i;
-	for (i = rc_sta->rc_num_rate - 1; i >= 0; i--)
-		if (ssv6xxx_rate_supported(rc_sta, i))
-			return i;
-	return 0;
-}
-#endif
-static void rate_control_pid_adjust_rate(struct ssv_sta_rc_info *rc_sta,
-					 struct rc_pid_sta_info *spinfo,
-					 int adj, struct rc_pid_rateinfo *rinfo)
-{
-	int cur_sorted, new_sorted, probe, tmp, n_bitrates;
-	int cur = spinfo->txrate_idx;
-	n_bitrates = rc_sta->rc_num_rate;
-	cur_sorted = rinfo[cur].index;
-	new_sorted = cur_sorted + adj;
-	if (new_sorted < 0)
-		new_sorted = rinfo[0].index;
-	else if (new_sorted >= n_bitrates)
-		new_sorted = rinfo[n_bitrates - 1].index;
-	tmp = new_sorted;
-	if (adj < 0) {
-		for (probe = cur_sorted; probe >= new_sorted; probe--)
-			if (rinfo[probe].diff <= rinfo[cur_sorted].diff &&
-			    ssv6xxx_rate_supported(rc_sta, rinfo[probe].index))
-				tmp = probe;
-	} else {
-		for (probe = new_sorted + 1; probe < n_bitrates; probe++)
-			if (rinfo[probe].diff <= rinfo[new_sorted].diff &&
-			    ssv6xxx_rate_supported(rc_sta, rinfo[probe].index))
-				tmp = probe;
-	}
-	BUG_ON(tmp < 0 || tmp >= n_bitrates);
-	do {
-		if (ssv6xxx_rate_supported(rc_sta, rinfo[tmp].index)) {
-			spinfo->tmp_rate_idx = rinfo[tmp].index;
-			break;
-		}
-		if (adj < 0)
-			tmp--;
-		else
-			tmp++;
-	} while (tmp < n_bitrates && tmp >= 0);
-	spinfo->oldrate = spinfo->txrate_idx;
-	if (spinfo->tmp_rate_idx != spinfo->txrate_idx) {
-		spinfo->monitoring = 1;
-#ifdef RATE_CONTROL_PARAMETER_DEBUG
-		pr_debug("Trigger monitor tmp_rate_idx=[%d]\n",
-		       spinfo->tmp_rate_idx);
-#endif
-		spinfo->probe_cnt = MAXPROBES;
-	}
-}
-
-static void rate_control_pid_normalize(struct rc_pid_info *pinfo, int l)
-{
-	int i, norm_offset = RC_PID_NORM_OFFSET;
-	struct rc_pid_rateinfo *r = pinfo->rinfo;
-	if (r[0].diff > norm_offset)
-		r[0].diff -= norm_offset;
-	else if (r[0].diff < -norm_offset)
-		r[0].diff += norm_offset;
-	for (i = 0; i < l - 1; i++)
-		if (r[i + 1].diff > r[i].diff + norm_offset)
-			r[i + 1].diff -= norm_offset;
-		else if (r[i + 1].diff <= r[i].diff)
-			r[i + 1].diff += norm_offset;
-}
-
-#ifdef RATE_CONTROL_DEBUG
-unsigned int txrate_dlr = 0;
-#endif
-static void rate_control_pid_sample(struct ssv_rate_ctrl *ssv_rc,
-				    struct rc_pid_info *pinfo,
-				    struct ssv_sta_rc_info *rc_sta,
-				    struct rc_pid_sta_info *spinfo)
+#include <ssv_trace.h>
+static void ssv6xxx_legacy_report_handler(struct ssv_softc *sc,
+					  struct ssv_rc_report *report_data,
+					  struct ssv_sta_rc_info *rc_sta)
 {
-	struct rc_pid_rateinfo *rinfo = pinfo->rinfo;
-	u8 pf;
-	s32 err_avg;
-	s32 err_prop;
-	s32 err_int;
-	s32 err_der;
-	int adj, i, j, tmp;
-	struct ssv_rc_rate *rc_table;
-	unsigned int dlr;
-	unsigned int perfect_time = 0;
-	unsigned int this_thp, ewma_thp;
-	struct rc_pid_rateinfo *rate;
-	if (!spinfo->monitoring) {
-		if (spinfo->tx_num_xmit == 0)
-			return;
-		spinfo->last_sample = jiffies;
-		pf = spinfo->tx_num_failed * 100 / spinfo->tx_num_xmit;
-		if (pinfo->rinfo[spinfo->txrate_idx].this_attempt > 0) {
-			rate = &pinfo->rinfo[spinfo->txrate_idx];
-			rc_table = &ssv_rc->rc_table[spinfo->txrate_idx];
-			dlr = 100 - rate->this_fail * 100 / rate->this_attempt;
-			perfect_time = rate->perfect_tx_time;
-			if (!perfect_time)
-				perfect_time = 1000000;
-			this_thp = dlr * (1000000 / perfect_time);
-			ewma_thp = rate->throughput;
-			if (ewma_thp == 0)
-				rate->throughput = this_thp;
-			else
-				rate->throughput = (ewma_thp + this_thp) >> 1;
-			rate->attempt += rate->this_attempt;
-			rate->success += rate->this_success;
-			rate->fail += rate->this_fail;
-			spinfo->tx_num_xmit = 0;
-			spinfo->tx_num_failed = 0;
-			rate->this_fail = 0;
-			rate->this_success = 0;
-			rate->this_attempt = 0;
-			if (pinfo->oldrate < 0
-			    || pinfo->oldrate >= rc_sta->rc_num_rate) {
-				WARN_ON(1);
-			}
-			if (spinfo->txrate_idx < 0
-			    || spinfo->txrate_idx >= rc_sta->rc_num_rate) {
-				WARN_ON(1);
-			}
-			if (pinfo->oldrate != spinfo->txrate_idx) {
-				i = rinfo[pinfo->oldrate].index;
-				j = rinfo[spinfo->txrate_idx].index;
-				tmp = (pf - spinfo->last_pf);
-				tmp =
-				    RC_PID_DO_ARITH_RIGHT_SHIFT(tmp,
-								rc_table->arith_shift);
-				rinfo[j].diff = rinfo[i].diff + tmp;
-				pinfo->oldrate = spinfo->txrate_idx;
-			}
-			rate_control_pid_normalize(pinfo, rc_sta->rc_num_rate);
-			err_prop =
-			    (rc_table->target_pf - pf) << rc_table->arith_shift;
-			err_avg = spinfo->err_avg_sc >> RC_PID_SMOOTHING_SHIFT;
-			spinfo->err_avg_sc =
-			    spinfo->err_avg_sc - err_avg + err_prop;
-			err_int = spinfo->err_avg_sc >> RC_PID_SMOOTHING_SHIFT;
-			err_der = pf - spinfo->last_pf;
-			spinfo->last_pf = pf;
-			spinfo->last_dlr = dlr;
-			spinfo->oldrate = spinfo->txrate_idx;
-			adj =
-			    (err_prop * RC_PID_COEFF_P +
-			     err_int * RC_PID_COEFF_I +
-			     err_der * RC_PID_COEFF_D);
-			adj =
-			    RC_PID_DO_ARITH_RIGHT_SHIFT(adj,
-							rc_table->arith_shift <<
-							1);
-			if (adj) {
-#ifdef RATE_CONTROL_PARAMETER_DEBUG
-				if ((spinfo->txrate_idx != 11)
-				    || ((spinfo->txrate_idx == 11)
-					&& (adj < 0)))
-					pr_debug
-					    ("[RC]Probe adjust[%d] dlr[%d%%] this_thp[%d] ewma_thp[%d] index[%d]\n",
-					     adj, dlr, this_thp, ewma_thp,
-					     spinfo->txrate_idx);
-#endif
-				rate_control_pid_adjust_rate(rc_sta, spinfo,
-							     adj, rinfo);
-			}
-		}
-	} else {
-		if ((spinfo->feedback_probes >= MAXPROBES)
-		    || (spinfo->feedback_probes && spinfo->probe_cnt)) {
-			rate = &pinfo->rinfo[spinfo->txrate_idx];
-			spinfo->last_sample = jiffies;
-			if (rate->this_attempt > 0) {
-				dlr =
-				    100 -
-				    rate->this_fail * 100 / rate->this_attempt;
-#ifdef RATE_CONTROL_DEBUG
-#ifdef PROBE
-				txrate_dlr = dlr;
-#endif
-#endif
-				spinfo->last_dlr = dlr;
-				perfect_time = rate->perfect_tx_time;
-				if (!perfect_time)
-					perfect_time = 1000000;
-				this_thp = dlr * (1000000 / perfect_time);
-				ewma_thp = rate->throughput;
-				if (ewma_thp == 0)
-					rate->throughput = this_thp;
-				else
-					rate->throughput =
-					    (ewma_thp + this_thp) >> 1;
-				rate->attempt += rate->this_attempt;
-				rate->success += rate->this_success;
-				rinfo[spinfo->txrate_idx].fail +=
-				    rate->this_fail;
-				rate->this_fail = 0;
-				rate->this_success = 0;
-				rate->this_attempt = 0;
-			} else {
-#ifdef RATE_CONTROL_DEBUG
-#ifdef PROBE
-				txrate_dlr = 0;
-#endif
-#endif
-			}
-			rate = &pinfo->rinfo[spinfo->tmp_rate_idx];
-			if (rate->this_attempt > 0) {
-				dlr =
-				    100 -
-				    ((rate->this_fail * 100) /
-				     rate->this_attempt);
-				{
-					perfect_time = rate->perfect_tx_time;
-					if (!perfect_time)
-						perfect_time = 1000000;
-					if (dlr)
-						this_thp =
-						    dlr * (1000000 /
-							   perfect_time);
-					else
-						this_thp = 0;
-					ewma_thp = rate->throughput;
-					if (ewma_thp == 0)
-						rate->throughput = this_thp;
-					else
-						rate->throughput =
-						    (ewma_thp + this_thp) >> 1;
-					if (rate->throughput >
-					    pinfo->rinfo[spinfo->
-							 txrate_idx].throughput)
-					{
-#ifdef RATE_CONTROL_PARAMETER_DEBUG
-						pr_debug
-						    ("[RC]UPDATE probe rate idx[%d] [%d][%d%%] Old idx[%d] [%d][%d%%] feedback[%d] \n",
-						     spinfo->tmp_rate_idx,
-						     rate->throughput, dlr,
-						     spinfo->txrate_idx,
-						     pinfo->
-						     rinfo
-						     [spinfo->txrate_idx].throughput,
-						     txrate_dlr,
-						     spinfo->feedback_probes);
-#endif
-						spinfo->txrate_idx =
-						    spinfo->tmp_rate_idx;
-					} else {
-#ifdef RATE_CONTROL_PARAMETER_DEBUG
-						pr_debug
-						    ("[RC]Fail probe rate idx[%d] [%d][%d%%] Old idx[%d] [%d][%d%%] feedback[%d] \n",
-						     spinfo->tmp_rate_idx,
-						     rate->throughput, dlr,
-						     spinfo->txrate_idx,
-						     pinfo->
-						     rinfo
-						     [spinfo->txrate_idx].throughput,
-						     txrate_dlr,
-						     spinfo->feedback_probes);
-#endif
-						;
-					}
-					rate->attempt += rate->this_attempt;
-					rate->success += rate->this_success;
-					rate->fail += rate->this_fail;
-					rate->this_fail = 0;
-					rate->this_success = 0;
-					rate->this_attempt = 0;
-					spinfo->oldrate = spinfo->txrate_idx;
-				}
-			}
-#ifdef RATE_CONTROL_DEBUG
-			else
-				pr_err("Unexpected error\n");
-#endif
-			spinfo->feedback_probes = 0;
-			spinfo->tx_num_xmit = 0;
-			spinfo->tx_num_failed = 0;
-			spinfo->monitoring = 0;
-#ifdef RATE_CONTROL_PARAMETER_DEBUG
-			pr_debug("Disable monitor\n");
-#endif
-			spinfo->probe_report_flag = 0;
-			spinfo->probe_wating_times = 0;
-		} else {
-			spinfo->probe_wating_times++;
-#ifdef RATE_CONTROL_DEBUG
-			if (spinfo->probe_wating_times > 3) {
-				pr_debug
-				    ("[RC]@@@@@ PROBE LOSE @@@@@ feedback=[%d] need=[%d] probe_cnt=[%d] wating times[%d]\n",
-				     spinfo->feedback_probes, MAXPROBES,
-				     spinfo->probe_cnt,
-				     spinfo->probe_wating_times);
-				spinfo->feedback_probes = 0;
-				spinfo->tx_num_xmit = 0;
-				spinfo->tx_num_failed = 0;
-				spinfo->monitoring = 0;
-				spinfo->probe_report_flag = 0;
-				spinfo->probe_wating_times = 0;
-			}
-#else
-			if (spinfo->probe_wating_times > 3) {
-				spinfo->feedback_probes = 0;
-				spinfo->tx_num_xmit = 0;
-				spinfo->tx_num_failed = 0;
-				spinfo->monitoring = 0;
-				spinfo->probe_report_flag = 0;
-				spinfo->probe_wating_times = 0;
-			}
-#endif
-		}
-	}
-}
-
-#ifdef RATE_CONTROL_PERCENTAGE_TRACE
-int percentage = 0;
-int percentageCounter = 0;
-#endif
-void ssv6xxx_legacy_report_handler(struct ssv_softc *sc, struct sk_buff *skb,
-				   struct ssv_sta_rc_info *rc_sta)
-{
-	struct ssv_rate_ctrl *ssv_rc = sc->rc;
-	struct cfg_host_event *host_event;
-	struct firmware_rate_control_report_data *report_data;
-	struct rc_pid_info *pinfo;
-	struct rc_pid_sta_info *spinfo;
-	struct rc_pid_rateinfo *pidrate;
-	struct rc_pid_rateinfo *rate;
-	s32 report_data_index = 0;
-	unsigned long period;
-	host_event = (struct cfg_host_event *)skb->data;
-	report_data =
-	    (struct firmware_rate_control_report_data *)&host_event->dat[0];
 	if ((report_data->wsid != (-1))
 	    && sc->sta_info[report_data->wsid].sta == NULL) {
 		dev_warn(sc->dev, "RC report has no valid STA.(%d)\n",
 			 report_data->wsid);
 		return;
 	}
-	pinfo = &rc_sta->pinfo;
-	spinfo = &rc_sta->spinfo;
-	pidrate = rc_sta->pinfo.rinfo;
-	if (host_event->h_event == SOC_EVT_RC_AMPDU_REPORT) {
-		period = msecs_to_jiffies(HT_RC_UPDATE_INTERVAL);
-		if (time_after(jiffies, spinfo->last_sample + period)) {
-			if (rc_sta->rc_num_rate == 12)
-				spinfo->txrate_idx = rc_sta->ht.max_tp_rate + 4;
-			else
-				spinfo->txrate_idx = rc_sta->ht.max_tp_rate;
-#ifdef RATE_CONTROL_DEBUG
-			pr_debug("MPDU rate update time txrate_idx[%d]!!\n",
-			       spinfo->txrate_idx);
-#endif
-			spinfo->last_sample = jiffies;
-		}
-		return;
-	} else if (host_event->h_event == SOC_EVT_RC_MPDU_REPORT) {
-		;
-	} else {
+	if ((report_data->h_event != SOC_EVT_RC_AMPDU_REPORT)
+	    && (report_data->h_event != SOC_EVT_RC_MPDU_REPORT)) {
 		dev_warn(sc->dev, "RC report handler got garbage\n");
 		return;
 	}
-	if (report_data->rates[0].data_rate < 7) {
-		if (report_data->rates[0].data_rate > 3) {
-			report_data->rates[0].data_rate -= 3;
-		}
-	}
-	if (ssv_rc->
-	    rc_table[rc_sta->pinfo.rinfo[spinfo->txrate_idx].
-		     rc_index].hw_rate_idx == report_data->rates[0].data_rate) {
-		report_data_index =
-		    rc_sta->pinfo.rinfo[spinfo->txrate_idx].index;
-	} else
-	    if (ssv_rc->rc_table
-		[rc_sta->pinfo.rinfo[spinfo->tmp_rate_idx].
-		 rc_index].hw_rate_idx == report_data->rates[0].data_rate) {
-		report_data_index =
-		    rc_sta->pinfo.rinfo[spinfo->tmp_rate_idx].index;
-	}
-	if ((report_data_index != spinfo->tmp_rate_idx)
-	    && (report_data_index != spinfo->txrate_idx)) {
+	ssv6xxx_pid_report_handler(rc_sta, report_data);
+}
+
+/*
+ * RC reports go through a single-producer single-consumer ring of
+ * compact records. The RX task fills it from firmware MPDU reports and
+ * BA/no-BA events and frees each event skb at once; the RX task drains
+ * it in batches after each pass over its queue. Head and tail are only
+ * written by their own side, so no lock is needed.
+ */
+bool ssv6xxx_rc_report_put(struct ssv_softc *sc, u8 h_event,
+			   const struct firmware_rate_control_report_data
+			   *report_data)
+{
+	struct ssv_rc_report *report;
+	u32 head = sc->rc_report_head;
+	if (head - smp_load_acquire(&sc->rc_report_tail) >=
+	    SSV_RC_REPORT_RING_SIZE) {
+		sc->rc_report_drop++;
+		return false;
+	}
+	report = &sc->rc_report_ring[head & (SSV_RC_REPORT_RING_SIZE - 1)];
+	report->h_event = h_event;
+	report->wsid = report_data->wsid;
+	report->ampdu_len = report_data->ampdu_len;
+	report->ampdu_ack_len = report_data->ampdu_ack_len;
+	memcpy(report->rates, report_data->rates, sizeof(report->rates));
+	smp_store_release(&sc->rc_report_head, head + 1);
+	return true;
+}
+
+static struct ssv_sta_rc_info *ssv6xxx_rc_report_sta(struct ssv_softc *sc,
+						     u8 hw_wsid)
+{
+	struct ssv_rate_ctrl *ssv_rc = sc->rc;
+	struct ssv_sta_info *ssv_sta;
+	struct ssv_sta_priv_data *ssv_sta_priv;
+	struct ssv_sta_rc_info *rc_sta;
+	if (hw_wsid >= SSV_NUM_STA) {
 #ifdef RATE_CONTROL_DEBUG
-		dev_dbg
-		    (sc->dev, "Rate control report mismatch report_rate_idx[%d] tmp_rate_idx[%d]rate[%d] txrate_idx[%d]rate[%d]!!\n",
-		     report_data->rates[0].data_rate, spinfo->tmp_rate_idx,
-		     ssv_rc->rc_table[rc_sta->pinfo.
-				      rinfo[spinfo->tmp_rate_idx].rc_index].
-		     hw_rate_idx, spinfo->txrate_idx,
-		     ssv_rc->rc_table[rc_sta->pinfo.
-				      rinfo[spinfo->txrate_idx].rc_index].
-		     hw_rate_idx);
+		dev_dbg(sc->dev, "[RC]rc_sta is NULL pointer Check-0!!\n");
 #endif
-		return;
-	}
-	if (report_data_index == spinfo->txrate_idx) {
-		spinfo->tx_num_xmit += report_data->rates[0].count;
-		spinfo->tx_num_failed +=
-		    (report_data->rates[0].count - report_data->ampdu_ack_len);
-		rate = &pidrate[spinfo->txrate_idx];
-		rate->this_fail +=
-		    (report_data->rates[0].count - report_data->ampdu_ack_len);
-		rate->this_attempt += report_data->rates[0].count;
-		rate->this_success += report_data->ampdu_ack_len;
+		return NULL;
 	}
-	if (report_data_index != spinfo->txrate_idx
-	    && report_data_index == spinfo->tmp_rate_idx) {
-		spinfo->feedback_probes += report_data->ampdu_len;
-		rate = &pidrate[spinfo->tmp_rate_idx];
-		rate->this_fail +=
-		    (report_data->rates[0].count - report_data->ampdu_ack_len);
-		rate->this_attempt += report_data->rates[0].count;
-		rate->this_success += report_data->ampdu_ack_len;
+	ssv_sta = &sc->sta_info[hw_wsid];
+	if (ssv_sta->sta == NULL) {
+		dev_err(sc->dev, "Null STA %d for RC report.\n", hw_wsid);
+		return NULL;
 	}
-	period = msecs_to_jiffies(RC_PID_INTERVAL);
-	if (time_after(jiffies, spinfo->last_sample + period)) {
-#ifdef RATE_CONTROL_PERCENTAGE_TRACE
-		rate = &pidrate[spinfo->txrate_idx];
-		if (rate->this_success > rate->this_attempt) {
-			dev_dbg(sc->dev, "this_success[%ld] this_attempt[%ld]\n",
-			       rate->this_success, rate->this_attempt);
-		} else {
-			if (percentage == 0)
-				percentage =
-				    (int)((rate->this_success * 100) /
-					  rate->this_attempt);
-			else
-				percentage =
-				    (percentage +
-				     (int)((rate->this_success * 100) /
-					   rate->this_attempt)) / 2;
-			deb_dbg(sc->dev, "Percentage[%d]\n", percentage);
-			if ((percentageCounter % 16) == 1)
-				percentage = 0;
-		}
-#endif
-#ifdef RATE_CONTROL_STUPID_DEBUG
-		if (spinfo->txrate_idx != spinfo->tmp_rate_idx) {
-			rate = &pidrate[spinfo->tmp_rate_idx];
-			if (spinfo->monitoring && ((rate->this_attempt == 0)
-						   || (rate->this_attempt !=
-						       MAXPROBES))) {
-				dev_dbg(sc->dev, "Probe result a[%ld]s[%ld]f[%ld]",
-				       rate->this_attempt, rate->this_success,
-				       rate->this_fail);
-			}
-			rate = &pidrate[spinfo->txrate_idx];
-			dev_dbg(sc->dev, "New a[%ld]s[%ld]f[%ld] \n", rate->this_attempt,
-			       rate->this_success, rate->this_fail);
-		} else {
-			rate = &pidrate[spinfo->txrate_idx];
-			dev_dbg(sc->dev, "New a[%ld]s[%ld]f[%ld] \n", rate->this_attempt,
-			       rate->this_success, rate->this_fail);
-		}
-		dev_dbg(sc->dev, "w[%d]x%03d-f%03d\n", rc_sta->rc_wsid,
-		       spinfo->tx_num_xmit, spinfo->tx_num_failed);
-#endif
-		rate_control_pid_sample(sc->rc, pinfo, rc_sta, spinfo);
+	ssv_sta_priv = (struct ssv_sta_priv_data *)ssv_sta->sta->drv_priv;
+	rc_sta = &ssv_rc->sta_rc_info[ssv_sta_priv->rc_idx];
+	if (rc_sta->rc_wsid != hw_wsid) {
+		dev_err(sc->dev, "[RC]rc_sta is NULL pointer Check-1!!\n");
+		return NULL;
 	}
+	return rc_sta;
 }
 
-void ssv6xxx_sample_work(struct work_struct *work)
+void ssv6xxx_rc_report_drain(struct ssv_softc *sc)
 {
-	struct ssv_softc *sc =
-	    container_of(work, struct ssv_softc, rc_sample_work);
-	struct ssv_rate_ctrl *ssv_rc = sc->rc;
-	struct sk_buff *skb;
-	struct cfg_host_event *host_event;
-	struct ssv_sta_rc_info *rc_sta = NULL;
-	struct firmware_rate_control_report_data *report_data;
-	struct ssv_sta_info *ssv_sta;
-	u8 hw_wsid = 0;
-	sc->rc_sample_sechedule = 1;
-	while (1) {
-		skb = skb_dequeue(&sc->rc_report_queue);
-		if (skb == NULL)
-			break;
-#ifdef DISABLE_RATE_CONTROL_SAMPLE
-		{
-			dev_kfree_skb_any(skb);
-			continue;
-		}
-#endif
-		host_event = (struct cfg_host_event *)skb->data;
-		if ((host_event->h_event == SOC_EVT_RC_AMPDU_REPORT)
-		    || (host_event->h_event == SOC_EVT_RC_MPDU_REPORT)) {
-			report_data =
-			    (struct firmware_rate_control_report_data *)
-			    &host_event->dat[0];
-			hw_wsid = report_data->wsid;
-		} else {
-			dev_warn(sc->dev, "rate control sampling got garbage\n");
-			dev_kfree_skb_any(skb);
-			continue;
-		}
-		if (hw_wsid >= SSV_RC_MAX_HARDWARE_SUPPORT) {
-#ifdef RATE_CONTROL_DEBUG
-			dev_dbg(sc->dev, "[RC]rc_sta is NULL pointer Check-0!!\n");
-#endif
-			dev_kfree_skb_any(skb);
-			continue;
-		}
-		ssv_sta = &sc->sta_info[hw_wsid];
-		if (ssv_sta->sta == NULL) {
-			dev_err(sc->dev, "Null STA %d for RC report.\n",
-				hw_wsid);
-			rc_sta = NULL;
-		} else {
-			struct ssv_sta_priv_data *ssv_sta_priv =
-			    (struct ssv_sta_priv_data *)ssv_sta->sta->drv_priv;
-			rc_sta = &ssv_rc->sta_rc_info[ssv_sta_priv->rc_idx];
-			if (rc_sta->rc_wsid != hw_wsid) {
-				rc_sta = NULL;
-			}
-		}
-		if (rc_sta == NULL) {
-			dev_err(sc->dev,
-				"[RC]rc_sta is NULL pointer Check-1!!\n");
-			dev_kfree_skb_any(skb);
+	struct ssv_rc_report *report;
+	struct ssv_sta_rc_info *rc_sta;
+	u32 tail = sc->rc_report_tail;
+	u32 head = smp_load_acquire(&sc->rc_report_head);
+	for (; tail != head; tail++) {
+		if (sc->rc == NULL)
 			continue;
-		}
-		if (rc_sta == NULL) {
-#ifdef RATE_CONTROL_DEBUG
-			dev_dbg(sc->dev, "[RC]rc_sta is NULL pointer Check-2!!\n");
+#ifdef DISABLE_RATE_CONTROL_SAMPLE
+		continue;
 #endif
-			dev_kfree_skb_any(skb);
+		report =
+		    &sc->rc_report_ring[tail & (SSV_RC_REPORT_RING_SIZE - 1)];
+		rc_sta = ssv6xxx_rc_report_sta(sc, report->wsid);
+		if (rc_sta == NULL)
 			continue;
-		}
-		if (rc_sta->is_ht) {
-			ssv6xxx_legacy_report_handler(sc, skb, rc_sta);
-			ssv6xxx_ht_report_handler(sc, skb, rc_sta);
-		} else
-			ssv6xxx_legacy_report_handler(sc, skb, rc_sta);
-		dev_kfree_skb_any(skb);
+		trace_ssv6xxx_rc_report(report);
+		ssv6xxx_legacy_report_handler(sc, report, rc_sta);
+		if (rc_sta->is_ht)
+			ssv6xxx_ht_report_handler(report, rc_sta);
 	}
-	sc->rc_sample_sechedule = 0;
+	smp_store_release(&sc->rc_report_tail, tail);
 }
 
 static void ssv6xxx_tx_status(void *priv,
@@ -1057,6 +244,143 @@ static void rateControlGetRate(u8 rateIndex, char *pointer)
 	};
 }
 
+static void minstrel_ht_set_rate(struct ssv62xx_ht *mi,
+				 struct fw_rc_retry_params *rate, int index,
+				 bool sample, bool rtscts,
+				 struct ssv_sta_rc_info *rc_sta,
+				 struct ssv_rate_ctrl *ssv_rc)
+{
+	struct minstrel_rate_stats *mr;
+	mr = &mi->groups.rates[index % MCS_GROUP_RATES];
+	rate->drate = ssv_rc->rc_table[mr->rc_index].hw_rate_idx;
+	rate->crate = ssv_rc->rc_table[mr->rc_index].ctrl_rate_idx;
+}
+
+static void _fill_txinfo_rates(struct ssv_rate_ctrl *ssv_rc,
+			       struct sk_buff *skb,
+			       struct fw_rc_retry_params *ar)
+{
+	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+	info->control.rates[0].idx =
+	    ssv_rc->rc_table[ar[0].drate].dot11_rate_idx;
+	info->control.rates[0].count = 1;
+	info->control.rates[SSV_DRATE_IDX].count = ar[0].drate;
+	info->control.rates[SSV_CRATE_IDX].count = ar[0].crate;
+}
+
+s32 ssv62xx_ht_rate_update(struct sk_buff *skb, struct ssv_softc *sc,
+			   struct fw_rc_retry_params *ar)
+{
+	struct ssv_rate_ctrl *ssv_rc = sc->rc;
+	struct SKB_info_st *skb_info = (struct SKB_info_st *)skb->head;
+	struct ieee80211_sta *sta = skb_info->sta;
+	struct ssv62xx_ht *mi = NULL;
+	int sample_idx;
+	bool sample = false;
+	struct ssv_sta_rc_info *rc_sta;
+	struct ssv_sta_priv_data *sta_priv;
+	struct rc_pid_sta_info *spinfo;
+	int ret = 0;
+	if (sc->sc_flags & SC_OP_FIXED_RATE) {
+		ar[0].count = 3;
+		ar[0].drate = ssv_rc->rc_table[sc->max_rate_idx].hw_rate_idx;
+		ar[0].crate = ssv_rc->rc_table[sc->max_rate_idx].ctrl_rate_idx;
+		ar[1].count = 2;
+		ar[1].drate = ssv_rc->rc_table[sc->max_rate_idx].hw_rate_idx;
+		ar[1].crate = ssv_rc->rc_table[sc->max_rate_idx].ctrl_rate_idx;
+		ar[2].count = 2;
+		ar[2].drate = ssv_rc->rc_table[sc->max_rate_idx].hw_rate_idx;
+		ar[2].crate = ssv_rc->rc_table[sc->max_rate_idx].ctrl_rate_idx;
+		_fill_txinfo_rates(ssv_rc, skb, ar);
+		return ssv_rc->rc_table[sc->max_rate_idx].hw_rate_idx;
+	}
+	if (sta == NULL) {
+		dev_err(sc->dev, "Station NULL\n");
+		BUG_ON(1);
+	}
+	sta_priv = (struct ssv_sta_priv_data *)sta->drv_priv;
+	rc_sta = &ssv_rc->sta_rc_info[sta_priv->rc_idx];
+	spinfo = &rc_sta->spinfo;
+	if (!ssv6xxx_rc_sta_reported(rc_sta)) {
+		struct ssv_sta_priv_data *ssv_sta_priv;
+		int rateidx = 99;
+		ssv_sta_priv = (struct ssv_sta_priv_data *)sta->drv_priv;
+		{
+			if ((rc_sta->ht_rc_type >= RC_TYPE_HT_SGI_20) &&
+			    (ssv_sta_priv->rx_data_rate <
+			     SSV62XX_RATE_MCS_INDEX)) {
+				if (ssv6xxx_rc_rate_set[rc_sta->ht_rc_type][0]
+				    == 12)
+					rateidx =
+					    (int)rc_sta->pinfo.rinfo[4].
+					    rc_index;
+				else
+					rateidx =
+					    (int)rc_sta->pinfo.rinfo[0].
+					    rc_index;
+			} else {
+				rateidx = (int)ssv_sta_priv->rx_data_rate;
+				rateidx -= SSV62XX_RATE_MCS_INDEX;
+				rateidx %= 8;
+				if (rc_sta->ht_rc_type == RC_TYPE_HT_SGI_20)
+					rateidx += SSV62XX_RATE_MCS_SGI_INDEX;
+				else if (rc_sta->ht_rc_type ==
+					 RC_TYPE_HT_LGI_20)
+					rateidx += SSV62XX_RATE_MCS_LGI_INDEX;
+				else
+					rateidx +=
+					    SSV62XX_RATE_MCS_GREENFIELD_INDEX;
+			}
+		}
+		ar[0].count = 3;
+		ar[2].drate = ar[1].drate = ar[0].drate =
+		    ssv_rc->rc_table[rateidx].hw_rate_idx;
+		ar[2].crate = ar[1].crate = ar[0].crate =
+		    ssv_rc->rc_table[rateidx].ctrl_rate_idx;
+		ar[1].count = 2;
+		ar[2].count = 2;
+		_fill_txinfo_rates(ssv_rc, skb, ar);
+		return rateidx;
+	}
+	mi = &rc_sta->ht;
+	sample_idx = ssv62xx_ht_get_sample_rate(mi, rc_sta);
+	if (sample_idx >= 0) {
+		sample = true;
+		minstrel_ht_set_rate(mi, &ar[0], sample_idx,
+				     true, false, rc_sta, ssv_rc);
+	} else {
+		minstrel_ht_set_rate(mi, &ar[0], mi->max_tp_rate,
+				     false, false, rc_sta, ssv_rc);
+	}
+	ar[0].count = mi->first_try_count;
+	ret = ar[0].drate;
+	{
+		if (sample_idx >= 0)
+			minstrel_ht_set_rate(mi, &ar[1], mi->max_tp_rate,
+					     false, false, rc_sta, ssv_rc);
+		else
+			minstrel_ht_set_rate(mi, &ar[1], mi->max_tp_rate2,
+					     false, true, rc_sta, ssv_rc);
+		ar[1].count = mi->second_try_count;
+		if (ret > ar[1].drate)
+			ret = ar[1].drate;
+		minstrel_ht_set_rate(mi, &ar[2], mi->max_prob_rate,
+				     false, !sample, rc_sta, ssv_rc);
+		ar[2].count = mi->other_try_count;
+		if (ret > ar[2].drate)
+			ret = ar[2].drate;
+	}
+	mi->total_packets++;
+	if (mi->total_packets == ~0) {
+		mi->total_packets = 0;
+		mi->sample_packets = 0;
+	}
+	if (spinfo->real_hw_index < SSV62XX_RATE_MCS_INDEX)
+		return spinfo->real_hw_index;
+	_fill_txinfo_rates(ssv_rc, skb, ar);
+	return ret;
+}
+
 static void ssv6xxx_get_rate(void *priv, struct ieee80211_sta *sta,
 			     void *priv_sta,
 			     struct ieee80211_tx_rate_control *txrc)
@@ -1118,9 +442,7 @@ static void ssv6xxx_get_rate(void *priv, struct ieee80211_sta *sta,
 			if (rc_sta->rc_valid == false) {
 				rateidx = 0;
 			} else {
-				if ((rc_sta->rc_wsid >=
-				     SSV_RC_MAX_HARDWARE_SUPPORT)
-				    || (rc_sta->rc_wsid < 0)) {
+				if (!ssv6xxx_rc_sta_reported(rc_sta)) {
 					ssv_sta_priv =
 					    (struct ssv_sta_priv_data *)
 					    sta->drv_priv;
@@ -1207,76 +529,6 @@ static void ssv6xxx_get_rate(void *priv, struct ieee80211_sta *sta,
 	rates[SSV_CRATE_IDX].count = rc_rate->hw_rate_idx;
 }
 
-int pide_frame_duration(size_t len, int rate, int short_preamble, int flags)
-{
-	int dur = 0;
-	if (flags == WLAN_RC_PHY_CCK) {
-		dur = 10;
-		dur += short_preamble ? (72 + 24) : (144 + 48);
-		dur += DIV_ROUND_UP(8 * (len + 4) * 10, rate);
-	} else {
-		dur = 16;
-		dur += 16;
-		dur += 4;
-		dur += 4 * DIV_ROUND_UP((16 + 8 * (len + 4) + 6) * 10,
-					4 * rate);
-	}
-	return dur;
-}
-
-static void ssv62xx_rc_caps(struct ssv_sta_rc_info *rc_sta)
-{
-	struct rc_pid_sta_info *spinfo;
-	struct rc_pid_info *pinfo;
-	struct rc_pid_rateinfo *rinfo;
-	int i;
-	spinfo = &rc_sta->spinfo;
-	pinfo = &rc_sta->pinfo;
-	memset(spinfo, 0, sizeof(struct rc_pid_sta_info));
-	memset(pinfo, 0, sizeof(struct rc_pid_info));
-	rinfo = rc_sta->pinfo.rinfo;
-	for (i = 0; i < rc_sta->rc_num_rate; i++) {
-		rinfo[i].rc_index = ssv6xxx_rc_rate_set[rc_sta->rc_type][i + 1];
-		rinfo[i].diff = i * RC_PID_NORM_OFFSET;
-		rinfo[i].index = (u16) i;
-		rinfo[i].perfect_tx_time =
-		    TDIFS + (TSLOT * 15 >> 1) + pide_frame_duration(1530,
-								    ssv_11bgn_rate_table
-								    [rinfo
-								     [i].rc_index].rate_kbps
-								    / 100, 1,
-								    ssv_11bgn_rate_table
-								    [rinfo
-								     [i].rc_index].phy_type)
-		    + pide_frame_duration(10,
-					  ssv_11bgn_rate_table[rinfo[i].
-							       rc_index].rate_kbps
-					  / 100, 1,
-					  ssv_11bgn_rate_table[rinfo[i].
-							       rc_index].phy_type);
-		pr_debug("[RC]Init perfect_tx_time[%d][%d]\n", i,
-		       rinfo[i].perfect_tx_time);
-		rinfo[i].throughput = 0;
-	}
-	if (rc_sta->is_ht) {
-		if (ssv6xxx_rc_rate_set[rc_sta->ht_rc_type][0] == 12)
-			spinfo->txrate_idx = 4;
-		else
-			spinfo->txrate_idx = 0;
-	} else {
-		spinfo->txrate_idx = ssv6xxx_rate_lowest_index(rc_sta);
-#ifdef DISABLE_RATE_CONTROL_SAMPLE
-		spinfo->txrate_idx = ssv6xxx_rate_highest_index(rc_sta);
-#endif
-	}
-	spinfo->real_hw_index = 0;
-	spinfo->probe_cnt = MAXPROBES;
-	spinfo->tmp_rate_idx = spinfo->txrate_idx;
-	spinfo->oldrate = spinfo->txrate_idx;
-	spinfo->last_sample = jiffies;
-	spinfo->last_report = jiffies;
-}
-
 static void ssv6xxx_rate_update_rc_type(void *priv,
 					struct ieee80211_supported_band *sband,
 					struct ieee80211_sta *sta,
@@ -1369,7 +621,7 @@ static void ssv6xxx_rate_update_rc_type(void *priv,
 		else if (rc_sta->rc_type == RC_TYPE_B_ONLY)
 			rc_sta->rc_supp_rates =
 			    sta->supp_rates[sband->band] & 0xfL;
-		ssv62xx_rc_caps(rc_sta);
+		ssv62xx_pid_rc_caps(rc_sta);
 	}
 }
 
@@ -1444,10 +696,10 @@ static void *ssv6xxx_rate_alloc(struct ieee80211_hw *hw,
 	memset(sc->rc, 0, sizeof(struct ssv_rate_ctrl));
 	ssv_rc = (struct ssv_rate_ctrl *)sc->rc;
 	ssv_rc->rc_table = ssv_11bgn_rate_table;
-	skb_queue_head_init(&sc->rc_report_queue);
-	INIT_WORK(&sc->rc_sample_work, ssv6xxx_sample_work);
-	sc->rc_sample_workqueue = create_workqueue("ssv6xxx_rc_sample");
-	sc->rc_sample_sechedule = 0;
+	ssv6xxx_rate_txtime_init(ssv_rc->txtime, ssv_rc->rc_table,
+				 ARRAY_SIZE(ssv_11bgn_rate_table));
+	sc->rc_report_head = 0;
+	sc->rc_report_tail = 0;
 	return hw->priv;
 }
 
@@ -1458,10 +710,6 @@ static void ssv6xxx_rate_free(void *priv)
 		kfree(sc->rc);
 		sc->rc = NULL;
 	}
-	sc->rc_sample_sechedule = 0;
-	cancel_work_sync(&sc->rc_sample_work);
-	flush_workqueue(sc->rc_sample_workqueue);
-	destroy_workqueue(sc->rc_sample_workqueue);
 }
 
 static struct rate_control_ops ssv_rate_ops = {
@@ -1579,7 +827,15 @@ u8 ssv6xxx_rc_hw_rate_update_check(struct sk_buff *skb, struct ssv_softc *sc,
 	}
 	spinfo = &rc_sta->spinfo;
 	period = msecs_to_jiffies(RC_PID_REPORT_INTERVAL);
-	if (time_after(jiffies, spinfo->last_report + period)) {
+	if (rc_sta->host_rc) {
+		u32 sample = sc->sh->cfg.rc_host_sample ? :
+		    SSV_RC_HOST_SAMPLE_DEFAULT;
+		if (++spinfo->host_tx_cnt >= sample) {
+			ret |= RC_FIRMWARE_REPORT_FLAG;
+			spinfo->last_report = jiffies;
+			spinfo->host_tx_cnt = 0;
+		}
+	} else if (time_after(jiffies, spinfo->last_report + period)) {
 		ret |= RC_FIRMWARE_REPORT_FLAG;
 		spinfo->last_report = jiffies;
 	}
@@ -1654,8 +910,14 @@ void ssv6xxx_rc_hw_reset(struct ssv_softc *sc, int rc_idx, int hwidx)
 		dev_dbg(sc->dev, "rc_wsid[%d] rc_idx[%d]\n", rc_sta[rc_idx].rc_wsid,
 		       rc_idx);
 		SMAC_REG_WRITE(sc->sh, rc_hw_reg[hwidx], 0x40000000);
+		rc_sta->host_rc = 0;
+	} else if (hwidx >= SSV_NUM_HW_STA && hwidx < SSV_NUM_STA) {
+		rc_sta->rc_wsid = hwidx;
+		rc_sta->host_rc = 1;
+		rc_sta->spinfo.host_tx_cnt = 0;
 	} else {
 		rc_sta->rc_wsid = -1;
+		rc_sta->host_rc = 0;
 	}
 }
 
@@ -17,25 +17,18 @@
 #ifndef _SSV_RC_H_
 #define _SSV_RC_H_
 #include "ssv_rc_common.h"
-#define RC_PID_REPORT_INTERVAL 40
-#define RC_PID_INTERVAL 125
-#define RC_PID_DO_ARITH_RIGHT_SHIFT(x,y) \
- ((x) < 0 ? -((-(x)) >> (y)) : (x) >> (y))
-#define RC_PID_NORM_OFFSET 3
-#define RC_PID_SMOOTHING_SHIFT 1
-#define RC_PID_SMOOTHING (1 << RC_PID_SMOOTHING_SHIFT)
-#define RC_PID_COEFF_P 15
-#define RC_PID_COEFF_I 15
-#define RC_PID_COEFF_D 5
-#define MAXPROBES 3
+#include "ssv_pid_rc.h"
 #define SSV_DRATE_IDX (2)
 #define SSV_CRATE_IDX (3)
 
 struct ssv_softc;
+struct firmware_rate_control_report_data;
 struct ssv_rc_rate *ssv6xxx_rc_get_rate(int rc_index);
 void ssv6xxx_rc_hw_rate_idx(struct ssv_softc *sc,
 			    struct ieee80211_tx_info *info,
 			    struct ssv_rate_info *sr);
+s32 ssv62xx_ht_rate_update(struct sk_buff *skb, struct ssv_softc *sc,
+			   struct fw_rc_retry_params *ar);
 u8 ssv6xxx_rc_hw_rate_update_check(struct sk_buff *skb, struct ssv_softc *sc,
 				   u32 do_rts_cts);
 void ssv6xxx_rc_mac8011_rate_idx(struct ssv_softc *sc, int hw_rate_idx,
@@ -46,5 +39,8 @@ int ssv6xxx_rate_control_register(void);
 void ssv6xxx_rate_control_unregister(void);
 void ssv6xxx_rc_rx_data_handler(struct ieee80211_hw *hw, struct sk_buff *skb,
 				u32 rate_index);
-int pide_frame_duration(size_t len, int rate, int short_preamble, int flags);
+bool ssv6xxx_rc_report_put(struct ssv_softc *sc, u8 h_event,
+			   const struct firmware_rate_control_report_data
+			   *report_data);
+void ssv6xxx_rc_report_drain(struct ssv_softc *sc);
 #endif
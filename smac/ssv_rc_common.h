@@ -22,6 +22,7 @@
 #define TDIFS 34
 #define TSLOT 9
 #define SSV_RC_MAX_HARDWARE_SUPPORT 2
+#define SSV_RC_HOST_SAMPLE_DEFAULT 8
 #define RC_FIRMWARE_REPORT_FLAG 0x80
 #define RC_FLAG_INVALID 0x00000001
 #define RC_FLAG_LEGACY 0x00000002
@@ -92,6 +93,7 @@ struct rc_pid_sta_info {
 	u8 oldrate;
 	u8 tmp_rate_idx;
 	u8 probe_cnt;
+	u16 host_tx_cnt;
 };
 struct rc_pid_rateinfo {
 	u16 rc_index;
@@ -159,6 +161,7 @@ struct ssv_sta_rc_info {
 	u8 rc_type;
 	u8 rc_num_rate;
 	s8 rc_wsid;
+	u8 host_rc;
 	u8 ht_rc_type;
 	u8 is_ht;
 	u32 rc_supp_rates;
@@ -167,8 +170,48 @@ struct ssv_sta_rc_info {
 	struct rc_pid_sta_info spinfo;
 	struct ssv62xx_ht ht;
 };
+/*
+ * TX results reach the RC engine for the two hardware WSIDs through MIB
+ * counters, and for the other firmware WSIDs through sampled per-frame
+ * reports (host_rc). Anything else follows the peer's RX rate.
+ */
+static inline bool ssv6xxx_rc_sta_reported(struct ssv_sta_rc_info *rc_sta)
+{
+	return (rc_sta->rc_wsid >= 0)
+	    && ((rc_sta->rc_wsid < SSV_RC_MAX_HARDWARE_SUPPORT)
+		|| rc_sta->host_rc);
+}
+enum ssv_ctrl_frame {
+	SSV_CTRL_ACK,
+	SSV_CTRL_BA,
+	SSV_CTRL_CTS,
+	SSV_CTRL_RTS,
+	SSV_CTRL_NUM,
+};
+/*
+ * Airtime of a legacy rate. A data frame takes data_us plus its symbol
+ * (OFDM) or half-bit (CCK) count, found by multiplying with recip
+ * instead of dividing by divisor. Control responses are stored whole.
+ * The [2] index is the short preamble flag.
+ */
+struct ssv_rate_txtime {
+	u32 recip;
+	u16 divisor;
+	u16 phy_type;
+	u16 data_us[2];
+	u16 ctrl_us[2][SSV_CTRL_NUM];
+};
+/* One firmware or BA-derived rate control report, detached from its skb. */
+struct ssv_rc_report {
+	u8 h_event;
+	u8 wsid;
+	u16 ampdu_len;
+	u16 ampdu_ack_len;
+	struct ssv62xx_tx_rate rates[SSV62XX_TX_MAX_RATES];
+};
 struct ssv_rate_ctrl {
 	struct ssv_rc_rate *rc_table;
+	struct ssv_rate_txtime txtime[RATE_TABLE_SIZE];
 	struct ssv_sta_rc_info sta_rc_info[SSV_RC_MAX_STA];
 };
 #define HT_RC_UPDATE_INTERVAL 1000
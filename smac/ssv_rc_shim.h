@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2015 South Silicon Valley Microelectronics Inc.
+ * Copyright (c) 2015 iComm Corporation
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SSV_RC_SHIM_H_
+#define _SSV_RC_SHIM_H_
+/*
+ * The PID and minstrel-HT engines (ssv_pid_rc.c, ssv_ht_rc.c) use only
+ * what is below, so tools/rc_replay can build them outside the kernel.
+ * There, jiffies is a variable the caller advances at HZ 1000.
+ */
+#ifdef __KERNEL__
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/string.h>
+#include <linux/jiffies.h>
+#include <linux/random.h>
+#include <linux/bug.h>
+#include <linux/printk.h>
+#else
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+#define BIT(nr) (1UL << (nr))
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+#define DIV_ROUND_UP(n,d) (((n) + (d) - 1) / (d))
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#define swap(a,b) \
+	do { __typeof__(a) __tmp = (a); (a) = (b); (b) = __tmp; } while (0)
+#define pr_debug(fmt, ...) \
+	do { if (0) fprintf(stderr, fmt, ##__VA_ARGS__); } while (0)
+#define pr_err(fmt, ...) fprintf(stderr, fmt, ##__VA_ARGS__)
+#define WARN_ON(cond) ({ \
+	int __ret = !!(cond); \
+	if (__ret) \
+		fprintf(stderr, "WARN_ON(%s) at %s:%d\n", #cond, \
+			__FILE__, __LINE__); \
+	__ret; })
+#define BUG_ON(cond) do { if (cond) abort(); } while (0)
+#define HZ 1000
+extern unsigned long ssv_rc_jiffies;
+#define jiffies ssv_rc_jiffies
+#define msecs_to_jiffies(m) ((unsigned long)(m))
+#define time_after(a,b) ((long)((b) - (a)) < 0)
+void get_random_bytes(void *buf, int nbytes);
+#endif
+#endif
@@ -41,6 +41,7 @@ static char sg_cmd_buffer[CLI_BUFFER_SIZE + 1];
 static char *sg_argv[CLI_ARG_SIZE];
 static u32 sg_argc;
 extern char *ssv6xxx_result_buf;
+extern struct ssv_softc *ssv_dbg_sc;
 #if defined (CONFIG_ARM64) || defined (__x86_64__)
 u64 ssv6xxx_ifdebug_info[3] = { 0, 0, 0 };
 #else
@@ -94,6 +95,8 @@ static int ssv_cmd_reg(int argc, char *argv[])
 		addr = simple_strtoul(argv[2], &endp, 16);
 		value = simple_strtoul(argv[3], &endp, 16);
 		if (SSV_REG_WRITE1(ssv6xxx_debug_ifops, addr, value)) ;
+		if (ssv_dbg_sc != NULL)
+			SMAC_REG_SHADOW_INVALIDATE(ssv_dbg_sc->sh);
 		sprintf(ssv6xxx_result_buf, " => write [0x%08x]: 0x%08x\n",
 			addr, value);
 		return 0;
@@ -222,6 +225,7 @@ struct ssv6xxx_cfg_cmd_table cfg_cmds[] = {
 	{"mac_address_mode", (void *)&ssv_cfg.mac_address_mode, 0,
 	 __string2u32},
 	{"sr_bhvr", (void *)&ssv_cfg.sr_bhvr, 0, __string2u32},
+	{"rc_host_sample", (void *)&ssv_cfg.rc_host_sample, 0, __string2u32},
 	{"register", NULL, 0, __string2configuration},
 	{NULL, NULL, 0, NULL},
 };
@@ -250,6 +254,9 @@ static int ssv_cmd_cfg(int argc, char *argv[])
 		strcat(ssv6xxx_result_buf, temp_buf);
 		sprintf(temp_buf, "    sr_bhvr = %d\n", ssv_cfg.sr_bhvr);
 		strcat(ssv6xxx_result_buf, temp_buf);
+		sprintf(temp_buf, "    rc_host_sample = %d\n",
+			ssv_cfg.rc_host_sample);
+		strcat(ssv6xxx_result_buf, temp_buf);
 		sprintf(temp_buf, "    sta-mac = %02x:%02x:%02x:%02x:%02x:%02x",
 			ssv_cfg.maddr[0][0], ssv_cfg.maddr[0][1],
 			ssv_cfg.maddr[0][2], ssv_cfg.maddr[0][3],
@@ -648,33 +655,10 @@ void print_irq_count(void)
 #endif
 void print_isr_info(void)
 {
-	char temp_str[512];
-	sprintf(temp_str, ">>>> HCI Calculate ISR TIME(%s) unit:us\n",
-		((ssv_dbg_ctrl_hci->isr_summary_eable) ? "enable" : "disable"));
-	strcat(ssv6xxx_result_buf, temp_str);
-	sprintf(temp_str, "isr_routine_time(%d)\n",
-		jiffies_to_usecs(ssv_dbg_ctrl_hci->isr_routine_time));
-	strcat(ssv6xxx_result_buf, temp_str);
-	sprintf(temp_str, "isr_tx_time(%d)\n",
-		jiffies_to_usecs(ssv_dbg_ctrl_hci->isr_tx_time));
-	strcat(ssv6xxx_result_buf, temp_str);
-	sprintf(temp_str, "isr_rx_time(%d)\n",
-		jiffies_to_usecs(ssv_dbg_ctrl_hci->isr_rx_time));
-	strcat(ssv6xxx_result_buf, temp_str);
-	sprintf(temp_str, "isr_idle_time(%d)\n",
-		jiffies_to_usecs(ssv_dbg_ctrl_hci->isr_idle_time));
-	strcat(ssv6xxx_result_buf, temp_str);
-	sprintf(temp_str, "isr_rx_idle_time(%d)\n",
-		jiffies_to_usecs(ssv_dbg_ctrl_hci->isr_rx_idle_time));
-	strcat(ssv6xxx_result_buf, temp_str);
-	sprintf(temp_str, "isr_miss_cnt(%d)\n", ssv_dbg_ctrl_hci->isr_miss_cnt);
-	strcat(ssv6xxx_result_buf, temp_str);
-	sprintf(temp_str, "prev_isr_jiffes(%lu)\n",
-		ssv_dbg_ctrl_hci->prev_isr_jiffes);
-	strcat(ssv6xxx_result_buf, temp_str);
-	sprintf(temp_str, "prev_rx_isr_jiffes(%lu)\n",
-		ssv_dbg_ctrl_hci->prev_rx_isr_jiffes);
-	strcat(ssv6xxx_result_buf, temp_str);
+	size_t len = strlen(ssv6xxx_result_buf);
+	ssv_dbg_ctrl_hci->shi->hci_ops->
+	    hci_isr_hist_show(ssv6xxx_result_buf + len,
+			      CLI_RESULT_BUF_SIZE - len);
 }
 
 static int ssv_cmd_hci(int argc, char *argv[])
@@ -688,24 +672,33 @@ static int ssv_cmd_hci(int argc, char *argv[])
 				ac = ssv_dbg_sc->tx.ac_txqid[s];
 			txq = &ssv_dbg_ctrl_hci->hw_txq[s];
 			sprintf(temp_str, ">> txq[%d]", txq->txq_no);
-			if (ssv_dbg_sc != NULL)
+			strcat(ssv6xxx_result_buf, temp_str);
+			if (ssv_dbg_sc != NULL) {
 				sprintf(temp_str, "(%s): ",
 					((ssv_dbg_sc->
 					  sc_flags & SC_OP_OFFCHAN) ?
 					 "off channel" : "on channel"));
+				strcat(ssv6xxx_result_buf, temp_str);
+			}
 			sprintf(temp_str, "cur_qsize=%d\n",
 				skb_queue_len(&txq->qhead));
 			strcat(ssv6xxx_result_buf, temp_str);
 			sprintf(temp_str,
-				"            max_qsize=%d, pause=%d, resume_thres=%d",
-				txq->max_qsize, txq->paused, txq->resum_thres);
+				"            max_qsize=%d, pause=%d, bytes=%d, limit=%u, rate=%u B/ms",
+				txq->max_qsize, txq->paused,
+				atomic_read(&txq->qbytes), txq->limit_bytes,
+				txq->drain_rate);
+			strcat(ssv6xxx_result_buf, temp_str);
 			if (ssv_dbg_sc != NULL)
 				sprintf(temp_str, " flow_control[%d]\n",
 					!!(ssv_dbg_sc->tx.
 					   flow_ctrl_status & (1 << ac)));
+			else
+				sprintf(temp_str, "\n");
 			strcat(ssv6xxx_result_buf, temp_str);
-			sprintf(temp_str, "            Total %d frame sent\n",
-				txq->tx_pkt);
+			sprintf(temp_str,
+				"            Total %d frame sent, weight=%u, deficit=%d\n",
+				txq->tx_pkt, txq->weight, txq->deficit);
 			strcat(ssv6xxx_result_buf, temp_str);
 		}
 		sprintf(temp_str,
@@ -719,10 +712,19 @@ static int ssv_cmd_hci(int argc, char *argv[])
 			ssv_dbg_ctrl_hci->isr_running,
 			ssv_dbg_ctrl_hci->xmit_running);
 		strcat(ssv6xxx_result_buf, temp_str);
-		if (ssv_dbg_sc != NULL)
-			sprintf(temp_str, "    flow_ctrl_status=%08x\n",
-				ssv_dbg_sc->tx.flow_ctrl_status);
+		sprintf(temp_str,
+			"    tx_scatter_cnt=%d, tx_gather_cnt=%d, tx_irq_arm_cnt=%d\n",
+			ssv_dbg_ctrl_hci->tx_scatter_cnt,
+			ssv_dbg_ctrl_hci->tx_gather_cnt,
+			ssv_dbg_ctrl_hci->tx_irq_arm_cnt);
 		strcat(ssv6xxx_result_buf, temp_str);
+		if (ssv_dbg_sc != NULL) {
+			sprintf(temp_str,
+				"    flow_ctrl_status=%08x, rc_report_drop=%u\n",
+				ssv_dbg_sc->tx.flow_ctrl_status,
+				ssv_dbg_sc->rc_report_drop);
+			strcat(ssv6xxx_result_buf, temp_str);
+		}
 		return 0;
 	} else if (argc == 3 && !strcmp(argv[1], "rxq")
 		   && !strcmp(argv[2], "show")) {
@@ -731,29 +733,59 @@ static int ssv_cmd_hci(int argc, char *argv[])
 			  sc_flags & SC_OP_OFFCHAN) ? "off channel" :
 			 "on channel"), ssv_dbg_ctrl_hci->rx_pkt);
 		strcat(ssv6xxx_result_buf, temp_str);
+		sprintf(temp_str,
+			"    rx_ring=%d, rx_scatter_cnt=%d, rx_ring_empty_cnt=%d\n",
+			skb_queue_len(&ssv_dbg_ctrl_hci->rx_ring),
+			ssv_dbg_ctrl_hci->rx_scatter_cnt,
+			ssv_dbg_ctrl_hci->rx_ring_empty_cnt);
+		strcat(ssv6xxx_result_buf, temp_str);
+		sprintf(temp_str, "    rx_copybreak=%d, rx_copybreak_cnt=%d\n",
+			ssv_dbg_ctrl_hci->rx_copybreak,
+			ssv_dbg_ctrl_hci->rx_copybreak_cnt);
+		strcat(ssv6xxx_result_buf, temp_str);
+		return 0;
+	} else if (argc == 3 && !strcmp(argv[1], "rx_copybreak")) {
+		ssv_dbg_ctrl_hci->rx_copybreak =
+		    simple_strtoul(argv[2], NULL, 10);
+		sprintf(temp_str, "rx_copybreak=%d\n",
+			ssv_dbg_ctrl_hci->rx_copybreak);
+		strcat(ssv6xxx_result_buf, temp_str);
+		return 0;
+	} else if (argc == 3 && !strcmp(argv[1], "reg_shadow")
+		   && !strcmp(argv[2], "show")) {
+		sprintf(temp_str,
+			">> HCI Register Shadow:\n    valid=%08x, hit=%d, miss=%d\n",
+			ssv_dbg_ctrl_hci->reg_shadow_valid,
+			ssv_dbg_ctrl_hci->reg_shadow_hit,
+			ssv_dbg_ctrl_hci->reg_shadow_miss);
+		strcat(ssv6xxx_result_buf, temp_str);
+		return 0;
+	} else if (argc == 3 && !strcmp(argv[1], "reg_shadow")
+		   && !strcmp(argv[2], "flush")) {
+		if (ssv_dbg_sc != NULL)
+			SMAC_REG_SHADOW_INVALIDATE(ssv_dbg_sc->sh);
+		strcat(ssv6xxx_result_buf, "register shadow flushed\n");
 		return 0;
 	} else if (argc == 3 && !strcmp(argv[1], "isr_time")
 		   && !strcmp(argv[2], "start")) {
-		ssv_dbg_ctrl_hci->isr_summary_eable = 1;
-		ssv_dbg_ctrl_hci->isr_routine_time = 0;
-		ssv_dbg_ctrl_hci->isr_tx_time = 0;
-		ssv_dbg_ctrl_hci->isr_rx_time = 0;
-		ssv_dbg_ctrl_hci->isr_idle_time = 0;
-		ssv_dbg_ctrl_hci->isr_rx_idle_time = 0;
-		ssv_dbg_ctrl_hci->isr_miss_cnt = 0;
-		ssv_dbg_ctrl_hci->prev_isr_jiffes = 0;
-		ssv_dbg_ctrl_hci->prev_rx_isr_jiffes = 0;
+		ssv_dbg_ctrl_hci->shi->hci_ops->hci_isr_hist_reset();
+		ssv_dbg_ctrl_hci->isr_hist_enable = 1;
 		print_isr_info();
 		return 0;
 	} else if (argc == 3 && !strcmp(argv[1], "isr_time")
 		   && !strcmp(argv[2], "stop")) {
-		ssv_dbg_ctrl_hci->isr_summary_eable = 0;
+		ssv_dbg_ctrl_hci->isr_hist_enable = 0;
 		print_isr_info();
 		return 0;
 	} else if (argc == 3 && !strcmp(argv[1], "isr_time")
 		   && !strcmp(argv[2], "show")) {
 		print_isr_info();
 		return 0;
+	} else if (argc == 3 && !strcmp(argv[1], "isr_time")
+		   && !strcmp(argv[2], "reset")) {
+		ssv_dbg_ctrl_hci->shi->hci_ops->hci_isr_hist_reset();
+		strcat(ssv6xxx_result_buf, "isr histograms reset\n");
+		return 0;
 	}
 #ifdef CONFIG_IRQ_DEBUG_COUNT
 	else if (argc == 3 && !strcmp(argv[1], "isr_debug")
@@ -764,7 +796,6 @@ static int ssv_cmd_hci(int argc, char *argv[])
 		ssv_dbg_ctrl_hci->tx_irq_count = 0;
 		ssv_dbg_ctrl_hci->real_tx_irq_count = 0;
 		ssv_dbg_ctrl_hci->rx_irq_count = 0;
-		ssv_dbg_ctrl_hci->isr_rx_idle_time = 0;
 		ssv_dbg_ctrl_hci->irq_rx_pkt_count = 0;
 		ssv_dbg_ctrl_hci->irq_tx_pkt_count = 0;
 		strcat(ssv6xxx_result_buf, "irq debug reset count\n");
@@ -787,7 +818,7 @@ static int ssv_cmd_hci(int argc, char *argv[])
 #endif
 	else {
 		strcat(ssv6xxx_result_buf,
-		       "hci [txq|rxq] [show]\nhci [isr_time] [start|stop|show]\n\n");
+		       "hci [txq|rxq] [show]\nhci [isr_time] [start|stop|show|reset]\nhci [rx_copybreak] [bytes]\nhci [reg_shadow] [show|flush]\n\n");
 		return 0;
 	}
 	return -1;
@@ -1645,6 +1676,282 @@ static int ssv_cmd_rxtput(int argc, char *argv[])
 	return 0;
 }
 
+#define SSV_BENCH_MAX_STEPS 16
+#define SSV_BENCH_DIR_TX 0x1
+#define SSV_BENCH_DIR_RX 0x2
+#define SSV_BENCH_STEP_TIMEOUT_MS 10000
+struct ssv_bench_result {
+	u32 size;
+	u32 elapsed_us;
+	struct ssv6xxx_hci_bench_stat stat;
+};
+struct _ssv6xxx_bench {
+	struct task_struct *bench_tsk;
+	bool running;
+	u32 dir;
+	u32 txq_mask;
+	u32 frames;
+	u32 nr_steps;
+	u32 size[SSV_BENCH_MAX_STEPS];
+	u32 done_steps;
+	struct ssv_bench_result result[SSV_BENCH_MAX_STEPS];
+};
+static struct _ssv6xxx_bench ssv_bench;
+
+static int ssv_bench_send_rxtput(u32 size, u32 frames)
+{
+	struct sk_buff *skb;
+	struct cfg_host_cmd *host_cmd;
+	struct sdio_rxtput_cfg rxtput_cfg;
+	int ret;
+	skb = ssvdevice_skb_alloc(HOST_CMD_HDR_LEN +
+				  sizeof(struct sdio_rxtput_cfg));
+	if (skb == NULL)
+		return -ENOMEM;
+	rxtput_cfg.size_per_frame = size;
+	rxtput_cfg.total_frames = frames;
+	skb->data_len = HOST_CMD_HDR_LEN + sizeof(struct sdio_rxtput_cfg);
+	skb->len = skb->data_len;
+	host_cmd = (struct cfg_host_cmd *)skb->data;
+	host_cmd->c_type = HOST_CMD;
+	host_cmd->h_cmd = (u8) SSV6XXX_HOST_CMD_RX_TPUT;
+	host_cmd->len = skb->data_len;
+	memcpy(host_cmd->dat32, &rxtput_cfg, sizeof(struct sdio_rxtput_cfg));
+	ret = ssv_dbg_ctrl_hci->shi->hci_ops->hci_send_cmd(skb);
+	ssvdevice_skb_free(skb);
+	return ret;
+}
+
+static int ssv_bench_tx(u32 size, u32 frames, u32 txq_mask)
+{
+	struct ssv6xxx_hci_ops *hci_ops = ssv_dbg_ctrl_hci->shi->hci_ops;
+	struct ssv6200_tx_desc *tx_desc;
+	struct sk_buff *skb;
+	int txqid = 0, qlen;
+	while (frames > 0 && !kthread_should_stop()) {
+		while (!(txq_mask & (1 << txqid)))
+			txqid = (txqid + 1) % SSV_HW_TXQ_NUM;
+		skb = ssvdevice_skb_alloc(size);
+		if (skb == NULL)
+			return -ENOMEM;
+		skb->data_len = size;
+		skb->len = size;
+		tx_desc = (struct ssv6200_tx_desc *)skb->data;
+		memset((void *)tx_desc, 0xff, SSV6XXX_TX_DESC_LEN);
+		tx_desc->len = skb->len;
+		tx_desc->c_type = M2_TXREQ;
+		tx_desc->fCmd = (M_ENG_CPU << 4) | M_ENG_HWHCI;
+		tx_desc->reason = ID_TRAP_SW_TXTPUT;
+		tx_desc->txq_idx = txqid;
+		qlen = hci_ops->hci_tx(skb, txqid, HCI_FLAGS_NO_FLOWCTRL);
+		if (qlen >= (SSV_HW_TXQ_MAX_SIZE >> 1))
+			usleep_range(500, 1000);
+		txqid = (txqid + 1) % SSV_HW_TXQ_NUM;
+		frames--;
+	}
+	return 0;
+}
+
+static bool ssv_bench_step_done(u32 dir, u32 frames, u32 txq_mask)
+{
+	struct ssv6xxx_hci_ops *hci_ops = ssv_dbg_ctrl_hci->shi->hci_ops;
+	int txqid;
+	if ((dir & SSV_BENCH_DIR_RX)
+	    && (ssv_dbg_ctrl_hci->bench_frames[SSV6XXX_BENCH_RX] < frames))
+		return false;
+	if (dir & SSV_BENCH_DIR_TX) {
+		for (txqid = 0; txqid < SSV_HW_TXQ_NUM; txqid++) {
+			if ((txq_mask & (1 << txqid))
+			    && !hci_ops->hci_txq_empty(txqid))
+				return false;
+		}
+	}
+	return true;
+}
+
+static int ssv_bench_thread(void *data)
+{
+	struct ssv6xxx_hci_ops *hci_ops = ssv_dbg_ctrl_hci->shi->hci_ops;
+	struct ssv_bench_result *result;
+	unsigned long timeout;
+	ktime_t start;
+	u32 step;
+	for (step = 0; step < ssv_bench.nr_steps; step++) {
+		if (kthread_should_stop())
+			break;
+		result = &ssv_bench.result[step];
+		result->size = ssv_bench.size[step];
+		if (hci_ops->hci_bench_start())
+			break;
+		start = ktime_get();
+		if (ssv_bench.dir & SSV_BENCH_DIR_RX)
+			ssv_bench_send_rxtput(result->size + HOST_CMD_HDR_LEN,
+					      ssv_bench.frames);
+		if (ssv_bench.dir & SSV_BENCH_DIR_TX)
+			ssv_bench_tx(result->size + SSV6XXX_TX_DESC_LEN,
+				     ssv_bench.frames, ssv_bench.txq_mask);
+		timeout = jiffies + msecs_to_jiffies(SSV_BENCH_STEP_TIMEOUT_MS);
+		while (!kthread_should_stop() && time_before(jiffies, timeout)
+		       && !ssv_bench_step_done(ssv_bench.dir, ssv_bench.frames,
+					       ssv_bench.txq_mask))
+			usleep_range(1000, 2000);
+		result->elapsed_us =
+		    (u32) ktime_to_us(ktime_sub(ktime_get(), start));
+		hci_ops->hci_bench_stop();
+		hci_ops->hci_bench_stat(&result->stat);
+		ssv_bench.done_steps = step + 1;
+	}
+	WRITE_ONCE(ssv_bench.running, false);
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+	}
+	return 0;
+}
+
+void ssv_bench_cleanup(void)
+{
+	if (ssv_bench.bench_tsk) {
+		kthread_stop(ssv_bench.bench_tsk);
+		ssv_bench.bench_tsk = NULL;
+	}
+	ssv_bench.running = false;
+}
+
+static u32 ssv_bench_kbps(u64 bytes, u32 elapsed_us)
+{
+	if (elapsed_us == 0)
+		return 0;
+	return (u32) div_u64(bytes * 8 * 1000, elapsed_us);
+}
+
+static void ssv_bench_show(void)
+{
+	static const char *const dir_name[SSV6XXX_BENCH_DIR_NUM] =
+	    { "tx", "rx" };
+	struct ssv_bench_result *result;
+	char tmpbf[160];
+	u32 step;
+	int dir;
+	sprintf(tmpbf, "bench %s: %u/%u steps, %u frames, txq_mask 0x%x\n",
+		READ_ONCE(ssv_bench.running) ? "running" : "idle",
+		ssv_bench.done_steps,
+		ssv_bench.nr_steps, ssv_bench.frames, ssv_bench.txq_mask);
+	strcat(ssv6xxx_result_buf, tmpbf);
+	for (step = 0; step < ssv_bench.done_steps; step++) {
+		result = &ssv_bench.result[step];
+		for (dir = 0; dir < SSV6XXX_BENCH_DIR_NUM; dir++) {
+			if (!(ssv_bench.dir & (1 << dir)))
+				continue;
+			sprintf(tmpbf,
+				"%5u %s: %6u fr %7u Kbps lat(us) p50 %u p99 %u p999 %u\n",
+				result->size, dir_name[dir],
+				result->stat.frames[dir],
+				ssv_bench_kbps(result->stat.bytes[dir],
+					       result->elapsed_us),
+				result->stat.p50_ns[dir] / 1000,
+				result->stat.p99_ns[dir] / 1000,
+				result->stat.p999_ns[dir] / 1000);
+			strcat(ssv6xxx_result_buf, tmpbf);
+		}
+	}
+}
+
+static int ssv_bench_parse_sizes(char *arg)
+{
+	u32 size, end, step;
+	char *tok, *endp;
+	ssv_bench.nr_steps = 0;
+	while ((tok = strsep(&arg, ",")) != NULL) {
+		size = simple_strtoul(tok, &endp, 10);
+		end = size;
+		step = 1;
+		if (*endp == '-') {
+			end = simple_strtoul(endp + 1, &endp, 10);
+			if (*endp == ':')
+				step = simple_strtoul(endp + 1, &endp, 10);
+		}
+		if (size == 0 || step == 0 || end < size)
+			return -EINVAL;
+		for (; size <= end; size += step) {
+			if (size + SSV6XXX_TX_DESC_LEN > MAX_FRAME_SIZE)
+				return -EINVAL;
+			if (ssv_bench.nr_steps >= SSV_BENCH_MAX_STEPS)
+				return -EINVAL;
+			ssv_bench.size[ssv_bench.nr_steps++] = size;
+		}
+	}
+	return ssv_bench.nr_steps ? 0 : -EINVAL;
+}
+
+static int ssv_cmd_bench(int argc, char *argv[])
+{
+	char *endp;
+	if (argc == 2 && !strcmp(argv[1], "stop")) {
+		ssv_bench_cleanup();
+		return 0;
+	}
+	if (argc == 2 && !strcmp(argv[1], "show")) {
+		ssv_bench_show();
+		return 0;
+	}
+	if (argc < 4 || argc > 5) {
+		strcat(ssv6xxx_result_buf,
+		       "* bench tx|rx|bidir [sizes] [frames] [txq_mask]\n"
+		       "    sizes: comma list of payload sizes or ranges\n"
+		       "           min-max:step, at most 16 steps\n"
+		       "    txq_mask: TX queues to spread load on (def 0x1)\n"
+		       "* bench show\n* bench stop\n"
+		       " EX: bench bidir 64,512-1536:512 2000 0xf\n");
+		return 0;
+	}
+	if (ssv_dbg_ctrl_hci == NULL || ssv_dbg_ctrl_hci->shi == NULL) {
+		strcat(ssv6xxx_result_buf, "hci not registered\n");
+		return 0;
+	}
+	if (READ_ONCE(ssv_bench.running)) {
+		strcat(ssv6xxx_result_buf, "bench already in progress\n");
+		return 0;
+	}
+	ssv_bench_cleanup();
+	if (!strcmp(argv[1], "tx"))
+		ssv_bench.dir = SSV_BENCH_DIR_TX;
+	else if (!strcmp(argv[1], "rx"))
+		ssv_bench.dir = SSV_BENCH_DIR_RX;
+	else if (!strcmp(argv[1], "bidir"))
+		ssv_bench.dir = SSV_BENCH_DIR_TX | SSV_BENCH_DIR_RX;
+	else
+		return -1;
+	if (ssv_bench_parse_sizes(argv[2])) {
+		strcat(ssv6xxx_result_buf, "invalid size list\n");
+		return 0;
+	}
+	ssv_bench.frames = simple_strtoul(argv[3], &endp, 10);
+	ssv_bench.txq_mask = (argc == 5) ?
+	    (simple_strtoul(argv[4], &endp, 16) & 0x1f) : 0x1;
+	if (ssv_bench.frames == 0 || ssv_bench.txq_mask == 0)
+		return -1;
+	if (ssv_dbg_sc != NULL) {
+		watchdog_controller(ssv_dbg_sc->sh,
+				    (u8) SSV6XXX_HOST_CMD_WATCHDOG_STOP);
+		ssv_dbg_sc->watchdog_flag = WD_SLEEP;
+	}
+	ssv_bench.done_steps = 0;
+	ssv_bench.running = true;
+	ssv_bench.bench_tsk = kthread_run(ssv_bench_thread, NULL,
+					  "ssv_bench_thread");
+	if (IS_ERR(ssv_bench.bench_tsk)) {
+		ssv_bench.bench_tsk = NULL;
+		ssv_bench.running = false;
+		strcat(ssv6xxx_result_buf, "bench thread start failed\n");
+		return 0;
+	}
+	strcat(ssv6xxx_result_buf, "bench started, see 'bench show'\n");
+	return 0;
+}
+
 static int ssv_cmd_check(int argc, char *argv[])
 {
 	u32 size, i, j, x, y, id, value, address, id_value;
@@ -1709,6 +2016,7 @@ struct ssv_cmd_table cmd_table[] = {
 	{"tool", ssv_cmd_tool, "ssv6200 tool register read/write."},
 	{"rxtput", ssv_cmd_rxtput, "test rx sdio throughput"},
 	{"txtput", ssv_cmd_txtput, "test tx sdio throughput"},
+	{"bench", ssv_cmd_bench, "hci throughput/latency benchmark"},
 	{"check", ssv_cmd_check, "dump all allocate packet buffer"},
 	{NULL, NULL, NULL},
 };
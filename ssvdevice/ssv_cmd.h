@@ -47,4 +47,5 @@ struct ssv6xxx_cfg_cmd_table {
         SSV_REG_WRITE(ops, reg, reg_val); \
     }
 int ssv_cmd_submit(char *cmd);
+void ssv_bench_cleanup(void);
 #endif
@@ -204,6 +204,10 @@ extern int ssv6xxx_init(void);
 extern void ssv6xxx_exit(void);
 extern int ssv6xxx_sdio_init(void);
 extern void ssv6xxx_sdio_exit(void);
+#ifdef CONFIG_SSV_HWIF_SIM
+extern int ssv6xxx_sim_init(void);
+extern void ssv6xxx_sim_exit(void);
+#endif
 
 int ssvdevice_init(void)
 {
@@ -231,7 +235,11 @@ int ssvdevice_init(void)
 			ret = ssv6xxx_init();
 		}
 		if (!ret) {
+#ifdef CONFIG_SSV_HWIF_SIM
+			ret = ssv6xxx_sim_init();
+#else
 			ret = ssv6xxx_sdio_init();
+#endif
 		}
 		return ret;
 	}
@@ -242,9 +250,14 @@ int ssvdevice_init(void)
 void ssvdevice_exit(void)
 {
 
+	ssv_bench_cleanup();
 	ssv6xxx_exit();
 	ssv6xxx_hci_exit();
+#ifdef CONFIG_SSV_HWIF_SIM
+	ssv6xxx_sim_exit();
+#else
 	ssv6xxx_sdio_exit();
+#endif
 
 #ifdef CONFIG_DEBUG_FS
 	debugfs_remove_recursive(debugfs);
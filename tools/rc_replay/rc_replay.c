@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2015 South Silicon Valley Microelectronics Inc.
+ * Copyright (c) 2015 iComm Corporation
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Replay recorded rate control reports through the driver's PID and
+ * minstrel-HT engines (smac/ssv_pid_rc.c, smac/ssv_ht_rc.c), built
+ * unmodified against ssv_rc_shim.h.
+ *
+ * Record with the ssv6xxx_rc_report trace event:
+ *   echo 1 > /sys/kernel/debug/tracing/events/ssv6xxx/ssv6xxx_rc_report/enable
+ *   cat /sys/kernel/debug/tracing/trace_pipe > rc.trace
+ * Lines may also be written by hand as "<seconds> wsid=.. ampdu=.. len=..
+ * ack=.. rates=r/c,r/c,r/c", with r the hardware rate index.
+ *
+ * Engine parameters are compile time; rebuild with e.g.
+ *   make RC_CFLAGS="-DEWMA_LEVEL=50 -DRC_PID_INTERVAL=100"
+ */
+
+#include <getopt.h>
+#include "ssv_rc_shim.h"
+#include <ssv6200_common.h>
+#include "ssv_ht_rc.h"
+#include "ssv_pid_rc.h"
+
+#define RC_REPLAY_DECAY_MS 100
+
+unsigned long ssv_rc_jiffies;
+static u32 rc_replay_seed = 1;
+
+void get_random_bytes(void *buf, int nbytes)
+{
+	u8 *p = buf;
+	while (nbytes--) {
+		rc_replay_seed = rc_replay_seed * 1103515245 + 12345;
+		*p++ = rc_replay_seed >> 16;
+	}
+}
+
+struct rc_replay_rate {
+	double att;
+	double succ;
+	double time_s;
+};
+
+struct rc_replay {
+	struct ssv_sta_rc_info rc_sta;
+	struct rc_replay_rate rate[RATE_TABLE_SIZE];
+	int wsid;
+	int frame_len;
+	int verbose;
+	double t0, t_last, t_decay;
+	int cur_rate;
+	double settle_s;
+	u32 changes;
+	u32 n_mpdu, n_ampdu, n_sample;
+	u64 acked;
+	double sim_bits;
+};
+
+static const char *rc_replay_rate_name(int idx)
+{
+	static const char *const names[RATE_TABLE_SIZE] = {
+		"1M", "2M", "5.5M", "11M", "2M-s", "5.5M-s", "11M-s",
+		"6M", "9M", "12M", "18M", "24M", "36M", "48M", "54M",
+		"MCS0", "MCS1", "MCS2", "MCS3",
+		"MCS4", "MCS5", "MCS6", "MCS7",
+		"MCS0-sgi", "MCS1-sgi", "MCS2-sgi", "MCS3-sgi",
+		"MCS4-sgi", "MCS5-sgi", "MCS6-sgi", "MCS7-sgi",
+		"MCS0-gf", "MCS1-gf", "MCS2-gf", "MCS3-gf",
+		"MCS4-gf", "MCS5-gf", "MCS6-gf", "MCS7-gf",
+	};
+	if (idx < 0 || idx >= RATE_TABLE_SIZE)
+		return "?";
+	return names[idx];
+}
+
+static int rc_replay_setup(struct rc_replay *rp, const char *mode,
+			   u32 mcs_mask)
+{
+	struct ssv_sta_rc_info *rc_sta = &rp->rc_sta;
+	memset(rc_sta, 0, sizeof(*rc_sta));
+	rc_sta->rc_valid = true;
+	rc_sta->rc_wsid = 0;
+	if (!strcmp(mode, "b")) {
+		rc_sta->rc_type = RC_TYPE_B_ONLY;
+		rc_sta->rc_supp_rates = 0xf;
+	} else if (!strcmp(mode, "g")) {
+		rc_sta->rc_type = RC_TYPE_LEGACY_GB;
+		rc_sta->rc_supp_rates = 0xfff;
+	} else {
+		if (!strcmp(mode, "n")) {
+			rc_sta->rc_type = RC_TYPE_LGI_20;
+			rc_sta->ht_rc_type = RC_TYPE_HT_LGI_20;
+		} else if (!strcmp(mode, "n-sgi")) {
+			rc_sta->rc_type = RC_TYPE_SGI_20;
+			rc_sta->ht_rc_type = RC_TYPE_HT_SGI_20;
+		} else if (!strcmp(mode, "n-gf")) {
+			rc_sta->rc_type = RC_TYPE_HT_GF;
+			rc_sta->ht_rc_type = RC_TYPE_HT_GF;
+		} else {
+			return -1;
+		}
+		rc_sta->ht_supp_rates = mcs_mask & 0xff;
+		rc_sta->rc_supp_rates = rc_sta->ht_supp_rates;
+		rc_sta->is_ht = 1;
+		ssv62xx_ht_rc_caps(ssv6xxx_rc_rate_set, rc_sta);
+	}
+	rc_sta->rc_num_rate = (u8)ssv6xxx_rc_rate_set[rc_sta->rc_type][0];
+	ssv62xx_pid_rc_caps(rc_sta);
+	return 0;
+}
+
+/*
+ * PID only learns from reports at its current or probe rate, so start
+ * it where the recording starts rather than at the lowest rate.
+ */
+static void rc_replay_seed_pid(struct rc_replay *rp,
+			       const struct ssv_rc_report *report)
+{
+	struct ssv_sta_rc_info *rc_sta = &rp->rc_sta;
+	int i, rate = report->rates[0].data_rate;
+	if (rc_sta->is_ht)
+		return;
+	if (rate >= 4 && rate <= 6)
+		rate -= 3;
+	for (i = 0; i < rc_sta->rc_num_rate; i++) {
+		if (rc_sta->pinfo.rinfo[i].rc_index != rate)
+			continue;
+		rc_sta->spinfo.txrate_idx = i;
+		rc_sta->spinfo.tmp_rate_idx = i;
+		rc_sta->spinfo.oldrate = i;
+		rc_sta->pinfo.oldrate = i;
+		return;
+	}
+}
+
+/* The rate the driver would send the next data frame at. */
+static int rc_replay_cur_rate(struct rc_replay *rp)
+{
+	struct ssv_sta_rc_info *rc_sta = &rp->rc_sta;
+	if (rc_sta->is_ht)
+		return rc_sta->ht.groups.rates[rc_sta->ht.max_tp_rate].rc_index;
+	return rc_sta->pinfo.rinfo[rc_sta->spinfo.txrate_idx].rc_index;
+}
+
+/*
+ * Delivery ratio of a rate as seen in the trace, decayed by half every
+ * RC_REPLAY_DECAY_MS. A rate the trace never used borrows from the
+ * closest slower rate that it did use.
+ */
+static double rc_replay_delivery(struct rc_replay *rp, int idx)
+{
+	int i;
+	for (i = idx; i >= 0; i--) {
+		if (rp->rate[i].att >= 1.0)
+			return rp->rate[i].succ / rp->rate[i].att;
+	}
+	return 0.0;
+}
+
+static void rc_replay_observe(struct rc_replay *rp,
+			      const struct ssv_rc_report *report, double t)
+{
+	int i, idx, last = -1;
+	while (t - rp->t_decay >= RC_REPLAY_DECAY_MS / 1000.0) {
+		for (i = 0; i < RATE_TABLE_SIZE; i++) {
+			rp->rate[i].att /= 2;
+			rp->rate[i].succ /= 2;
+		}
+		rp->t_decay += RC_REPLAY_DECAY_MS / 1000.0;
+	}
+	for (i = 0; i < SSV62XX_TX_MAX_RATES; i++) {
+		idx = report->rates[i].data_rate;
+		if (!report->rates[i].count || idx < 0
+		    || idx >= RATE_TABLE_SIZE)
+			break;
+		if (idx >= 4 && idx <= 6)
+			idx -= 3;
+		rp->rate[idx].att +=
+		    report->rates[i].count * (double)report->ampdu_len;
+		last = idx;
+	}
+	if (last >= 0)
+		rp->rate[last].succ += report->ampdu_ack_len;
+}
+
+static void rc_replay_account(struct rc_replay *rp, double t)
+{
+	int idx = rp->cur_rate;
+	double dt = t - rp->t_last;
+	if (dt <= 0)
+		return;
+	rp->rate[idx].time_s += dt;
+	rp->sim_bits += dt * ssv_11bgn_rate_table[idx].rate_kbps * 1000.0 *
+	    rc_replay_delivery(rp, idx);
+	rp->t_last = t;
+}
+
+static void rc_replay_report(struct rc_replay *rp,
+			     struct ssv_rc_report *report, double t)
+{
+	struct ssv_sta_rc_info *rc_sta = &rp->rc_sta;
+	int rate;
+	if (!rp->n_mpdu && !rp->n_ampdu) {
+		rp->t0 = rp->t_last = rp->t_decay = t;
+		rc_replay_seed_pid(rp, report);
+		rp->cur_rate = rc_replay_cur_rate(rp);
+	}
+	rc_replay_account(rp, t);
+	rc_replay_observe(rp, report, t);
+	ssv_rc_jiffies = (unsigned long)((t - rp->t0) * HZ);
+	if (report->h_event == SOC_EVT_RC_AMPDU_REPORT) {
+		rp->n_ampdu++;
+		if (rc_sta->is_ht
+		    && ssv62xx_ht_get_sample_rate(&rc_sta->ht, rc_sta) >= 0)
+			rp->n_sample++;
+	} else {
+		rp->n_mpdu++;
+	}
+	rp->acked += report->ampdu_ack_len;
+	ssv6xxx_pid_report_handler(rc_sta, report);
+	if (rc_sta->is_ht)
+		ssv6xxx_ht_report_handler(report, rc_sta);
+	rate = rc_replay_cur_rate(rp);
+	if (rate != rp->cur_rate) {
+		if (rp->verbose)
+			printf("%12.6f  %-8s -> %s\n", t - rp->t0,
+			       rc_replay_rate_name(rp->cur_rate),
+			       rc_replay_rate_name(rate));
+		rp->cur_rate = rate;
+		rp->changes++;
+		rp->settle_s = t - rp->t0;
+	}
+}
+
+static int rc_replay_parse(const char *line, struct ssv_rc_report *report,
+			   double *t)
+{
+	const char *body, *p;
+	unsigned int wsid, ampdu, len, ack, c[3];
+	int r[3], i;
+	body = strstr(line, "ssv6xxx_rc_report:");
+	if (body) {
+		/* ftrace: "<task>-<pid> [cpu] flags <seconds>: ssv6xxx_rc_report: ..." */
+		p = body;
+		while (p > line && p[-1] == ' ')
+			p--;
+		while (p > line && p[-1] != ' ')
+			p--;
+		if (sscanf(p, "%lf", t) != 1)
+			return -1;
+		body += strlen("ssv6xxx_rc_report:");
+	} else {
+		if (line[0] == '#' || sscanf(line, "%lf", t) != 1)
+			return -1;
+		body = strchr(line, ' ');
+		if (!body)
+			return -1;
+	}
+	if (sscanf(body, " wsid=%u ampdu=%u len=%u ack=%u rates=%d/%u,%d/%u,%d/%u",
+		   &wsid, &ampdu, &len, &ack, &r[0], &c[0], &r[1], &c[1],
+		   &r[2], &c[2]) != 10)
+		return -1;
+	memset(report, 0, sizeof(*report));
+	report->wsid = wsid;
+	report->h_event =
+	    ampdu ? SOC_EVT_RC_AMPDU_REPORT : SOC_EVT_RC_MPDU_REPORT;
+	report->ampdu_len = len;
+	report->ampdu_ack_len = ack;
+	for (i = 0; i < SSV62XX_TX_MAX_RATES; i++) {
+		report->rates[i].data_rate = r[i];
+		report->rates[i].count = c[i];
+	}
+	return 0;
+}
+
+static void rc_replay_summary(struct rc_replay *rp)
+{
+	double dur = rp->t_last - rp->t0;
+	int i;
+	printf("reports     %u (mpdu %u, ampdu %u)\n",
+	       rp->n_mpdu + rp->n_ampdu, rp->n_mpdu, rp->n_ampdu);
+	printf("duration    %.3f s\n", dur);
+	printf("changes     %u, settled at %.3f s on %s\n", rp->changes,
+	       rp->settle_s, rc_replay_rate_name(rp->cur_rate));
+	if (rp->rc_sta.is_ht)
+		printf("samples     %u of %u A-MPDUs\n", rp->n_sample,
+		       rp->n_ampdu);
+	if (dur <= 0)
+		return;
+	printf("goodput     trace %.2f Mbit/s, simulated %.2f Mbit/s\n",
+	       rp->acked * rp->frame_len * 8.0 / dur / 1e6,
+	       rp->sim_bits / dur / 1e6);
+	printf("time at rate:\n");
+	for (i = 0; i < RATE_TABLE_SIZE; i++) {
+		if (rp->rate[i].time_s <= 0)
+			continue;
+		printf("  %-9s %6.2f%%  delivery %3.0f%%\n",
+		       rc_replay_rate_name(i), rp->rate[i].time_s * 100 / dur,
+		       rc_replay_delivery(rp, i) * 100);
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-m b|g|n|n-sgi|n-gf] [-s mcs_mask] [-w wsid]\n"
+		"       [-l frame_len] [-r seed] [-v] [trace]\n"
+		"  -m  station mode the engines are set up for (default n)\n"
+		"  -s  supported MCS mask for HT modes (default 0xff)\n"
+		"  -w  replay one WSID only (default: first one seen)\n"
+		"  -l  MPDU length used for trace goodput (default 1500)\n"
+		"  -r  seed of the minstrel sample table (default 1)\n"
+		"  -v  print every rate change\n"
+		"Simulated goodput is the chosen rate's PHY rate times its\n"
+		"delivery ratio in the trace; it ignores MAC overhead.\n"
+		"The PID engine (b/g) only follows the trace while it picks\n"
+		"the rates the recording used.\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	static struct rc_replay rp;
+	struct ssv_rc_report report;
+	const char *mode = "n";
+	u32 mcs_mask = 0xff;
+	char line[512];
+	FILE *fp = stdin;
+	double t;
+	int opt;
+	rp.wsid = -1;
+	rp.frame_len = 1500;
+	while ((opt = getopt(argc, argv, "m:s:w:l:r:vh")) != -1) {
+		switch (opt) {
+		case 'm':
+			mode = optarg;
+			break;
+		case 's':
+			mcs_mask = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			rp.wsid = atoi(optarg);
+			break;
+		case 'l':
+			rp.frame_len = atoi(optarg);
+			break;
+		case 'r':
+			rc_replay_seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			rp.verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (optind < argc) {
+		fp = fopen(argv[optind], "r");
+		if (!fp) {
+			perror(argv[optind]);
+			return 1;
+		}
+	}
+	if (rc_replay_setup(&rp, mode, mcs_mask)) {
+		usage(argv[0]);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), fp)) {
+		if (rc_replay_parse(line, &report, &t))
+			continue;
+		if (rp.wsid < 0)
+			rp.wsid = report.wsid;
+		if (report.wsid != rp.wsid)
+			continue;
+		rc_replay_report(&rp, &report, t);
+	}
+	if (fp != stdin)
+		fclose(fp);
+	if (!rp.n_mpdu && !rp.n_ampdu) {
+		fprintf(stderr, "no rate control reports found\n");
+		return 1;
+	}
+	rc_replay_summary(&rp);
+	return 0;
+}